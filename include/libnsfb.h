@@ -11,6 +11,7 @@
 #ifndef _LIBNSFB_H
 #define _LIBNSFB_H 1
 
+#include <stddef.h>
 #include <stdint.h>
 
 typedef struct nsfb_palette_s nsfb_palette_t;
@@ -32,6 +33,19 @@ typedef struct nsfb_bbox_s {
     int y1;
 } nsfb_bbox_t;
 
+/** Counts of the areas updated in frames */
+typedef struct nsfb_update_stats_s {
+    unsigned int frames; /**< Frames ended */
+    unsigned int rects_in; /**< Areas passed to ::nsfb_update in frames */
+    unsigned int rects_out; /**< Areas sent to the surface at frame ends */
+    unsigned int bounded; /**< Frames sent as their bounding box */
+
+    /** Bytes of the areas updated on surfaces that only send changes */
+    uint64_t bytes_marked;
+    /** Bytes of those areas found to have changed and sent */
+    uint64_t bytes_changed;
+} nsfb_update_stats_t;
+
 /** The type of framebuffer surface. */
 enum nsfb_type_e {
     NSFB_SURFACE_NONE = 0, /**< No surface */
@@ -106,12 +120,42 @@ int nsfb_claim(nsfb_t *nsfb, nsfb_bbox_t *box);
  * notification. The area updated does not neccisarrily have to
  * corelate with a previous ::nsfb_claim bounding box, however if the
  * redrawn area is larger than the claimed area pointer plotting
- * artifacts may occour.
+ * artifacts may occour. Plot calls being recorded are plotted first.
  *
  * @param box The bounding box of the area which has been altered.
  */
 int nsfb_update(nsfb_t *nsfb, nsfb_bbox_t *box);
 
+/** Start gathering updates into a frame.
+ *
+ * Until ::nsfb_frame_end is called the areas passed to ::nsfb_update are
+ * merged together instead of being sent to the surface, and plot calls
+ * being recorded are not plotted.
+ *
+ * @param nsfb The context.
+ */
+int nsfb_frame_begin(nsfb_t *nsfb);
+
+/** Send the areas updated in a frame to the surface.
+ *
+ * Recorded plot calls are plotted, then the merged areas are sent to the
+ * surface in one batch. When the areas need more than 64 rectangles to
+ * describe, their bounding box is sent instead.
+ *
+ * @param nsfb The context.
+ */
+int nsfb_frame_end(nsfb_t *nsfb);
+
+/** Obtain counts of the areas updated in frames.
+ *
+ * Surfaces that compare updated areas with what they last sent, such as
+ * VNC, also count the bytes updated and the bytes that changed.
+ *
+ * @param nsfb The context.
+ * @param stats Updated with the counts since the context was created.
+ */
+int nsfb_get_update_stats(nsfb_t *nsfb, nsfb_update_stats_t *stats);
+
 /** Obtain the geometry of a nsfb context.
  *
  * @param width a variable to store the framebuffer width in or NULL
@@ -133,14 +177,46 @@ int nsfb_set_geometry(nsfb_t *nsfb, int width, int height, enum nsfb_format_e fo
  *
  * Some surface types can take additional parameters for
  * attributes. For example the linux surface uses this to allow the
- * setting of a different output device
+ * setting of a different output device and the vnc surface takes
+ * "threaded" to service clients on a thread of its own.
  *
  * @param nsfb The surface to alter.
  * @param parameters The parameters for the surface.
  */
 int nsfb_set_parameters(nsfb_t *nsfb, const char *parameters);
 
+/** Size the scratch storage of a context up front.
+ *
+ * Plotters draw their temporary storage, such as path vertices and
+ * polygon edge tables, from a scratch arena belonging to the context
+ * which grows to the most any plot has needed. Reserving it beforehand
+ * avoids allocations while the first frames are drawn.
+ *
+ * @param nsfb The context to alter.
+ * @param size The number of bytes of scratch storage to hold.
+ * @return 0 on success or -1 if the storage could not be allocated.
+ */
+int nsfb_set_scratch_size(nsfb_t *nsfb, size_t size);
+
+/** Set the number of threads plotting a context's display lists.
+ *
+ * When more than one thread is set, plot calls recorded with
+ * ::nsfb_plot_record are split between screen tiles of 64 by 64 pixels
+ * when they are plotted, and the tiles are shared between the calling
+ * thread and worker threads. The result is identical to plotting on one
+ * thread. Plot calls which are not recorded are unaffected.
+ *
+ * @param nsfb The context to alter.
+ * @param threads The number of threads including the calling thread; one
+ *                or fewer stops the worker threads.
+ * @return 0 on success or -1 if the threads could not be started.
+ */
+int nsfb_set_threads(nsfb_t *nsfb, int threads);
+
 /** Obtain the buffer memory base and stride. 
+ *
+ * Plot calls being recorded are plotted first. Calls recorded after this
+ * one are not on the buffer until they are flushed.
  *
  * @param nsfb The context to read.
  */
@@ -35,16 +35,50 @@ typedef enum nsfb_plot_optype_e {
 	NFSB_PLOT_OPTYPE_PATTERN, /**< Pattern plot */
 } nsfb_plot_optype_t;
 
+/** Shape of the ends of strokes wider than a pixel. */
+typedef enum nsfb_plot_cap_e {
+	NSFB_PLOT_CAP_BUTT = 0, /**< Ends square at the end points */
+	NSFB_PLOT_CAP_SQUARE, /**< Extends half the width past the ends */
+} nsfb_plot_cap_t;
+
+/** Shape of the corners of strokes wider than a pixel. */
+typedef enum nsfb_plot_join_e {
+	NSFB_PLOT_JOIN_MITER = 0, /**< Sharp, bevelled when very long */
+	NSFB_PLOT_JOIN_BEVEL, /**< Cut across the outside of the corner */
+} nsfb_plot_join_t;
+
 /** pen colour and raster operation for plotting primatives. */
 typedef struct nsfb_plot_pen_s {
 	nsfb_plot_optype_t stroke_type; /**< Stroke plot type */
 	int stroke_width; /**< Width of stroke, in pixels */
 	nsfb_colour_t stroke_colour; /**< Colour of stroke */
-	uint32_t stroke_pattern;
+	uint32_t stroke_pattern; /**< Pattern stroke mask, bit 0 first, a bit
+				   * covering a pixel or the width of a wide
+				   * stroke */
 	nsfb_plot_optype_t fill_type; /**< Fill plot type */
 	nsfb_colour_t fill_colour; /**< Colour of fill */
 } nsfb_plot_pen_t;
 
+/** Filter used when plotting scaled bitmaps. */
+typedef enum nsfb_plot_filter_e {
+	NSFB_PLOT_FILTER_NEAREST = 0, /**< Nearest source pixel */
+	NSFB_PLOT_FILTER_BOX, /**< Average of the covered source pixels */
+	NSFB_PLOT_FILTER_BILINEAR, /**< Bilinear interpolation */
+} nsfb_plot_filter_t;
+
+/** Dithering used when plotting bitmaps to paletted surfaces. */
+typedef enum nsfb_plot_dither_e {
+	NSFB_PLOT_DITHER_ERROR_DIFFUSION = 0, /**< Floyd-Steinberg */
+	NSFB_PLOT_DITHER_ORDERED, /**< Threshold matrix keyed by position */
+} nsfb_plot_dither_t;
+
+/** A horizontal run of pixels on one row. */
+typedef struct nsfb_plot_span_s {
+	int y; /**< Row of the span */
+	int x0; /**< First column of the span */
+	int x1; /**< Column after the last of the span */
+} nsfb_plot_span_t;
+
 /** path operation type. */
 typedef enum nsfb_plot_pathop_type_e {
 	NFSB_PLOT_PATHOP_MOVE,
@@ -107,6 +141,13 @@ bool nsfb_plot_lines(nsfb_t *nsfb, int linec, nsfb_bbox_t *line, nsfb_plot_pen_t
  */
 bool nsfb_plot_polylines(nsfb_t *nsfb, int pointc, const nsfb_point_t *points, nsfb_plot_pen_t *pen);
 
+/** Plots a list of spans in one colour.
+ *
+ * Each span fills the pixels from x0 up to, but not including, x1 on row y.
+ * The spans are clipped to the current clipping area.
+ */
+bool nsfb_plot_spans(nsfb_t *nsfb, int spanc, const nsfb_plot_span_t *spans, nsfb_colour_t c);
+
 /** Plots a filled polygon. 
  *
  * Plots a filled polygon with straight lines between points. The lines around
@@ -132,6 +173,13 @@ bool nsfb_plot_ellipse_fill(nsfb_t *nsfb, nsfb_bbox_t *ellipse, nsfb_colour_t c)
  */
 bool nsfb_plot_arc(nsfb_t *nsfb, int x, int y, int radius, int angle1, int angle2, nsfb_colour_t c);
 
+/** Plots a filled pie slice.
+ *
+ * The sector of the circle around (x,y) swept anticlockwise from angle1 to
+ * angle2, as for nsfb_plot_arc(), is filled.
+ */
+bool nsfb_plot_pie(nsfb_t *nsfb, int x, int y, int radius, int angle1, int angle2, nsfb_colour_t c);
+
 /** Plots an alpha blended pixel.
  *
  * plots an alpha blended pixel.
@@ -150,6 +198,30 @@ bool nsfb_plot_path(nsfb_t *nsfb, int pathc, nsfb_plot_pathop_t *pathop, nsfb_pl
  */
 bool nsfb_plot_copy(nsfb_t *srcfb, nsfb_bbox_t *srcbox, nsfb_t *dstfb, nsfb_bbox_t *dstbox);
 
+/** Set the filter used to scale bitmaps.
+ *
+ * The filter applies to subsequent nsfb_plot_bitmap() and
+ * nsfb_plot_bitmap_tiles() calls whose destination size differs from the
+ * bitmap size. The default is NSFB_PLOT_FILTER_NEAREST.
+ */
+bool nsfb_plot_set_bitmap_filter(nsfb_t *nsfb, nsfb_plot_filter_t filter);
+
+/** Set the caps and joins of strokes wider than a pixel.
+ *
+ * The style applies to subsequent lines, polylines, curves and paths
+ * plotted with a pen wider than a pixel. The default is
+ * NSFB_PLOT_CAP_BUTT and NSFB_PLOT_JOIN_MITER.
+ */
+bool nsfb_plot_set_stroke_style(nsfb_t *nsfb, nsfb_plot_cap_t cap, nsfb_plot_join_t join);
+
+/** Set the dithering used to plot bitmaps.
+ *
+ * Only surfaces with a palette dither, false is returned for others.
+ * Ordered dithering gives each pixel the same result wherever it is
+ * plotted from, so tiled and scaled bitmaps are dithered too.
+ */
+bool nsfb_plot_set_dither(nsfb_t *nsfb, nsfb_plot_dither_t dither);
+
 /** Plot bitmap.
  */
 bool nsfb_plot_bitmap(nsfb_t *nsfb, const nsfb_bbox_t *loc, const nsfb_colour_t *pixel, int bmp_width, int bmp_height, int bmp_stride, bool alpha);
@@ -170,4 +242,22 @@ bool nsfb_plot_glyph1(nsfb_t *nsfb, nsfb_bbox_t *loc, const uint8_t *pixel, int
 /* read rectangle into buffer */
 bool nsfb_plot_readrect(nsfb_t *nsfb, nsfb_bbox_t *rect, nsfb_colour_t *buffer);
 
+/** Start recording plot calls.
+ *
+ * Until ::nsfb_plot_flush is called the plot calls are recorded in a
+ * display list instead of being plotted, so plots that later opaque fills
+ * and bitmaps cover need never be made. Clipping and the bitmap filter
+ * apply as they were when each call was made. Bitmap pixels are not
+ * copied and must be unchanged until the list is plotted.
+ *
+ * Copies, reads and ::nsfb_update plot the calls recorded so far first.
+ */
+bool nsfb_plot_record(nsfb_t *nsfb);
+
+/** Plot the recorded calls and stop recording.
+ *
+ * @return true on success or false if any recorded plot failed.
+ */
+bool nsfb_plot_flush(nsfb_t *nsfb);
+
 #endif /* _LIBNSFB_PLOT_H */
@@ -52,6 +52,7 @@ bool nsfb_cursor_set(nsfb_t *nsfb, const nsfb_colour_t *pixel,
 
     nsfb->cursor->hotspot_x = hotspot_x;
     nsfb->cursor->hotspot_y = hotspot_y;
+    nsfb->cursor->new_image = true;
  
     return nsfb->surface_rtns->cursor(nsfb, nsfb->cursor);
 }
@@ -83,6 +84,11 @@ bool nsfb_cursor_plot(nsfb_t *nsfb, struct nsfb_cursor_s *cursor)
     int sav_size;
     nsfb_bbox_t sclip; /* saved clipping area */
 
+    if (cursor->native) {
+        /* the surface shows the cursor */
+        return true;
+    }
+
     nsfb->plotter_fns->get_clip(nsfb, &sclip);
     nsfb->plotter_fns->set_clip(nsfb, NULL);
 
@@ -157,6 +163,29 @@ bool nsfb_cursor_clear(nsfb_t *nsfb, struct nsfb_cursor_s *cursor)
 
 }
 
+/* documented in cursor.h */
+void nsfb_cursor_argb(const struct nsfb_cursor_s *cursor, uint32_t *argb)
+{
+    const nsfb_colour_t *row = cursor->pixel;
+    nsfb_colour_t c;
+    uint32_t a;
+    int x, y;
+
+    for (y = 0; y < cursor->bmp_height; y++) {
+        for (x = 0; x < cursor->bmp_width; x++) {
+            c = row[x];
+            a = (c >> 24) & 0xff;
+
+            /* nsfb colours are 0xAABBGGRR */
+            *argb++ = (a << 24) |
+                    (((((c >> 0) & 0xff) * a + 127) / 255) << 16) |
+                    (((((c >> 8) & 0xff) * a + 127) / 255) << 8) |
+                    ((((c >> 16) & 0xff) * a + 127) / 255);
+        }
+        row += cursor->bmp_stride;
+    }
+}
+
 bool nsfb_cursor_destroy(struct nsfb_cursor_s *cursor)
 {
 	/* Note: cursor->pixel isn't owned by us */
@@ -15,6 +15,11 @@ struct nsfb_cursor_s {
     bool plotted;
     nsfb_bbox_t loc;
 
+    /* the surface shows the image itself so it is never plotted */
+    bool native;
+    /* the image has been set since the surface last looked at it */
+    bool new_image;
+
     /* current cursor image */
     const nsfb_colour_t *pixel;
     int bmp_width;
@@ -38,6 +43,14 @@ bool nsfb_cursor_plot(nsfb_t *nsfb, struct nsfb_cursor_s *cursor);
 /** Clear the cursor restoring the image underneath */
 bool nsfb_cursor_clear(nsfb_t *nsfb, struct nsfb_cursor_s *cursor);
 
+/** Convert the cursor image to premultiplied ARGB pixels.
+ *
+ * \param cursor The cursor.
+ * \param argb Storage for bmp_width * bmp_height pixels, as 32 bit values
+ *             with alpha in the top byte and blue in the bottom byte.
+ */
+void nsfb_cursor_argb(const struct nsfb_cursor_s *cursor, uint32_t *argb);
+
 /** Destroy the cursor */
 bool nsfb_cursor_destroy(struct nsfb_cursor_s *cursor);
 
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2026 libnsfb contributors
+ *
+ * This file is part of libnsfb, http://www.netsurf-browser.org/
+ * Licenced under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ *
+ * This is the *internal* interface for the display list.
+ */
+
+#ifndef DLIST_H
+#define DLIST_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "libnsfb.h"
+#include "libnsfb_plot.h"
+
+struct nsfb_dlist_op_s;
+
+/** Display list of recorded plot calls.
+ *
+ * While recording, the public plot calls append an operation to the list
+ * instead of plotting. Each operation keeps the area it can change and
+ * the clip it was made with; its variable sized arguments are copied into
+ * a single data buffer. The storage is kept between flushes so a redraw
+ * of a similar scene needs no allocations.
+ */
+struct nsfb_dlist_s {
+	bool recording; /**< Plot calls are being recorded */
+
+	struct nsfb_dlist_op_s *op; /**< Recorded operations */
+	int opc; /**< Number of recorded operations */
+	int op_size; /**< Number of operations allocated */
+
+	nsfb_bbox_t *clip; /**< Clip rectangles used by the operations */
+	int clipc; /**< Number of clip rectangles */
+	int clip_size; /**< Number of clip rectangles allocated */
+
+	unsigned char *data; /**< Arguments of the operations */
+	size_t data_used; /**< Bytes of argument data in use */
+	size_t data_size; /**< Bytes of argument data allocated */
+
+	int *bin; /**< First reference of each tile, then the end */
+	int *ref; /**< Operations touching each tile, tile by tile */
+	int ref_size; /**< Number of references allocated */
+	int *tile; /**< Tiles touched by the operations being plotted */
+	int tile_size; /**< Number of tiles the bins were allocated for */
+};
+
+/** Plot every operation recorded in a context's display list.
+ *
+ * Operations entirely covered by a later opaque fill or bitmap are
+ * dropped and touching fills of the same colour are merged before the
+ * rest are plotted in order. When the context has worker threads, runs
+ * of operations which plot the same pixels however they are clipped are
+ * split between screen tiles plotted in parallel. The list is left empty
+ * and still recording if it was.
+ *
+ * \param nsfb The context.
+ * \return true on success or false if any plot failed.
+ */
+bool nsfb_dlist_execute(nsfb_t *nsfb);
+
+/** Free the storage of a display list. */
+void nsfb_dlist_fini(struct nsfb_dlist_s *dlist);
+
+/* Recorders for each of the public plot calls. Each has the parameters
+ * of the call it records and returns false only if the operation could
+ * not be stored.
+ */
+bool nsfb_dlist_clg(nsfb_t *nsfb, nsfb_colour_t c);
+bool nsfb_dlist_rectangle(nsfb_t *nsfb, const nsfb_bbox_t *rect, int line_width, nsfb_colour_t c, bool dotted, bool dashed);
+bool nsfb_dlist_fill(nsfb_t *nsfb, const nsfb_bbox_t *rect, nsfb_colour_t c);
+bool nsfb_dlist_lines(nsfb_t *nsfb, int linec, const nsfb_bbox_t *line, const nsfb_plot_pen_t *pen);
+bool nsfb_dlist_polylines(nsfb_t *nsfb, int pointc, const nsfb_point_t *points, const nsfb_plot_pen_t *pen);
+bool nsfb_dlist_spans(nsfb_t *nsfb, int spanc, const nsfb_plot_span_t *spans, nsfb_colour_t c);
+bool nsfb_dlist_polygon(nsfb_t *nsfb, const int *p, unsigned int n, nsfb_colour_t fill);
+bool nsfb_dlist_arc(nsfb_t *nsfb, int x, int y, int radius, int angle1, int angle2, nsfb_colour_t c);
+bool nsfb_dlist_pie(nsfb_t *nsfb, int x, int y, int radius, int angle1, int angle2, nsfb_colour_t c);
+bool nsfb_dlist_point(nsfb_t *nsfb, int x, int y, nsfb_colour_t c);
+bool nsfb_dlist_ellipse(nsfb_t *nsfb, const nsfb_bbox_t *ellipse, nsfb_colour_t c);
+bool nsfb_dlist_ellipse_fill(nsfb_t *nsfb, const nsfb_bbox_t *ellipse, nsfb_colour_t c);
+bool nsfb_dlist_bitmap(nsfb_t *nsfb, const nsfb_bbox_t *loc, const nsfb_colour_t *pixel, int bmp_width, int bmp_height, int bmp_stride, bool alpha);
+bool nsfb_dlist_bitmap_tiles(nsfb_t *nsfb, const nsfb_bbox_t *loc, int tiles_x, int tiles_y, const nsfb_colour_t *pixel, int bmp_width, int bmp_height, int bmp_stride, bool alpha);
+bool nsfb_dlist_glyph8(nsfb_t *nsfb, const nsfb_bbox_t *loc, const uint8_t *pixel, int pitch, nsfb_colour_t c);
+bool nsfb_dlist_glyph1(nsfb_t *nsfb, const nsfb_bbox_t *loc, const uint8_t *pixel, int pitch, nsfb_colour_t c);
+bool nsfb_dlist_quadratic(nsfb_t *nsfb, const nsfb_bbox_t *curve, const nsfb_point_t *ctrla, const nsfb_plot_pen_t *pen);
+bool nsfb_dlist_cubic(nsfb_t *nsfb, const nsfb_bbox_t *curve, const nsfb_point_t *ctrla, const nsfb_point_t *ctrlb, const nsfb_plot_pen_t *pen);
+bool nsfb_dlist_path(nsfb_t *nsfb, int pathc, const nsfb_plot_pathop_t *pathop, const nsfb_plot_pen_t *pen);
+
+#endif
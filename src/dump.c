@@ -22,28 +22,50 @@ bool
 nsfb_dump(nsfb_t *nsfb, int fd)
 {
     FILE *outf;
+    nsfb_colour_t *row;
+    nsfb_bbox_t clip;
+    nsfb_bbox_t rect;
     int x;
     int y;
 
+    /* rows are read through the plotters so every format is converted */
+    row = malloc(nsfb->width * sizeof(nsfb_colour_t));
+    if (row == NULL) {
+	    return false;
+    }
+
     outf = fdopen(dup(fd), "w");
     if (outf == NULL) {
+	    free(row);
 	    return false;
     }
 
+    /* the whole surface is dumped, whatever the clipping */
+    nsfb_plot_get_clip(nsfb, &clip);
+    nsfb_plot_set_clip(nsfb, NULL);
+
     fprintf(outf,"P3\n#libnsfb buffer dump\n%d %d\n255\n",
 	    nsfb->width, nsfb->height);
     for (y=0; y < nsfb->height; y++) {
+	rect.x0 = 0;
+	rect.y0 = y;
+	rect.x1 = nsfb->width;
+	rect.y1 = y + 1;
+	nsfb_plot_readrect(nsfb, &rect, row);
+
 	for (x=0; x < nsfb->width; x++) {
-	    fprintf(outf,"%d %d %d ", 
-		    *(nsfb->ptr + (((nsfb->width * y) + x) * 4) + 2),
-		    *(nsfb->ptr + (((nsfb->width * y) + x) * 4) + 1),
-		    *(nsfb->ptr + (((nsfb->width * y) + x) * 4) + 0));
-	    
+	    fprintf(outf,"%d %d %d ",
+		    row[x] & 0xFF,
+		    (row[x] >> 8) & 0xFF,
+		    (row[x] >> 16) & 0xFF);
 	}
 	fprintf(outf,"\n");
     }
 
+    nsfb_plot_set_clip(nsfb, &clip);
+
     fclose(outf);
+    free(row);
 
     return true;
 }
@@ -13,11 +13,13 @@
 
 #include "libnsfb.h"
 #include "libnsfb_plot.h"
+#include "libnsfb_plot_util.h"
 #include "libnsfb_event.h"
 #include "nsfb.h"
 #include "cursor.h"
 #include "palette.h"
 #include "surface.h"
+#include "tiles.h"
 
 /* exported interface documented in libnsfb.h */
 nsfb_t*
@@ -62,6 +64,11 @@ nsfb_free(nsfb_t *nsfb)
     if (nsfb->cursor != NULL)
 	nsfb_cursor_destroy(nsfb->cursor);
 
+    nsfb_scratch_fini(&nsfb->scratch);
+    nsfb_dlist_fini(&nsfb->dlist);
+    nsfb_tiles_free(nsfb->tiles);
+    nsfb_region_fini(&nsfb->damage);
+
     ret = nsfb->surface_rtns->finalise(nsfb);
 
     free(nsfb->surface_rtns);
@@ -88,9 +95,89 @@ nsfb_claim(nsfb_t *nsfb, nsfb_bbox_t *box)
 int 
 nsfb_update(nsfb_t *nsfb, nsfb_bbox_t *box)
 {
+    nsfb_bbox_t fbarea;
+    nsfb_bbox_t area;
+
+    if (nsfb->frame) {
+	/* gather the area, on screen, into the frame */
+	fbarea.x0 = 0;
+	fbarea.y0 = 0;
+	fbarea.x1 = nsfb->width;
+	fbarea.y1 = nsfb->height;
+
+	area = *box;
+	nsfb->update_stats.rects_in++;
+	if (!nsfb_plot_clip(&fbarea, &area)) {
+	    return 0; /* nothing on screen to update */
+	}
+
+	if (nsfb_region_add(&nsfb->damage, &area)) {
+	    return 0;
+	}
+
+	/* without storage for the area it is updated now */
+    }
+
+    /* recorded plots must reach the surface before it is updated */
+    nsfb_dlist_execute(nsfb);
+
     return nsfb->surface_rtns->update(nsfb, box);
 }
 
+/** Send the areas gathered in the current frame to the surface. */
+static int frame_flush(nsfb_t *nsfb)
+{
+    struct nsfb_region_s *damage = &nsfb->damage;
+    int ret;
+
+    if (damage->rectc == 0) {
+	return 0;
+    }
+
+    nsfb->update_stats.rects_out += damage->rectc;
+    if (damage->bounded) {
+	nsfb->update_stats.bounded++;
+    }
+
+    ret = nsfb->surface_rtns->update_rects(nsfb, damage->rect, damage->rectc);
+
+    nsfb_region_clear(damage);
+
+    return ret;
+}
+
+/* exported interface documented in libnsfb.h */
+int nsfb_frame_begin(nsfb_t *nsfb)
+{
+    nsfb->frame = true;
+
+    return 0;
+}
+
+/* exported interface documented in libnsfb.h */
+int nsfb_frame_end(nsfb_t *nsfb)
+{
+    if (!nsfb->frame) {
+	return 0;
+    }
+
+    /* recorded plots must reach the surface before it is updated */
+    nsfb_dlist_execute(nsfb);
+
+    nsfb->frame = false;
+    nsfb->update_stats.frames++;
+
+    return frame_flush(nsfb);
+}
+
+/* exported interface documented in libnsfb.h */
+int nsfb_get_update_stats(nsfb_t *nsfb, nsfb_update_stats_t *stats)
+{
+    *stats = nsfb->update_stats;
+
+    return 0;
+}
+
 /* exported interface documented in libnsfb.h */
 int 
 nsfb_set_geometry(nsfb_t *nsfb, int width, int height, enum nsfb_format_e format) 
@@ -104,6 +191,10 @@ nsfb_set_geometry(nsfb_t *nsfb, int width, int height, enum nsfb_format_e format
     if (format == NSFB_FMT_ANY)
 	    format = nsfb->format; 
 
+    /* recorded plots and gathered updates are for the old geometry */
+    nsfb_dlist_execute(nsfb);
+    frame_flush(nsfb);
+
     return nsfb->surface_rtns->geometry(nsfb, width, height, format);
 }
 
@@ -123,6 +214,26 @@ int nsfb_set_parameters(nsfb_t *nsfb, const char *parameters)
     return nsfb->surface_rtns->parameters(nsfb, parameters);
 }
 
+/* exported interface documented in libnsfb.h */
+int nsfb_set_scratch_size(nsfb_t *nsfb, size_t size)
+{
+    if (nsfb_scratch_reserve(&nsfb->scratch, size) == false) {
+	return -1;
+    }
+
+    return 0;
+}
+
+/* exported interface documented in libnsfb.h */
+int nsfb_set_threads(nsfb_t *nsfb, int threads)
+{
+    if (nsfb_tiles_set_threads(nsfb, threads) == false) {
+	return -1;
+    }
+
+    return 0;
+}
+
 /* exported interface documented in libnsfb.h */
 int 
 nsfb_get_geometry(nsfb_t *nsfb, int *width, int *height, enum nsfb_format_e *format) 
@@ -143,6 +254,10 @@ nsfb_get_geometry(nsfb_t *nsfb, int *width, int *height, enum nsfb_format_e *for
 int 
 nsfb_get_buffer(nsfb_t *nsfb, uint8_t **ptr, int *linelen) 
 {
+    /* the caller may read or write the pixels directly so recorded plots
+     * must be on the surface first */
+    nsfb_dlist_execute(nsfb);
+
     if (ptr != NULL) {
 	*ptr = nsfb->ptr;
     }
@@ -11,8 +11,13 @@
 #ifndef _NSFB_H
 #define _NSFB_H 1
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include "scratch.h"
+#include "dlist.h"
+#include "region.h"
+
 
 /**
  * Framebuffer context
@@ -37,6 +42,16 @@ struct nsfb_s {
 
     nsfb_bbox_t clip; /**< current clipping rectangle for plotters */
     struct nsfb_plotter_fns_s *plotter_fns; /**< Plotter methods */
+    nsfb_plot_filter_t bitmap_filter; /**< scaled bitmap filter */
+    nsfb_plot_cap_t stroke_cap; /**< ends of wide strokes */
+    nsfb_plot_join_t stroke_join; /**< corners of wide strokes */
+    struct nsfb_scratch_s scratch; /**< plotter temporary storage */
+    struct nsfb_dlist_s dlist; /**< recorded plot calls */
+    struct nsfb_tiles_s *tiles; /**< threads plotting tiles or NULL */
+
+    bool frame; /**< updates are being gathered into a frame */
+    struct nsfb_region_s damage; /**< areas updated in the current frame */
+    nsfb_update_stats_t update_stats; /**< counts of frame updates */
 };
 
 
@@ -29,7 +29,16 @@ bool nsfb_palette_new(struct nsfb_palette_s **palette, int width)
 	(*palette)->type = NSFB_PALETTE_EMPTY;
 	(*palette)->last = 0;
 
+	(*palette)->lut.cell = NULL;
+	(*palette)->lut.list = NULL;
+	(*palette)->lut.len = 0;
+	(*palette)->lut.size = 0;
+
 	(*palette)->dither = false;
+	(*palette)->dither_type = NSFB_PLOT_DITHER_ERROR_DIFFUSION;
+	(*palette)->dither_step[0] = 0;
+	(*palette)->dither_step[1] = 0;
+	(*palette)->dither_step[2] = 0;
 	(*palette)->dither_ctx.data_len = width * 3 * sizeof(int);
 	(*palette)->dither_ctx.data = malloc(width * 3 * sizeof(int));
 	if ((*palette)->dither_ctx.data == NULL) {
@@ -47,6 +56,8 @@ void nsfb_palette_free(struct nsfb_palette_s *palette)
 		if (palette->dither_ctx.data != NULL) {
 			free(palette->dither_ctx.data);
 		}
+		free(palette->lut.cell);
+		free(palette->lut.list);
 		free(palette);
 	}
 }
@@ -67,6 +78,54 @@ void nsfb_palette_dither_fini(struct nsfb_palette_s *palette)
 	palette->dither = false;
 }
 
+/** Select the type of dithering done by subsequent plots. */
+void nsfb_palette_dither_set_type(struct nsfb_palette_s *palette,
+		nsfb_plot_dither_t type)
+{
+	palette->dither_type = type;
+}
+
+/** Bring a copy of a palette up to date. */
+bool nsfb_palette_copy(struct nsfb_palette_s **copy,
+		const struct nsfb_palette_s *palette)
+{
+	int *data;
+
+	if (*copy == NULL && nsfb_palette_new(copy,
+			palette->dither_ctx.data_len / (3 * sizeof(int))) == false)
+		return false;
+
+	if ((*copy)->dither_ctx.data_len < palette->dither_ctx.data_len) {
+		data = realloc((*copy)->dither_ctx.data,
+				palette->dither_ctx.data_len);
+		if (data == NULL)
+			return false;
+		(*copy)->dither_ctx.data = data;
+		(*copy)->dither_ctx.data_len = palette->dither_ctx.data_len;
+	}
+
+	(*copy)->dither = palette->dither;
+	(*copy)->dither_type = palette->dither_type;
+
+	if ((*copy)->type == palette->type &&
+			(*copy)->last == palette->last &&
+			memcmp((*copy)->data, palette->data,
+					sizeof(palette->data)) == 0)
+		return true;
+
+	if (palette->type == NSFB_PALETTE_OTHER)
+		return nsfb_palette_set(*copy, palette->data,
+				palette->last + 1);
+
+	memcpy((*copy)->data, palette->data, sizeof(palette->data));
+	(*copy)->type = palette->type;
+	(*copy)->last = palette->last;
+	memcpy((*copy)->dither_step, palette->dither_step,
+			sizeof(palette->dither_step));
+
+	return true;
+}
+
 /** Generate libnsfb 8bpp default palette. */
 void nsfb_palette_generate_nsfb_8bpp(struct nsfb_palette_s *palette)
 {
@@ -115,4 +174,130 @@ void nsfb_palette_generate_nsfb_8bpp(struct nsfb_palette_s *palette)
 	/* Set palette details */
 	palette->type = NSFB_PALETTE_NSFB_8BPP;
 	palette->last = 255;
+
+	/* Spacing of the colour cube levels */
+	palette->dither_step[0] = 255 / 5;
+	palette->dither_step[1] = 255 / 7;
+	palette->dither_step[2] = 255 / 4;
+}
+
+/** Set an arbitrary palette of up to 256 colours. */
+bool nsfb_palette_set(struct nsfb_palette_s *palette,
+		const nsfb_colour_t *colours, int count)
+{
+	int cells = 1 << (3 * NSFB_PALETTE_LUT_BITS);
+	int levels;
+
+	if (count < 1 || count > 256)
+		return false;
+
+	memcpy(palette->data, colours, count * sizeof(nsfb_colour_t));
+	memset(palette->data + count, 0,
+			(256 - count) * sizeof(nsfb_colour_t));
+
+	palette->type = NSFB_PALETTE_OTHER;
+	palette->last = count - 1;
+
+	/* Assume the colours are spread evenly, as levels of a cube */
+	for (levels = 2; levels * levels * levels < count; levels++)
+		;
+	palette->dither_step[0] = 255 / (levels - 1);
+	palette->dither_step[1] = palette->dither_step[0];
+	palette->dither_step[2] = palette->dither_step[0];
+
+	/* Discard the inverse colour map of any previous palette. If the
+	 * cell table can't be allocated, matching searches every colour. */
+	if (palette->lut.cell == NULL)
+		palette->lut.cell = malloc(cells * sizeof(uint32_t));
+	if (palette->lut.cell != NULL)
+		memset(palette->lut.cell, 0, cells * sizeof(uint32_t));
+	palette->lut.len = 0;
+
+	return true;
+}
+
+/** Build the inverse colour map list for a cell.
+ *
+ * A palette entry can only be the best match for a colour in the cell if
+ * its nearest distance to the cell is no further than the furthest
+ * distance of the entry whose furthest distance is least. Only those
+ * entries are listed, in palette order, so searching the list gives the
+ * same result as searching the whole palette.
+ */
+uint32_t nsfb_palette_lut_cell(struct nsfb_palette_s *palette, int cell)
+{
+	int size = 1 << (8 - NSFB_PALETTE_LUT_BITS); /* cell size */
+	int mask = (1 << NSFB_PALETTE_LUT_BITS) - 1;
+	int lo[3], hi[3]; /* cell bounds, red green and blue */
+	int near[256]; /* nearest distance of each entry */
+	int best_far = INT_MAX;
+	int dnear, dfar;
+	int comp, v, d;
+	int col;
+	int count = 0;
+	uint8_t *list;
+	uint32_t offset;
+
+	if (palette->lut.cell == NULL)
+		return 0;
+
+	lo[0] = ((cell >> (2 * NSFB_PALETTE_LUT_BITS)) & mask) * size;
+	lo[1] = ((cell >> NSFB_PALETTE_LUT_BITS) & mask) * size;
+	lo[2] = (cell & mask) * size;
+	for (comp = 0; comp < 3; comp++)
+		hi[comp] = lo[comp] + size - 1;
+
+	for (col = 0; col <= palette->last; col++) {
+		dnear = dfar = 0;
+		for (comp = 0; comp < 3; comp++) {
+			v = (palette->data[col] >> (8 * comp)) & 0xFF;
+
+			if (v < lo[comp])
+				d = lo[comp] - v;
+			else if (v > hi[comp])
+				d = v - hi[comp];
+			else
+				d = 0;
+			dnear += d * d;
+
+			d = (v - lo[comp] > hi[comp] - v) ?
+					v - lo[comp] : hi[comp] - v;
+			dfar += d * d;
+		}
+		near[col] = dnear;
+		if (dfar < best_far)
+			best_far = dfar;
+	}
+
+	for (col = 0; col <= palette->last; col++) {
+		if (near[col] <= best_far)
+			count++;
+	}
+
+	if (palette->lut.len + 1 + count > palette->lut.size) {
+		int lsize = palette->lut.size * 2;
+
+		if (lsize < palette->lut.len + 1 + count)
+			lsize = (palette->lut.len + 1 + count) * 2;
+
+		list = realloc(palette->lut.list, lsize);
+		if (list == NULL)
+			return 0;
+
+		palette->lut.list = list;
+		palette->lut.size = lsize;
+	}
+
+	list = palette->lut.list + palette->lut.len;
+	*list++ = count - 1;
+	for (col = 0; col <= palette->last; col++) {
+		if (near[col] <= best_far)
+			*list++ = col;
+	}
+
+	offset = palette->lut.len + 1;
+	palette->lut.len += 1 + count;
+	palette->lut.cell[cell] = offset;
+
+	return offset;
 }
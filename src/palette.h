@@ -11,6 +11,7 @@
 #ifndef PALETTE_H
 #define PALETTE_H 1
 
+#include <stddef.h>
 #include <stdint.h>
 #include <limits.h>
 
@@ -23,18 +24,36 @@ enum nsfb_palette_type_e {
 	NSFB_PALETTE_OTHER      /**< any other palette  */
 };
 
+/** Bits of each colour component used to index the inverse colour map */
+#define NSFB_PALETTE_LUT_BITS 5
+
 struct nsfb_palette_s {
 	enum nsfb_palette_type_e type; /**< Palette type */
 	uint8_t last; /**< Last used palette index */
 	nsfb_colour_t data[256]; /**< Palette for index modes */
 
 	bool dither; /**< Whether error diffusion was requested */
+	nsfb_plot_dither_t dither_type; /**< Dithering done when requested */
+	int dither_step[3]; /**< Typical red, green, blue entry spacing */
 	struct {
 		int width; /**< Length of error value buffer ring*/
 		int current; /**< Current pos in ring buffer*/
 		int *data; /**< Ring buffer error values */
 		int data_len; /**< Max size of ring */
 	} dither_ctx;
+
+	/** Inverse colour map for NSFB_PALETTE_OTHER.
+	 *
+	 * The colour space is split into cells, each of which lists the
+	 * palette entries that can be the best match for a colour in it.
+	 * A cell's list is built the first time a colour in it is matched.
+	 */
+	struct {
+		uint32_t *cell; /**< Offset + 1 of each cell's list or 0 */
+		uint8_t *list; /**< Lists of entry count - 1 then entries */
+		int len; /**< Used length of lists */
+		int size; /**< Allocated length of lists */
+	} lut;
 };
 
 
@@ -50,14 +69,49 @@ void nsfb_palette_dither_init(struct nsfb_palette_s *palette, int width);
 /** Finalise error diffusion after a plot. */
 void nsfb_palette_dither_fini(struct nsfb_palette_s *palette);
 
+/** Select the type of dithering done by subsequent plots. */
+void nsfb_palette_dither_set_type(struct nsfb_palette_s *palette,
+		nsfb_plot_dither_t type);
+
+/** Bring a copy of a palette up to date.
+ *
+ * The copy shares no storage with the palette, so another thread can
+ * match colours and dither with it. Its inverse colour map is kept while
+ * the colours are unchanged.
+ *
+ * \param copy The copy to update, created if NULL.
+ * \param palette The palette to copy.
+ * \return true on success or false if the copy could not be allocated.
+ */
+bool nsfb_palette_copy(struct nsfb_palette_s **copy,
+		const struct nsfb_palette_s *palette);
+
 /** Generate libnsfb 8bpp default palette. */
 void nsfb_palette_generate_nsfb_8bpp(struct nsfb_palette_s *palette);
 
+/** Set an arbitrary palette of up to 256 colours. */
+bool nsfb_palette_set(struct nsfb_palette_s *palette,
+		const nsfb_colour_t *colours, int count);
+
+/** Build the inverse colour map list for a cell.
+ *
+ * \return The offset + 1 of the list or 0 if it could not be built.
+ */
+uint32_t nsfb_palette_lut_cell(struct nsfb_palette_s *palette, int cell);
+
 static inline bool nsfb_palette_dithering_on(struct nsfb_palette_s *palette)
 {
 	return palette->dither;
 }
 
+/** Whether a plot is being dithered with the ordered threshold matrix. */
+static inline bool nsfb_palette_dithering_ordered(
+		struct nsfb_palette_s *palette)
+{
+	return palette->dither &&
+			palette->dither_type == NSFB_PLOT_DITHER_ORDERED;
+}
+
 /** Find best palette match for given colour. */
 static inline uint8_t nsfb_palette_best_match(struct nsfb_palette_s *palette,
 		nsfb_colour_t c, int *r_error, int *g_error, int *b_error)
@@ -68,6 +122,12 @@ static inline uint8_t nsfb_palette_best_match(struct nsfb_palette_s *palette,
 	int col;
 	int dr, dg, db; /* delta red, green blue values */
 
+	const uint8_t *list; /* inverse colour map cell entries */
+	uint32_t offset;
+	int cell;
+	int count;
+	int entry;
+
 	int cur_distance;
 	int best_distance = INT_MAX;
 
@@ -112,8 +172,28 @@ static inline uint8_t nsfb_palette_best_match(struct nsfb_palette_s *palette,
 		break;
 
 	case NSFB_PALETTE_OTHER:
-		/* Try all colours in palette */
-		for (col = 0; col <= palette->last; col++) {
+		/* Try the colours which can match this colour's cell of the
+		 * inverse colour map, or all colours in palette if its list
+		 * could not be built */
+		list = NULL;
+		count = palette->last + 1;
+		if (palette->lut.cell != NULL) {
+			cell = ((r >> (8 - NSFB_PALETTE_LUT_BITS))
+					<< (2 * NSFB_PALETTE_LUT_BITS)) |
+				((g >> (8 - NSFB_PALETTE_LUT_BITS))
+					<< NSFB_PALETTE_LUT_BITS) |
+				(b >> (8 - NSFB_PALETTE_LUT_BITS));
+			offset = palette->lut.cell[cell];
+			if (offset == 0)
+				offset = nsfb_palette_lut_cell(palette, cell);
+			if (offset != 0) {
+				list = palette->lut.list + offset;
+				count = list[-1] + 1;
+			}
+		}
+
+		for (entry = 0; entry < count; entry++) {
+			col = (list != NULL) ? list[entry] : entry;
 			palent = palette->data[col];
 
 			dr = r - ( palent        & 0xFF);
@@ -137,6 +217,45 @@ static inline uint8_t nsfb_palette_best_match(struct nsfb_palette_s *palette,
         return best_col;
 }
 
+/** Find best palette match for given colour at a screen position, with
+ * ordered dithering.
+ *
+ * Each component is offset by up to half the palette's spacing for that
+ * component, according to an 8x8 Bayer threshold matrix indexed by the
+ * position. No state is carried between pixels.
+ */
+static inline uint8_t nsfb_palette_best_match_ordered(
+		struct nsfb_palette_s *palette, nsfb_colour_t c, int x, int y)
+{
+	static const uint8_t bayer[8][8] = {
+		{  0, 32,  8, 40,  2, 34, 10, 42 },
+		{ 48, 16, 56, 24, 50, 18, 58, 26 },
+		{ 12, 44,  4, 36, 14, 46,  6, 38 },
+		{ 60, 28, 52, 20, 62, 30, 54, 22 },
+		{  3, 35, 11, 43,  1, 33,  9, 41 },
+		{ 51, 19, 59, 27, 49, 17, 57, 25 },
+		{ 15, 47,  7, 39, 13, 45,  5, 37 },
+		{ 63, 31, 55, 23, 61, 29, 53, 21 }
+	};
+	int threshold = 2 * bayer[y & 7][x & 7] + 1 - 64; /* -63 to 63 */
+	int r, g, b;
+
+	r = ( c        & 0xFF) + threshold * palette->dither_step[0] / 128;
+	g = ((c >>  8) & 0xFF) + threshold * palette->dither_step[1] / 128;
+	b = ((c >> 16) & 0xFF) + threshold * palette->dither_step[2] / 128;
+
+	/* Clamp new RGB components to range */
+	if (r <   0) r =   0;
+	if (r > 255) r = 255;
+	if (g <   0) g =   0;
+	if (g > 255) g = 255;
+	if (b <   0) b =   0;
+	if (b > 255) b = 255;
+
+	return nsfb_palette_best_match(palette, r + (g << 8) + (b << 16),
+			&r, &g, &b);
+}
+
 /** Find best palette match for given colour, with error diffusion. */
 static inline uint8_t nsfb_palette_best_match_dither(
 		struct nsfb_palette_s *palette, nsfb_colour_t c)
@@ -150,9 +150,60 @@ typedef bool (nsfb_plotfn_cubic_bezier_t)(nsfb_t *nsfb, nsfb_bbox_t *curve, nsfb
 
 typedef bool (nsfb_plotfn_polylines_t)(nsfb_t *nsfb, int pointc, const nsfb_point_t *points, nsfb_plot_pen_t *pen);
 
+/** plot spans */
+typedef bool (nsfb_plotfn_spans_t)(nsfb_t *nsfb, int spanc, const nsfb_plot_span_t *spans, nsfb_colour_t c);
+
 /** plot path */
 typedef bool (nsfb_plotfn_path_t)(nsfb_t *nsfb, int pathc, nsfb_plot_pathop_t *pathop, nsfb_plot_pen_t *pen);
 
+/** Fill rows of video memory with a repeating 32bit pattern.
+ *
+ * Fills \a height rows, \a linelen bytes apart, each \a width bytes long
+ * starting at \a ptr. The pattern must be invariant to the alignment of the
+ * rows, i.e. either \a ptr and \a linelen are 32bit aligned or the pattern
+ * is a 16bit value repeated twice.
+ */
+typedef void (nsfb_fill_rows_t)(uint8_t *ptr, int linelen, int width, int height, uint32_t ent);
+
+/** Alpha blend a row of colours onto a row of pixels.
+ *
+ * The result must be identical to converting each pixel to a colour,
+ * blending with nsfb_plot_ablend() and converting back. Fully transparent
+ * source colours leave the destination untouched.
+ */
+typedef void (nsfb_blend_row_t)(void *dst, const nsfb_colour_t *src, int width);
+
+/** Expand whole bytes of a 1bpp glyph row onto a row of pixels.
+ *
+ * Each of the \a count bytes at \a bits covers eight pixels at \a dst,
+ * most significant bit first. Pixels whose bit is set are replaced with
+ * \a ent, the others are left untouched.
+ */
+typedef void (nsfb_glyph1_row_t)(void *dst, const uint8_t *bits, int count, uint32_t ent);
+
+/** Blend a colour onto rows of pixels through an 8bit coverage mask.
+ *
+ * Blends \a height rows of \a width pixels, \a linelen bytes apart starting
+ * at \a ptr, using the coverage bytes at \a cov, \a pitch bytes apart, as
+ * the alpha of colour \a c. The result must be identical to the scalar
+ * glyph8 plotter.
+ */
+typedef void (nsfb_glyph8_rows_t)(uint8_t *ptr, int linelen, const uint8_t *cov, int pitch, int width, int height, nsfb_colour_t c);
+
+/** Convert a row of colours to native pixels.
+ *
+ * Writes \a width pixels at \a dst converted from the colours at \a src
+ * exactly as the plotters colour_to_pixel() does.
+ */
+typedef void (nsfb_row_from_colour_t)(void *dst, const nsfb_colour_t *src, int width);
+
+/** Convert a row of native pixels to colours.
+ *
+ * Writes \a width colours at \a dst converted from the pixels at \a src
+ * exactly as the plotters pixel_to_colour() does.
+ */
+typedef void (nsfb_row_to_colour_t)(nsfb_colour_t *dst, const void *src, int width);
+
 /** plotter function table. */
 typedef struct nsfb_plotter_fns_s {
     nsfb_plotfn_clg_t *clg;
@@ -165,6 +216,7 @@ typedef struct nsfb_plotter_fns_s {
     nsfb_plotfn_ellipse_t *ellipse;
     nsfb_plotfn_ellipse_fill_t *ellipse_fill;
     nsfb_plotfn_arc_t *arc;
+    nsfb_plotfn_arc_t *pie;
     nsfb_plotfn_bitmap_t *bitmap;
     nsfb_plotfn_bitmap_tiles_t *bitmap_tiles;
     nsfb_plotfn_point_t *point;
@@ -176,9 +228,186 @@ typedef struct nsfb_plotter_fns_s {
     nsfb_plotfn_cubic_bezier_t *cubic;
     nsfb_plotfn_path_t *path;
     nsfb_plotfn_polylines_t *polylines;
+    nsfb_plotfn_spans_t *spans;
+
+    nsfb_fill_rows_t *fill_rows; /**< accelerated fill or NULL */
+    nsfb_blend_row_t *blend_row; /**< accelerated alpha blend or NULL */
+    nsfb_glyph1_row_t *glyph1_row; /**< accelerated glyph expansion or NULL */
+    nsfb_glyph8_rows_t *glyph8_rows; /**< accelerated coverage blend or NULL */
+    nsfb_row_from_colour_t *row_from_colour; /**< row conversion or NULL */
+    nsfb_row_to_colour_t *row_to_colour; /**< row conversion or NULL */
 } nsfb_plotter_fns_t;
 
 
 bool select_plotters(nsfb_t *nsfb);
 
+/** Processor features usable by the accelerated plotters */
+enum nsfb_cpu_feature_e {
+    NSFB_CPU_SSE2 = 1, /**< x86 SSE2 */
+    NSFB_CPU_AVX2 = 2, /**< x86 AVX2 */
+    NSFB_CPU_NEON = 4, /**< ARM Advanced SIMD */
+    NSFB_CPU_SSSE3 = 8, /**< x86 SSSE3 */
+};
+
+/** Obtain the features of the processor we are running on.
+ *
+ * @return A mask of ::nsfb_cpu_feature_e values.
+ */
+unsigned int nsfb_cpu_features(void);
+
+/** Select the fastest row fill routine the processor supports.
+ *
+ * @return The fill routine or NULL if the scalar plotters should be used.
+ */
+nsfb_fill_rows_t *nsfb_fill_rows_select(void);
+
+/** Select the fastest alpha blend routine for a pixel format.
+ *
+ * @param format The format of the destination pixels.
+ * @return The blend routine or NULL if the scalar plotters should be used.
+ */
+nsfb_blend_row_t *nsfb_blend_row_select(enum nsfb_format_e format);
+
+/** Select the fastest 1bpp glyph expansion routine for a pixel depth.
+ *
+ * @param bpp The depth of the destination pixels.
+ * @return The expansion routine or NULL if the scalar plotters should be used.
+ */
+nsfb_glyph1_row_t *nsfb_glyph1_row_select(int bpp);
+
+/** Select the fastest coverage blend routine for a pixel format.
+ *
+ * @param format The format of the destination pixels.
+ * @return The blend routine or NULL if the scalar plotters should be used.
+ */
+nsfb_glyph8_rows_t *nsfb_glyph8_rows_select(enum nsfb_format_e format);
+
+/** Select the row conversion from colours for a pixel format.
+ *
+ * @param format The format of the pixels.
+ * @return The fastest converter or NULL if the format has none.
+ */
+nsfb_row_from_colour_t *nsfb_row_from_colour_select(enum nsfb_format_e format);
+
+/** Select the row conversion to colours for a pixel format.
+ *
+ * @param format The format of the pixels.
+ * @return The fastest converter or NULL if the format has none.
+ */
+nsfb_row_to_colour_t *nsfb_row_to_colour_select(enum nsfb_format_e format);
+
+/** Stroke pattern of dotted rectangle outlines */
+#define NSFB_PLOT_PATTERN_DOTTED 0x55555555
+
+/** Stroke pattern of dashed rectangle outlines */
+#define NSFB_PLOT_PATTERN_DASHED 0x0F0F0F0F
+
+/** Stroke lines wider than a pixel.
+ *
+ * Each line is capped at both ends with the context's stroke caps and
+ * the pixels covered by any of them are filled once with the stroke
+ * colour. A pattern pen splits the lines into dashes, each pattern bit
+ * covering the stroke width, and the pattern carries on from one line
+ * into the next.
+ *
+ * @param nsfb The context to plot to.
+ * @param linec The number of lines.
+ * @param line The lines.
+ * @param pen The pen with the stroke width and colour.
+ * @return true on success or false if memory could not be allocated.
+ */
+bool nsfb_stroke_lines(nsfb_t *nsfb, int linec, const nsfb_bbox_t *line, const nsfb_plot_pen_t *pen);
+
+/** Stroke a polyline wider than a pixel.
+ *
+ * The segments meet with the context's stroke joins and an open polyline
+ * is capped at its ends. Each covered pixel is filled once with the stroke colour.
+ * A pattern pen splits the segments into dashes as ::nsfb_stroke_lines
+ * does and the joins are only added where the pattern is on.
+ *
+ * @param nsfb The context to plot to.
+ * @param pointc The number of points.
+ * @param points The points.
+ * @param closed Whether the last point joins back to the first.
+ * @param pen The pen with the stroke width and colour.
+ * @return true on success or false if memory could not be allocated.
+ */
+bool nsfb_stroke_polyline(nsfb_t *nsfb, int pointc, const nsfb_point_t *points, bool closed, const nsfb_plot_pen_t *pen);
+
+/** Stroke a rectangle outline wider than a pixel.
+ *
+ * The sides are centred on the rectangle's edges and meet with mitered
+ * corners. The pattern runs around the rectangle from its top left.
+ *
+ * @param nsfb The context to plot to.
+ * @param rect The rectangle.
+ * @param line_width The width of the outline.
+ * @param c The colour of the outline.
+ * @param pattern The stroke pattern, with every bit set for a solid outline.
+ * @return true on success or false if memory could not be allocated.
+ */
+bool nsfb_stroke_rectangle(nsfb_t *nsfb, const nsfb_bbox_t *rect, int line_width, nsfb_colour_t c, uint32_t pattern);
+
+/** Source sampling state for plotting a scaled bitmap.
+ *
+ * The source columns of the plotted part of each destination row are
+ * computed once per bitmap so each row only has to look them up.
+ */
+struct nsfb_scale_s {
+    nsfb_plot_filter_t filter; /**< filter in use */
+    bool alpha; /**< weight colours by their alpha */
+
+    const nsfb_colour_t *pixel; /**< source bitmap */
+    int bmp_width; /**< source width */
+    int bmp_height; /**< source height */
+    int bmp_stride; /**< source row stride in colours */
+    int height; /**< destination height */
+    int rwidth; /**< number of destination columns plotted */
+
+    int *col; /**< rwidth + 1 source column boundaries */
+    int *col_right; /**< bilinear right hand source columns */
+    unsigned int *col_frac; /**< bilinear right hand weights, 0 to 256 */
+    nsfb_colour_t *row; /**< last sampled row of colours */
+
+    int row_top; /**< first source row of the last sampled row */
+    int row_bottom; /**< last source row or bilinear weight */
+
+    nsfb_t *nsfb; /**< context the sampling storage is scratch of */
+    size_t mark; /**< scratch arena position before the storage */
+};
+
+/** Prepare to sample a bitmap scaled to a new size.
+ *
+ * The sampling storage is drawn from the context's scratch arena, so
+ * samplers must be finalised in the reverse order they were initialised.
+ *
+ * @param scale The state to initialise.
+ * @param nsfb The context to draw scratch storage from.
+ * @param pixel The source bitmap.
+ * @param bmp_width The width of the source bitmap.
+ * @param bmp_height The height of the source bitmap.
+ * @param bmp_stride The row stride of the source bitmap in colours.
+ * @param width The destination width.
+ * @param height The destination height.
+ * @param xoff The first destination column plotted.
+ * @param rwidth The number of destination columns plotted.
+ * @param filter The filter to sample with.
+ * @param alpha Whether colours are weighted by their alpha.
+ * @return true on success or false if a size is not positive or memory
+ *         could not be allocated.
+ */
+bool nsfb_scale_init(struct nsfb_scale_s *scale, nsfb_t *nsfb, const nsfb_colour_t *pixel, int bmp_width, int bmp_height, int bmp_stride, int width, int height, int xoff, int rwidth, nsfb_plot_filter_t filter, bool alpha);
+
+/** Sample one destination row of a scaled bitmap.
+ *
+ * @param scale The sampling state.
+ * @param y The destination row, relative to the top of the bitmap.
+ * @param repeat Set to true if the row is the same as the previous one.
+ * @return The rwidth sampled colours, valid until the next call.
+ */
+const nsfb_colour_t *nsfb_scale_row(struct nsfb_scale_s *scale, int y, bool *repeat);
+
+/** Release the resources of a scaled bitmap sampler. */
+void nsfb_scale_fini(struct nsfb_scale_s *scale);
+
 #endif
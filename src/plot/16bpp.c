@@ -63,11 +63,19 @@ static bool fill(nsfb_t *nsfb, nsfb_bbox_t *rect, nsfb_colour_t c)
 
         pvid16 = get_xy_loc(nsfb, rect->x0, rect->y0);
 
-        if (((rect->x0 & 1) == 0) && ((width & 1) == 0)) {
+        if (nsfb->plotter_fns->fill_rows != NULL) {
+                ent32 = ent16 | ((uint32_t)ent16 << 16);
+                nsfb->plotter_fns->fill_rows((uint8_t *)pvid16, nsfb->linelen,
+                                             width << 1, height, ent32);
+                return true;
+        }
+
+        if (((rect->x0 & 1) == 0) && ((width & 1) == 0) &&
+            ((nsfb->linelen & 3) == 0)) {
                 /* aligned to 32bit value and width is even */
                 width = width >> 1;
                 llen = (nsfb->linelen >> 2) - width;
-                ent32 = ent16 | (ent16 << 16);
+                ent32 = ent16 | ((uint32_t)ent16 << 16);
                 pvid32 = (void *)pvid16;
 
                 while (height-- > 0) {
@@ -110,7 +118,9 @@ static bool fill(nsfb_t *nsfb, nsfb_bbox_t *rect, nsfb_colour_t c)
 
 const nsfb_plotter_fns_t _nsfb_16bpp_plotters = {
         .line = line,
+        .rectangle = rectangle,
         .fill = fill,
+        .spans = spans,
         .point = point,
         .bitmap = bitmap,
         .bitmap_tiles = bitmap_tiles,
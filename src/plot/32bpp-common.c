@@ -28,6 +28,12 @@ static bool fill(nsfb_t *nsfb, nsfb_bbox_t *rect, nsfb_colour_t c)
 
         pvid = get_xy_loc(nsfb, rect->x0, rect->y0);
 
+        if (nsfb->plotter_fns->fill_rows != NULL) {
+                nsfb->plotter_fns->fill_rows((uint8_t *)pvid, nsfb->linelen,
+                                             width << 2, height, ent);
+                return true;
+        }
+
         while (height-- > 0) {
                 w = width;
                 while (w >= 16) {
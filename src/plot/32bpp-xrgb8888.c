@@ -93,7 +93,9 @@ static inline uint32_t colour_to_pixel(UNUSED nsfb_t *nsfb, nsfb_colour_t c)
 
 const nsfb_plotter_fns_t _nsfb_32bpp_xrgb8888_plotters = {
         .line = line,
+        .rectangle = rectangle,
         .fill = fill,
+        .spans = spans,
         .point = point,
         .bitmap = bitmap,
         .bitmap_tiles = bitmap_tiles,
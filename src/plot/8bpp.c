@@ -69,7 +69,9 @@ static bool fill(nsfb_t *nsfb, nsfb_bbox_t *rect, nsfb_colour_t c)
 
 const nsfb_plotter_fns_t _nsfb_8bpp_plotters = {
         .line = line,
+        .rectangle = rectangle,
         .fill = fill,
+        .spans = spans,
         .point = point,
         .bitmap = bitmap,
         .bitmap_tiles = bitmap_tiles,
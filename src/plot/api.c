@@ -6,6 +6,7 @@
 #include "libnsfb_plot.h"
 
 #include "nsfb.h"
+#include "palette.h"
 #include "plot.h"
 
 /** Sets a clip rectangle for subsequent plots.
@@ -30,6 +31,9 @@ bool nsfb_plot_get_clip(nsfb_t *nsfb, nsfb_bbox_t *clip)
  */
 bool nsfb_plot_clg(nsfb_t *nsfb, nsfb_colour_t c)
 {
+    if (nsfb->dlist.recording)
+        return nsfb_dlist_clg(nsfb, c);
+
     return nsfb->plotter_fns->clg(nsfb, c);
 }
 
@@ -46,6 +50,9 @@ nsfb_plot_rectangle(nsfb_t *nsfb,
                     bool dotted, 
                     bool dashed)
 {
+    if (nsfb->dlist.recording)
+        return nsfb_dlist_rectangle(nsfb, rect, line_width, c, dotted, dashed);
+
     return nsfb->plotter_fns->rectangle(nsfb, rect, line_width, c, dotted, dashed);
 
 }
@@ -56,6 +63,9 @@ nsfb_plot_rectangle(nsfb_t *nsfb,
  */
 bool nsfb_plot_rectangle_fill(nsfb_t *nsfb, nsfb_bbox_t *rect, nsfb_colour_t c)
 {
+    if (nsfb->dlist.recording)
+        return nsfb_dlist_fill(nsfb, rect, c);
+
     return nsfb->plotter_fns->fill(nsfb, rect, c);
 }
 
@@ -66,6 +76,9 @@ bool nsfb_plot_rectangle_fill(nsfb_t *nsfb, nsfb_bbox_t *rect, nsfb_colour_t c)
  */
 bool nsfb_plot_line(nsfb_t *nsfb, nsfb_bbox_t *line, nsfb_plot_pen_t *pen)
 {
+	if (nsfb->dlist.recording)
+		return nsfb_dlist_lines(nsfb, 1, line, pen);
+
 	return nsfb->plotter_fns->line(nsfb, 1, line, pen);
 }
 
@@ -76,14 +89,30 @@ bool nsfb_plot_line(nsfb_t *nsfb, nsfb_bbox_t *line, nsfb_plot_pen_t *pen)
  */
 bool nsfb_plot_lines(nsfb_t *nsfb, int linec, nsfb_bbox_t *line, nsfb_plot_pen_t *pen)
 {
+	if (nsfb->dlist.recording)
+		return nsfb_dlist_lines(nsfb, linec, line, pen);
+
 	return nsfb->plotter_fns->line(nsfb, linec, line, pen);
 }
 
 bool nsfb_plot_polylines(nsfb_t *nsfb, int pointc, const nsfb_point_t *points, nsfb_plot_pen_t *pen)
 {
+	if (nsfb->dlist.recording)
+		return nsfb_dlist_polylines(nsfb, pointc, points, pen);
+
 	return nsfb->plotter_fns->polylines(nsfb, pointc, points, pen);
 }
 
+/** Plots a list of spans in one colour.
+ */
+bool nsfb_plot_spans(nsfb_t *nsfb, int spanc, const nsfb_plot_span_t *spans, nsfb_colour_t c)
+{
+	if (nsfb->dlist.recording)
+		return nsfb_dlist_spans(nsfb, spanc, spans, c);
+
+	return nsfb->plotter_fns->spans(nsfb, spanc, spans, c);
+}
+
 /** Plots a filled polygon. 
  *
  * Plots a filled polygon with straight lines between points. The lines around
@@ -94,6 +123,9 @@ bool nsfb_plot_polylines(nsfb_t *nsfb, int pointc, const nsfb_point_t *points, n
  */
 bool nsfb_plot_polygon(nsfb_t *nsfb, const int *p, unsigned int n, nsfb_colour_t fill)
 {
+    if (nsfb->dlist.recording)
+        return nsfb_dlist_polygon(nsfb, p, n, fill);
+
     return nsfb->plotter_fns->polygon(nsfb, p, n, fill);
 }
 
@@ -104,25 +136,50 @@ bool nsfb_plot_polygon(nsfb_t *nsfb, const int *p, unsigned int n, nsfb_colour_t
  */
 bool nsfb_plot_arc(nsfb_t *nsfb, int x, int y, int radius, int angle1, int angle2, nsfb_colour_t c)
 {
+    if (nsfb->dlist.recording)
+        return nsfb_dlist_arc(nsfb, x, y, radius, angle1, angle2, c);
+
     return nsfb->plotter_fns->arc(nsfb, x, y, radius, angle1, angle2, c);
 }
 
+/** Plots a filled pie slice.
+ *
+ * The sector of the circle around (x,y) swept anticlockwise from angle1 to
+ * angle2, as for nsfb_plot_arc(), is filled.
+ */
+bool nsfb_plot_pie(nsfb_t *nsfb, int x, int y, int radius, int angle1, int angle2, nsfb_colour_t c)
+{
+    if (nsfb->dlist.recording)
+        return nsfb_dlist_pie(nsfb, x, y, radius, angle1, angle2, c);
+
+    return nsfb->plotter_fns->pie(nsfb, x, y, radius, angle1, angle2, c);
+}
+
 /** Plots an alpha blended pixel.
  *
  * plots an alpha blended pixel.
  */
 bool nsfb_plot_point(nsfb_t *nsfb, int x, int y, nsfb_colour_t c)
 {
+    if (nsfb->dlist.recording)
+        return nsfb_dlist_point(nsfb, x, y, c);
+
     return nsfb->plotter_fns->point(nsfb, x, y, c);
 }
 
 bool nsfb_plot_ellipse(nsfb_t *nsfb, nsfb_bbox_t *ellipse, nsfb_colour_t c)
 {
+    if (nsfb->dlist.recording)
+        return nsfb_dlist_ellipse(nsfb, ellipse, c);
+
     return nsfb->plotter_fns->ellipse(nsfb, ellipse, c);
 }
 
 bool nsfb_plot_ellipse_fill(nsfb_t *nsfb, nsfb_bbox_t *ellipse, nsfb_colour_t c)
 {
+    if (nsfb->dlist.recording)
+        return nsfb_dlist_ellipse_fill(nsfb, ellipse, c);
+
     return nsfb->plotter_fns->ellipse_fill(nsfb, ellipse, c);
 }
 
@@ -139,6 +196,13 @@ nsfb_plot_copy(nsfb_t *srcfb,
     bool trans = false;
     nsfb_colour_t srccol;
 
+    /* the source is read now so recorded plots to either surface must
+     * be done first */
+    nsfb_dlist_execute(srcfb);
+    if (dstfb != srcfb) {
+	nsfb_dlist_execute(dstfb);
+    }
+
     if (srcfb == dstfb) {
 	return dstfb->plotter_fns->copy(srcfb, srcbox, dstbox);
     }
@@ -163,13 +227,82 @@ nsfb_plot_copy(nsfb_t *srcfb,
     
 }
 
+/** Set the filter used to scale bitmaps.
+ */
+bool nsfb_plot_set_bitmap_filter(nsfb_t *nsfb, nsfb_plot_filter_t filter)
+{
+    switch (filter) {
+    case NSFB_PLOT_FILTER_NEAREST:
+    case NSFB_PLOT_FILTER_BOX:
+    case NSFB_PLOT_FILTER_BILINEAR:
+        nsfb->bitmap_filter = filter;
+        return true;
+    }
+
+    return false;
+}
+
+/** Set the caps and joins of strokes wider than a pixel.
+ */
+bool nsfb_plot_set_stroke_style(nsfb_t *nsfb, nsfb_plot_cap_t cap, nsfb_plot_join_t join)
+{
+    switch (cap) {
+    case NSFB_PLOT_CAP_BUTT:
+    case NSFB_PLOT_CAP_SQUARE:
+        break;
+
+    default:
+        return false;
+    }
+
+    switch (join) {
+    case NSFB_PLOT_JOIN_MITER:
+    case NSFB_PLOT_JOIN_BEVEL:
+        break;
+
+    default:
+        return false;
+    }
+
+    nsfb->stroke_cap = cap;
+    nsfb->stroke_join = join;
+
+    return true;
+}
+
+/** Set the dithering used to plot bitmaps.
+ */
+bool nsfb_plot_set_dither(nsfb_t *nsfb, nsfb_plot_dither_t dither)
+{
+    if (nsfb->palette == NULL)
+        return false;
+
+    /* recorded bitmaps are plotted with the dithering they were made with */
+    nsfb_dlist_execute(nsfb);
+
+    switch (dither) {
+    case NSFB_PLOT_DITHER_ERROR_DIFFUSION:
+    case NSFB_PLOT_DITHER_ORDERED:
+        nsfb_palette_dither_set_type(nsfb->palette, dither);
+        return true;
+    }
+
+    return false;
+}
+
 bool nsfb_plot_bitmap(nsfb_t *nsfb, const nsfb_bbox_t *loc, const nsfb_colour_t *pixel, int bmp_width, int bmp_height, int bmp_stride, bool alpha)
 {
+    if (nsfb->dlist.recording)
+        return nsfb_dlist_bitmap(nsfb, loc, pixel, bmp_width, bmp_height, bmp_stride, alpha);
+
     return nsfb->plotter_fns->bitmap(nsfb, loc, pixel, bmp_width, bmp_height, bmp_stride, alpha);
 }
 
 bool nsfb_plot_bitmap_tiles(nsfb_t *nsfb, const nsfb_bbox_t *loc, int tiles_x, int tiles_y, const nsfb_colour_t *pixel, int bmp_width, int bmp_height, int bmp_stride, bool alpha)
 {
+    if (nsfb->dlist.recording)
+        return nsfb_dlist_bitmap_tiles(nsfb, loc, tiles_x, tiles_y, pixel, bmp_width, bmp_height, bmp_stride, alpha);
+
     return nsfb->plotter_fns->bitmap_tiles(nsfb, loc, tiles_x, tiles_y, pixel, bmp_width, bmp_height, bmp_stride, alpha);
 }
 
@@ -177,6 +310,9 @@ bool nsfb_plot_bitmap_tiles(nsfb_t *nsfb, const nsfb_bbox_t *loc, int tiles_x, i
  */
 bool nsfb_plot_glyph8(nsfb_t *nsfb, nsfb_bbox_t *loc, const uint8_t *pixel, int pitch, nsfb_colour_t c)
 {
+    if (nsfb->dlist.recording)
+        return nsfb_dlist_glyph8(nsfb, loc, pixel, pitch, c);
+
     return nsfb->plotter_fns->glyph8(nsfb, loc, pixel, pitch, c);
 }
 
@@ -185,31 +321,66 @@ bool nsfb_plot_glyph8(nsfb_t *nsfb, nsfb_bbox_t *loc, const uint8_t *pixel, int
  */
 bool nsfb_plot_glyph1(nsfb_t *nsfb, nsfb_bbox_t *loc, const uint8_t *pixel, int pitch, nsfb_colour_t c)
 {
+    if (nsfb->dlist.recording)
+        return nsfb_dlist_glyph1(nsfb, loc, pixel, pitch, c);
+
     return nsfb->plotter_fns->glyph1(nsfb, loc, pixel, pitch, c);
 }
 
 /* read a rectangle from screen into buffer */
 bool nsfb_plot_readrect(nsfb_t *nsfb, nsfb_bbox_t *rect, nsfb_colour_t *buffer)
 {
+    /* the recorded plots must be on the surface before it is read */
+    nsfb_dlist_execute(nsfb);
+
     return nsfb->plotter_fns->readrect(nsfb, rect, buffer);
 }
 
 
 bool nsfb_plot_cubic_bezier(nsfb_t *nsfb, nsfb_bbox_t *curve, nsfb_point_t *ctrla, nsfb_point_t *ctrlb, nsfb_plot_pen_t *pen)
 {
+    if (nsfb->dlist.recording)
+        return nsfb_dlist_cubic(nsfb, curve, ctrla, ctrlb, pen);
+
     return nsfb->plotter_fns->cubic(nsfb, curve, ctrla, ctrlb, pen);
 }
 
 bool nsfb_plot_quadratic_bezier(nsfb_t *nsfb, nsfb_bbox_t *curve, nsfb_point_t *ctrla, nsfb_plot_pen_t *pen)
 {
+    if (nsfb->dlist.recording)
+        return nsfb_dlist_quadratic(nsfb, curve, ctrla, pen);
+
     return nsfb->plotter_fns->quadratic(nsfb, curve, ctrla, pen);
 }
 
 bool nsfb_plot_path(nsfb_t *nsfb, int pathc, nsfb_plot_pathop_t *pathop, nsfb_plot_pen_t *pen)
 {
+    if (nsfb->dlist.recording)
+        return nsfb_dlist_path(nsfb, pathc, pathop, pen);
+
     return nsfb->plotter_fns->path(nsfb, pathc, pathop, pen);
 }
 
+/** Start recording plot calls.
+ *
+ * Recorded plot calls are kept in a display list until it is flushed.
+ */
+bool nsfb_plot_record(nsfb_t *nsfb)
+{
+    nsfb->dlist.recording = true;
+
+    return true;
+}
+
+/** Plot the recorded calls and stop recording.
+ */
+bool nsfb_plot_flush(nsfb_t *nsfb)
+{
+    nsfb->dlist.recording = false;
+
+    return nsfb_dlist_execute(nsfb);
+}
+
 /*
  * Local variables:
  *  c-basic-offset: 4
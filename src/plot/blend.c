@@ -0,0 +1,985 @@
+/*
+ * Copyright 2026 libnsfb contributors
+ *
+ * This file is part of libnsfb, http://www.netsurf-browser.org/
+ * Licenced under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/** \file
+ * Accelerated alpha and coverage blending (implementation).
+ *
+ * The blend is performed directly in the pixel's channel order; the source
+ * colours are swizzled in register so no per-pixel pixel_to_colour() and
+ * colour_to_pixel() round trip is needed. Each channel is computed as
+ *
+ *   (src * alpha + dst * (256 - alpha)) >> 8
+ *
+ * exactly as nsfb_plot_ablend() does, so results are bit identical to the
+ * scalar plotters. Groups of source pixels which are entirely transparent
+ * are skipped and groups which are entirely opaque are stored directly.
+ *
+ * Anti-aliased glyphs are blended from their coverage masks in the same
+ * way, for the 32bpp formats and RGB565. The foreground colour is converted
+ * and expanded to vector lanes once per glyph and each coverage byte is
+ * used directly as the alpha of its pixel. Runs of eight coverage bytes
+ * which are all clear or all set are skipped or stored without blending.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libnsfb.h"
+#include "libnsfb_plot.h"
+#include "libnsfb_plot_util.h"
+
+#include "nsfb.h"
+#include "plot.h"
+
+#ifndef NSFB_BE_BYTE_ORDER
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define NSFB_BLEND_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#define NSFB_BLEND_NEON 1
+#include <arm_neon.h>
+#endif
+
+#endif /* NSFB_BE_BYTE_ORDER */
+
+#if defined(NSFB_BLEND_X86) || defined(NSFB_BLEND_NEON)
+
+/**
+ * convert a colour to a little endian 32bpp pixel.
+ *
+ * \param c The colour to convert.
+ * \param swap true if the red and blue channels must be exchanged.
+ * \return The pixel value.
+ */
+static inline uint32_t blend_colour_to_pixel(nsfb_colour_t c, bool swap)
+{
+	if (swap)
+		return ((c & 0xff0000) >> 16) | (c & 0xff00) | ((c & 0xff) << 16);
+	return c;
+}
+
+/**
+ * Blend a single colour onto a little endian 32bpp pixel.
+ */
+static inline void blend_one(uint32_t *dst, nsfb_colour_t c, bool swap)
+{
+	if ((c & 0xFF000000) == 0)
+		return;
+
+	if ((c & 0xFF000000) != 0xFF000000) {
+		/* channels are independent so blend in pixel order */
+		*dst = nsfb_plot_ablend(blend_colour_to_pixel(c, swap) |
+					(c & 0xFF000000), *dst);
+	} else {
+		*dst = blend_colour_to_pixel(c, swap);
+	}
+}
+
+/**
+ * Blend a foreground pixel onto a little endian 32bpp pixel by coverage.
+ *
+ * \param dst The pixel to blend onto.
+ * \param a The coverage of the pixel.
+ * \param fp The foreground colour in pixel order without alpha.
+ * \param op The pixel to store for full coverage.
+ */
+static inline void glyph8_one32(uint32_t *dst, unsigned int a, uint32_t fp, uint32_t op)
+{
+	if (a == 0)
+		return;
+
+	if (a != 0xFF) {
+		*dst = nsfb_plot_ablend((a << 24) | fp, *dst);
+	} else {
+		*dst = op;
+	}
+}
+
+/**
+ * convert a RGB565 pixel to a colour, as the 16bpp plotters do.
+ */
+static inline nsfb_colour_t glyph8_565_to_colour(uint16_t pixel)
+{
+	return ((pixel & 0x1F) << 19) |
+		((pixel & 0x7E0) << 5) |
+		((pixel & 0xF800) >> 8);
+}
+
+/**
+ * convert a colour to a RGB565 pixel, as the 16bpp plotters do.
+ */
+static inline uint16_t glyph8_colour_to_565(nsfb_colour_t c)
+{
+	return ((c & 0xF8) << 8) | ((c & 0xFC00 ) >> 5) | ((c & 0xF80000) >> 19);
+}
+
+/**
+ * Blend a colour onto a RGB565 pixel by coverage.
+ */
+static inline void glyph8_one16(uint16_t *dst, unsigned int a, nsfb_colour_t c, uint16_t op)
+{
+	if (a == 0)
+		return;
+
+	if (a != 0xFF) {
+		*dst = glyph8_colour_to_565(nsfb_plot_ablend((a << 24) | c,
+					glyph8_565_to_colour(*dst)));
+	} else {
+		*dst = op;
+	}
+}
+
+/**
+ * Load eight coverage bytes as one value for the run tests.
+ */
+static inline uint64_t glyph8_run(const uint8_t *cov)
+{
+	uint64_t run;
+
+	memcpy(&run, cov, sizeof(run));
+	return run;
+}
+
+#endif
+
+#ifdef NSFB_BLEND_X86
+
+/**
+ * Swizzle source colours into pixel channel order
+ *
+ * For xrgb the red and blue channels are swapped and the alpha channel is
+ * dropped, as the scalar colour_to_pixel() does. xbgr colours are already
+ * in pixel order.
+ */
+static inline __m128i blend_swizzle_sse2(__m128i s, bool swap)
+{
+	__m128i rb;
+
+	if (!swap)
+		return s;
+
+	rb = _mm_and_si128(s, _mm_set1_epi32(0x00FF00FF));
+	rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+	return _mm_or_si128(_mm_and_si128(rb, _mm_set1_epi32(0x00FF00FF)),
+			    _mm_and_si128(s, _mm_set1_epi32(0x0000FF00)));
+}
+
+/**
+ * Blend two pixels held in the 16bit lanes of \a s and \a d
+ */
+static inline __m128i blend_lanes_sse2(__m128i s, __m128i d)
+{
+	__m128i a;
+	__m128i t;
+
+	/* broadcast each pixels alpha to all four of its lanes */
+	a = _mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3));
+	a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+	t = _mm_sub_epi16(_mm_set1_epi16(0x100), a);
+
+	return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(s, a),
+					    _mm_mullo_epi16(d, t)), 8);
+}
+
+static inline void
+blend_row_sse2(uint32_t *dst, const nsfb_colour_t *src, int width, bool swap)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i rgbmask = _mm_set1_epi32(0x00FFFFFF);
+	__m128i s, sp, d, a, lo, hi, blend, opaque, transp;
+
+	for (; width >= 4; width -= 4, dst += 4, src += 4) {
+		s = _mm_loadu_si128((const void *)src);
+		a = _mm_srli_epi32(s, 24);
+
+		transp = _mm_cmpeq_epi32(a, zero);
+		if (_mm_movemask_ps(_mm_castsi128_ps(transp)) == 0xF) {
+			/* all transparent, nothing to do */
+			continue;
+		}
+
+		/* source in pixel order, as stored for opaque pixels */
+		sp = blend_swizzle_sse2(s, swap);
+
+		opaque = _mm_cmpeq_epi32(a, _mm_set1_epi32(0xFF));
+		if (_mm_movemask_ps(_mm_castsi128_ps(opaque)) == 0xF) {
+			/* all opaque, plain store */
+			_mm_storeu_si128((void *)dst, sp);
+			continue;
+		}
+
+		d = _mm_loadu_si128((const void *)dst);
+
+		/* swizzled colour channels with alpha kept for the blend */
+		s = _mm_or_si128(_mm_and_si128(sp, rgbmask),
+				 _mm_andnot_si128(rgbmask, s));
+
+		lo = blend_lanes_sse2(_mm_unpacklo_epi8(s, zero),
+				      _mm_unpacklo_epi8(d, zero));
+		hi = blend_lanes_sse2(_mm_unpackhi_epi8(s, zero),
+				      _mm_unpackhi_epi8(d, zero));
+		blend = _mm_and_si128(_mm_packus_epi16(lo, hi), rgbmask);
+
+		/* opaque pixels take the source, transparent keep the dest */
+		blend = _mm_or_si128(_mm_andnot_si128(opaque, blend),
+				     _mm_and_si128(opaque, sp));
+		blend = _mm_or_si128(_mm_andnot_si128(transp, blend),
+				     _mm_and_si128(transp, d));
+
+		_mm_storeu_si128((void *)dst, blend);
+	}
+
+	for (; width > 0; width--)
+		blend_one(dst++, *src++, swap);
+}
+
+static void blend_row_xrgb_sse2(void *dst, const nsfb_colour_t *src, int width)
+{
+	blend_row_sse2(dst, src, width, true);
+}
+
+static void blend_row_xbgr_sse2(void *dst, const nsfb_colour_t *src, int width)
+{
+	blend_row_sse2(dst, src, width, false);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i blend_swizzle_avx2(__m256i s, bool swap)
+{
+	__m256i rb;
+
+	if (!swap)
+		return s;
+
+	rb = _mm256_and_si256(s, _mm256_set1_epi32(0x00FF00FF));
+	rb = _mm256_or_si256(_mm256_slli_epi32(rb, 16),
+			     _mm256_srli_epi32(rb, 16));
+	return _mm256_or_si256(_mm256_and_si256(rb,
+						_mm256_set1_epi32(0x00FF00FF)),
+			       _mm256_and_si256(s,
+						_mm256_set1_epi32(0x0000FF00)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i blend_lanes_avx2(__m256i s, __m256i d)
+{
+	__m256i a;
+	__m256i t;
+
+	a = _mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3));
+	a = _mm256_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+	t = _mm256_sub_epi16(_mm256_set1_epi16(0x100), a);
+
+	return _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(s, a),
+						  _mm256_mullo_epi16(d, t)), 8);
+}
+
+__attribute__((target("avx2")))
+static inline void
+blend_row_avx2(uint32_t *dst, const nsfb_colour_t *src, int width, bool swap)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i rgbmask = _mm256_set1_epi32(0x00FFFFFF);
+	__m256i s, sp, d, a, lo, hi, blend, opaque, transp;
+
+	for (; width >= 8; width -= 8, dst += 8, src += 8) {
+		s = _mm256_loadu_si256((const void *)src);
+		a = _mm256_srli_epi32(s, 24);
+
+		transp = _mm256_cmpeq_epi32(a, zero);
+		if (_mm256_movemask_ps(_mm256_castsi256_ps(transp)) == 0xFF) {
+			/* all transparent, nothing to do */
+			continue;
+		}
+
+		/* source in pixel order, as stored for opaque pixels */
+		sp = blend_swizzle_avx2(s, swap);
+
+		opaque = _mm256_cmpeq_epi32(a, _mm256_set1_epi32(0xFF));
+		if (_mm256_movemask_ps(_mm256_castsi256_ps(opaque)) == 0xFF) {
+			/* all opaque, plain store */
+			_mm256_storeu_si256((void *)dst, sp);
+			continue;
+		}
+
+		d = _mm256_loadu_si256((const void *)dst);
+
+		/* swizzled colour channels with alpha kept for the blend */
+		s = _mm256_or_si256(_mm256_and_si256(sp, rgbmask),
+				    _mm256_andnot_si256(rgbmask, s));
+
+		/* the unpacks and pack work within 128bit lanes so the
+		 * pixel order is preserved */
+		lo = blend_lanes_avx2(_mm256_unpacklo_epi8(s, zero),
+				      _mm256_unpacklo_epi8(d, zero));
+		hi = blend_lanes_avx2(_mm256_unpackhi_epi8(s, zero),
+				      _mm256_unpackhi_epi8(d, zero));
+		blend = _mm256_and_si256(_mm256_packus_epi16(lo, hi), rgbmask);
+
+		/* opaque pixels take the source, transparent keep the dest */
+		blend = _mm256_blendv_epi8(blend, sp, opaque);
+		blend = _mm256_blendv_epi8(blend, d, transp);
+
+		_mm256_storeu_si256((void *)dst, blend);
+	}
+
+	blend_row_sse2(dst, src, width, swap);
+}
+
+__attribute__((target("avx2")))
+static void blend_row_xrgb_avx2(void *dst, const nsfb_colour_t *src, int width)
+{
+	blend_row_avx2(dst, src, width, true);
+}
+
+__attribute__((target("avx2")))
+static void blend_row_xbgr_avx2(void *dst, const nsfb_colour_t *src, int width)
+{
+	blend_row_avx2(dst, src, width, false);
+}
+
+/**
+ * Blend the foreground onto four pixels by coverage
+ *
+ * \param dst The pixels to blend onto.
+ * \param a The coverage of each pixel replicated to all its bytes.
+ * \param fg The foreground channels of two pixels in 16bit lanes.
+ * \param opv The pixel to store for full coverage in every lane.
+ */
+static inline void
+glyph8_quad_sse2(uint32_t *dst, __m128i a, __m128i fg, __m128i opv)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i rgbmask = _mm_set1_epi32(0x00FFFFFF);
+	const __m128i full = _mm_set1_epi16(0x100);
+	__m128i d, al, lo, hi, blend, opaque, transp;
+
+	d = _mm_loadu_si128((const void *)dst);
+
+	al = _mm_unpacklo_epi8(a, zero);
+	lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(fg, al),
+			_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero),
+					_mm_sub_epi16(full, al))), 8);
+	al = _mm_unpackhi_epi8(a, zero);
+	hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(fg, al),
+			_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero),
+					_mm_sub_epi16(full, al))), 8);
+	blend = _mm_and_si128(_mm_packus_epi16(lo, hi), rgbmask);
+
+	/* full coverage takes the foreground, none keeps the dest */
+	opaque = _mm_cmpeq_epi32(a, _mm_set1_epi32(-1));
+	transp = _mm_cmpeq_epi32(a, zero);
+	blend = _mm_or_si128(_mm_andnot_si128(opaque, blend),
+			     _mm_and_si128(opaque, opv));
+	blend = _mm_or_si128(_mm_andnot_si128(transp, blend),
+			     _mm_and_si128(transp, d));
+
+	_mm_storeu_si128((void *)dst, blend);
+}
+
+static inline void
+glyph8_rows32_sse2(uint8_t *ptr, int linelen,
+		   const uint8_t *cov, int pitch,
+		   int width, int height,
+		   nsfb_colour_t c, bool swap)
+{
+	const uint32_t fp = blend_colour_to_pixel(c & 0xFFFFFF, swap);
+	const uint32_t op = blend_colour_to_pixel(c | 0xFF000000, swap);
+	const __m128i fg = _mm_unpacklo_epi8(_mm_set1_epi32(fp),
+					     _mm_setzero_si128());
+	const __m128i opv = _mm_set1_epi32(op);
+	uint32_t *dst;
+	uint64_t run;
+	__m128i a;
+	int x;
+
+	for (; height > 0; height--, ptr += linelen, cov += pitch) {
+		dst = (void *)ptr;
+
+		for (x = 0; x + 8 <= width; x += 8) {
+			run = glyph8_run(cov + x);
+			if (run == 0)
+				continue;
+
+			if (run == UINT64_MAX) {
+				_mm_storeu_si128((void *)(dst + x), opv);
+				_mm_storeu_si128((void *)(dst + x + 4), opv);
+				continue;
+			}
+
+			a = _mm_loadl_epi64((const void *)(cov + x));
+			a = _mm_unpacklo_epi8(a, a);
+			glyph8_quad_sse2(dst + x, _mm_unpacklo_epi16(a, a),
+					 fg, opv);
+			glyph8_quad_sse2(dst + x + 4, _mm_unpackhi_epi16(a, a),
+					 fg, opv);
+		}
+
+		for (; x < width; x++)
+			glyph8_one32(dst + x, cov[x], fp, op);
+	}
+}
+
+static void
+glyph8_rows_xrgb_sse2(uint8_t *ptr, int linelen, const uint8_t *cov, int pitch,
+		      int width, int height, nsfb_colour_t c)
+{
+	glyph8_rows32_sse2(ptr, linelen, cov, pitch, width, height, c, true);
+}
+
+static void
+glyph8_rows_xbgr_sse2(uint8_t *ptr, int linelen, const uint8_t *cov, int pitch,
+		      int width, int height, nsfb_colour_t c)
+{
+	glyph8_rows32_sse2(ptr, linelen, cov, pitch, width, height, c, false);
+}
+
+__attribute__((target("avx2")))
+static inline void
+glyph8_rows32_avx2(uint8_t *ptr, int linelen,
+		   const uint8_t *cov, int pitch,
+		   int width, int height,
+		   nsfb_colour_t c, bool swap)
+{
+	const uint32_t fp = blend_colour_to_pixel(c & 0xFFFFFF, swap);
+	const uint32_t op = blend_colour_to_pixel(c | 0xFF000000, swap);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i rgbmask = _mm256_set1_epi32(0x00FFFFFF);
+	const __m256i full = _mm256_set1_epi16(0x100);
+	const __m256i fg = _mm256_unpacklo_epi8(_mm256_set1_epi32(fp), zero);
+	const __m256i opv = _mm256_set1_epi32(op);
+	/* replicates coverage bytes 0-3 and 4-7 across the two 128bit lanes */
+	const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1,
+						2, 2, 2, 2, 3, 3, 3, 3,
+						4, 4, 4, 4, 5, 5, 5, 5,
+						6, 6, 6, 6, 7, 7, 7, 7);
+	uint32_t *dst;
+	uint64_t run;
+	__m256i a, d, al, lo, hi, blend, opaque, transp;
+	int x;
+
+	for (; height > 0; height--, ptr += linelen, cov += pitch) {
+		dst = (void *)ptr;
+
+		for (x = 0; x + 8 <= width; x += 8) {
+			run = glyph8_run(cov + x);
+			if (run == 0)
+				continue;
+
+			if (run == UINT64_MAX) {
+				_mm256_storeu_si256((void *)(dst + x), opv);
+				continue;
+			}
+
+			a = _mm256_shuffle_epi8(
+				_mm256_set1_epi64x((long long)run), spread);
+			d = _mm256_loadu_si256((const void *)(dst + x));
+
+			/* the unpacks and pack work within 128bit lanes so
+			 * the pixel order is preserved */
+			al = _mm256_unpacklo_epi8(a, zero);
+			lo = _mm256_srli_epi16(_mm256_add_epi16(
+				_mm256_mullo_epi16(fg, al),
+				_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero),
+						   _mm256_sub_epi16(full, al))),
+					       8);
+			al = _mm256_unpackhi_epi8(a, zero);
+			hi = _mm256_srli_epi16(_mm256_add_epi16(
+				_mm256_mullo_epi16(fg, al),
+				_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero),
+						   _mm256_sub_epi16(full, al))),
+					       8);
+			blend = _mm256_and_si256(_mm256_packus_epi16(lo, hi),
+						 rgbmask);
+
+			/* full coverage takes the foreground, none keeps
+			 * the dest */
+			opaque = _mm256_cmpeq_epi32(a, _mm256_set1_epi32(-1));
+			transp = _mm256_cmpeq_epi32(a, zero);
+			blend = _mm256_blendv_epi8(blend, opv, opaque);
+			blend = _mm256_blendv_epi8(blend, d, transp);
+
+			_mm256_storeu_si256((void *)(dst + x), blend);
+		}
+
+		for (; x < width; x++)
+			glyph8_one32(dst + x, cov[x], fp, op);
+	}
+	_mm256_zeroupper();
+}
+
+__attribute__((target("avx2")))
+static void
+glyph8_rows_xrgb_avx2(uint8_t *ptr, int linelen, const uint8_t *cov, int pitch,
+		      int width, int height, nsfb_colour_t c)
+{
+	glyph8_rows32_avx2(ptr, linelen, cov, pitch, width, height, c, true);
+}
+
+__attribute__((target("avx2")))
+static void
+glyph8_rows_xbgr_avx2(uint8_t *ptr, int linelen, const uint8_t *cov, int pitch,
+		      int width, int height, nsfb_colour_t c)
+{
+	glyph8_rows32_avx2(ptr, linelen, cov, pitch, width, height, c, false);
+}
+
+/**
+ * Blend one channel of eight RGB565 pixels held as 8bit values in 16bit lanes
+ */
+static inline __m128i glyph8_channel_sse2(__m128i f, __m128i d, __m128i a)
+{
+	return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(f, a),
+		_mm_mullo_epi16(d, _mm_sub_epi16(_mm_set1_epi16(0x100), a))),
+			      8);
+}
+
+static void
+glyph8_rows_rgb565_sse2(uint8_t *ptr, int linelen,
+			const uint8_t *cov, int pitch,
+			int width, int height,
+			nsfb_colour_t c)
+{
+	const uint16_t op = glyph8_colour_to_565(c);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i fr = _mm_set1_epi16(c & 0xFF);
+	const __m128i fg = _mm_set1_epi16((c >> 8) & 0xFF);
+	const __m128i fb = _mm_set1_epi16((c >> 16) & 0xFF);
+	const __m128i opv = _mm_set1_epi16(op);
+	uint16_t *dst;
+	uint64_t run;
+	__m128i a, d, r, g, b, blend, opaque, transp;
+	int x;
+
+	c &= 0xFFFFFF;
+
+	for (; height > 0; height--, ptr += linelen, cov += pitch) {
+		dst = (void *)ptr;
+
+		for (x = 0; x + 8 <= width; x += 8) {
+			run = glyph8_run(cov + x);
+			if (run == 0)
+				continue;
+
+			if (run == UINT64_MAX) {
+				_mm_storeu_si128((void *)(dst + x), opv);
+				continue;
+			}
+
+			a = _mm_unpacklo_epi8(
+				_mm_loadl_epi64((const void *)(cov + x)), zero);
+			d = _mm_loadu_si128((const void *)(dst + x));
+
+			/* expand as pixel_to_colour() does, low bits zero */
+			r = _mm_srli_epi16(d, 8);
+			r = _mm_and_si128(r, _mm_set1_epi16(0xF8));
+			g = _mm_srli_epi16(d, 3);
+			g = _mm_and_si128(g, _mm_set1_epi16(0xFC));
+			b = _mm_slli_epi16(d, 3);
+			b = _mm_and_si128(b, _mm_set1_epi16(0xF8));
+
+			r = glyph8_channel_sse2(fr, r, a);
+			g = glyph8_channel_sse2(fg, g, a);
+			b = glyph8_channel_sse2(fb, b, a);
+
+			blend = _mm_or_si128(
+				_mm_slli_epi16(_mm_and_si128(r,
+						_mm_set1_epi16(0xF8)), 8),
+				_mm_or_si128(_mm_slli_epi16(_mm_and_si128(g,
+						_mm_set1_epi16(0xFC)), 3),
+					     _mm_srli_epi16(b, 3)));
+
+			/* full coverage takes the foreground, none keeps
+			 * the dest */
+			opaque = _mm_cmpeq_epi16(a, _mm_set1_epi16(0xFF));
+			transp = _mm_cmpeq_epi16(a, zero);
+			blend = _mm_or_si128(_mm_andnot_si128(opaque, blend),
+					     _mm_and_si128(opaque, opv));
+			blend = _mm_or_si128(_mm_andnot_si128(transp, blend),
+					     _mm_and_si128(transp, d));
+
+			_mm_storeu_si128((void *)(dst + x), blend);
+		}
+
+		for (; x < width; x++)
+			glyph8_one16(dst + x, cov[x], c, op);
+	}
+}
+
+#endif /* NSFB_BLEND_X86 */
+
+#ifdef NSFB_BLEND_NEON
+
+static inline uint32x4_t blend_swizzle_neon(uint32x4_t s, bool swap)
+{
+	uint32x4_t rb;
+
+	if (!swap)
+		return s;
+
+	rb = vandq_u32(s, vdupq_n_u32(0x00FF00FF));
+	rb = vorrq_u32(vshlq_n_u32(rb, 16), vshrq_n_u32(rb, 16));
+	return vorrq_u32(vandq_u32(rb, vdupq_n_u32(0x00FF00FF)),
+			 vandq_u32(s, vdupq_n_u32(0x0000FF00)));
+}
+
+/**
+ * Test if every lane of a comparison result is set
+ */
+static inline bool blend_all_neon(uint32x4_t m)
+{
+	uint32x2_t t = vand_u32(vget_low_u32(m), vget_high_u32(m));
+
+	return (vget_lane_u32(t, 0) & vget_lane_u32(t, 1)) != 0;
+}
+
+static inline void
+blend_row_neon(uint32_t *dst, const nsfb_colour_t *src, int width, bool swap)
+{
+	const uint32x4_t rgbmask = vdupq_n_u32(0x00FFFFFF);
+	uint32x4_t s, sp, d, a, blend, opaque, transp;
+	uint16x8_t a16, s16, d16, lo, hi;
+	uint8x16_t ab, sb, db;
+
+	for (; width >= 4; width -= 4, dst += 4, src += 4) {
+		s = vld1q_u32(src);
+		a = vshrq_n_u32(s, 24);
+
+		transp = vceqq_u32(a, vdupq_n_u32(0));
+		if (blend_all_neon(transp)) {
+			/* all transparent, nothing to do */
+			continue;
+		}
+
+		sp = blend_swizzle_neon(s, swap);
+
+		opaque = vceqq_u32(a, vdupq_n_u32(0xFF));
+		if (blend_all_neon(opaque)) {
+			/* all opaque, plain store */
+			vst1q_u32(dst, sp);
+			continue;
+		}
+
+		d = vld1q_u32(dst);
+
+		/* replicate alpha into every byte of its pixel */
+		ab = vreinterpretq_u8_u32(vmulq_n_u32(a, 0x01010101));
+		sb = vreinterpretq_u8_u32(vorrq_u32(vandq_u32(sp, rgbmask),
+						    vbicq_u32(s, rgbmask)));
+		db = vreinterpretq_u8_u32(d);
+
+		a16 = vmovl_u8(vget_low_u8(ab));
+		s16 = vmovl_u8(vget_low_u8(sb));
+		d16 = vmovl_u8(vget_low_u8(db));
+		lo = vmlaq_u16(vmulq_u16(s16, a16), d16,
+			       vsubq_u16(vdupq_n_u16(0x100), a16));
+
+		a16 = vmovl_u8(vget_high_u8(ab));
+		s16 = vmovl_u8(vget_high_u8(sb));
+		d16 = vmovl_u8(vget_high_u8(db));
+		hi = vmlaq_u16(vmulq_u16(s16, a16), d16,
+			       vsubq_u16(vdupq_n_u16(0x100), a16));
+
+		blend = vreinterpretq_u32_u8(vcombine_u8(vshrn_n_u16(lo, 8),
+							 vshrn_n_u16(hi, 8)));
+		blend = vandq_u32(blend, rgbmask);
+
+		/* opaque pixels take the source, transparent keep the dest */
+		blend = vbslq_u32(opaque, sp, blend);
+		blend = vbslq_u32(transp, d, blend);
+
+		vst1q_u32(dst, blend);
+	}
+
+	for (; width > 0; width--)
+		blend_one(dst++, *src++, swap);
+}
+
+static void blend_row_xrgb_neon(void *dst, const nsfb_colour_t *src, int width)
+{
+	blend_row_neon(dst, src, width, true);
+}
+
+static void blend_row_xbgr_neon(void *dst, const nsfb_colour_t *src, int width)
+{
+	blend_row_neon(dst, src, width, false);
+}
+
+/**
+ * Blend the foreground onto four pixels by coverage
+ *
+ * \param dst The pixels to blend onto.
+ * \param a The coverage of each pixel.
+ * \param fg The foreground channels of two pixels in 16bit lanes.
+ * \param opv The pixel to store for full coverage in every lane.
+ */
+static inline void
+glyph8_quad_neon(uint32_t *dst, uint32x4_t a, uint16x8_t fg, uint32x4_t opv)
+{
+	uint32x4_t d, blend;
+	uint16x8_t a16, lo, hi;
+	uint8x16_t ab, db;
+
+	d = vld1q_u32(dst);
+
+	/* replicate coverage into every byte of its pixel */
+	ab = vreinterpretq_u8_u32(vmulq_n_u32(a, 0x01010101));
+	db = vreinterpretq_u8_u32(d);
+
+	a16 = vmovl_u8(vget_low_u8(ab));
+	lo = vmlaq_u16(vmulq_u16(fg, a16), vmovl_u8(vget_low_u8(db)),
+		       vsubq_u16(vdupq_n_u16(0x100), a16));
+	a16 = vmovl_u8(vget_high_u8(ab));
+	hi = vmlaq_u16(vmulq_u16(fg, a16), vmovl_u8(vget_high_u8(db)),
+		       vsubq_u16(vdupq_n_u16(0x100), a16));
+
+	blend = vreinterpretq_u32_u8(vcombine_u8(vshrn_n_u16(lo, 8),
+						 vshrn_n_u16(hi, 8)));
+	blend = vandq_u32(blend, vdupq_n_u32(0x00FFFFFF));
+
+	/* full coverage takes the foreground, none keeps the dest */
+	blend = vbslq_u32(vceqq_u32(a, vdupq_n_u32(0xFF)), opv, blend);
+	blend = vbslq_u32(vceqq_u32(a, vdupq_n_u32(0)), d, blend);
+
+	vst1q_u32(dst, blend);
+}
+
+static inline void
+glyph8_rows32_neon(uint8_t *ptr, int linelen,
+		   const uint8_t *cov, int pitch,
+		   int width, int height,
+		   nsfb_colour_t c, bool swap)
+{
+	const uint32_t fp = blend_colour_to_pixel(c & 0xFFFFFF, swap);
+	const uint32_t op = blend_colour_to_pixel(c | 0xFF000000, swap);
+	const uint16x8_t fg = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(fp)));
+	const uint32x4_t opv = vdupq_n_u32(op);
+	uint32_t *dst;
+	uint64_t run;
+	uint16x8_t a16;
+	int x;
+
+	for (; height > 0; height--, ptr += linelen, cov += pitch) {
+		dst = (void *)ptr;
+
+		for (x = 0; x + 8 <= width; x += 8) {
+			run = glyph8_run(cov + x);
+			if (run == 0)
+				continue;
+
+			if (run == UINT64_MAX) {
+				vst1q_u32(dst + x, opv);
+				vst1q_u32(dst + x + 4, opv);
+				continue;
+			}
+
+			a16 = vmovl_u8(vld1_u8(cov + x));
+			glyph8_quad_neon(dst + x, vmovl_u16(vget_low_u16(a16)),
+					 fg, opv);
+			glyph8_quad_neon(dst + x + 4,
+					 vmovl_u16(vget_high_u16(a16)),
+					 fg, opv);
+		}
+
+		for (; x < width; x++)
+			glyph8_one32(dst + x, cov[x], fp, op);
+	}
+}
+
+static void
+glyph8_rows_xrgb_neon(uint8_t *ptr, int linelen, const uint8_t *cov, int pitch,
+		      int width, int height, nsfb_colour_t c)
+{
+	glyph8_rows32_neon(ptr, linelen, cov, pitch, width, height, c, true);
+}
+
+static void
+glyph8_rows_xbgr_neon(uint8_t *ptr, int linelen, const uint8_t *cov, int pitch,
+		      int width, int height, nsfb_colour_t c)
+{
+	glyph8_rows32_neon(ptr, linelen, cov, pitch, width, height, c, false);
+}
+
+/**
+ * Blend one channel of eight RGB565 pixels held as 8bit values in 16bit lanes
+ */
+static inline uint16x8_t glyph8_channel_neon(uint16x8_t f, uint16x8_t d, uint16x8_t a)
+{
+	return vshrq_n_u16(vmlaq_u16(vmulq_u16(f, a), d,
+				     vsubq_u16(vdupq_n_u16(0x100), a)), 8);
+}
+
+static void
+glyph8_rows_rgb565_neon(uint8_t *ptr, int linelen,
+			const uint8_t *cov, int pitch,
+			int width, int height,
+			nsfb_colour_t c)
+{
+	const uint16_t op = glyph8_colour_to_565(c);
+	const uint16x8_t fr = vdupq_n_u16(c & 0xFF);
+	const uint16x8_t fg = vdupq_n_u16((c >> 8) & 0xFF);
+	const uint16x8_t fb = vdupq_n_u16((c >> 16) & 0xFF);
+	const uint16x8_t opv = vdupq_n_u16(op);
+	uint16_t *dst;
+	uint64_t run;
+	uint16x8_t a, d, r, g, b, blend;
+	int x;
+
+	c &= 0xFFFFFF;
+
+	for (; height > 0; height--, ptr += linelen, cov += pitch) {
+		dst = (void *)ptr;
+
+		for (x = 0; x + 8 <= width; x += 8) {
+			run = glyph8_run(cov + x);
+			if (run == 0)
+				continue;
+
+			if (run == UINT64_MAX) {
+				vst1q_u16(dst + x, opv);
+				continue;
+			}
+
+			a = vmovl_u8(vld1_u8(cov + x));
+			d = vld1q_u16(dst + x);
+
+			/* expand as pixel_to_colour() does, low bits zero */
+			r = vandq_u16(vshrq_n_u16(d, 8), vdupq_n_u16(0xF8));
+			g = vandq_u16(vshrq_n_u16(d, 3), vdupq_n_u16(0xFC));
+			b = vandq_u16(vshlq_n_u16(d, 3), vdupq_n_u16(0xF8));
+
+			r = glyph8_channel_neon(fr, r, a);
+			g = glyph8_channel_neon(fg, g, a);
+			b = glyph8_channel_neon(fb, b, a);
+
+			blend = vorrq_u16(
+				vshlq_n_u16(vandq_u16(r, vdupq_n_u16(0xF8)), 8),
+				vorrq_u16(vshlq_n_u16(vandq_u16(g,
+						vdupq_n_u16(0xFC)), 3),
+					  vshrq_n_u16(b, 3)));
+
+			/* full coverage takes the foreground, none keeps
+			 * the dest */
+			blend = vbslq_u16(vceqq_u16(a, vdupq_n_u16(0xFF)),
+					  opv, blend);
+			blend = vbslq_u16(vceqq_u16(a, vdupq_n_u16(0)),
+					  d, blend);
+
+			vst1q_u16(dst + x, blend);
+		}
+
+		for (; x < width; x++)
+			glyph8_one16(dst + x, cov[x], c, op);
+	}
+}
+
+#endif /* NSFB_BLEND_NEON */
+
+/* exported interface documented in plot.h */
+nsfb_blend_row_t *nsfb_blend_row_select(enum nsfb_format_e format)
+{
+	unsigned int features = nsfb_cpu_features();
+	bool swap;
+
+	switch (format) {
+	case NSFB_FMT_XRGB8888:
+	case NSFB_FMT_ARGB8888:
+		swap = true;
+		break;
+
+	case NSFB_FMT_XBGR8888:
+	case NSFB_FMT_ABGR8888:
+		swap = false;
+		break;
+
+	default:
+		return NULL;
+	}
+
+#ifdef NSFB_BLEND_X86
+	if (features & NSFB_CPU_AVX2)
+		return swap ? blend_row_xrgb_avx2 : blend_row_xbgr_avx2;
+	if (features & NSFB_CPU_SSE2)
+		return swap ? blend_row_xrgb_sse2 : blend_row_xbgr_sse2;
+#endif
+
+#ifdef NSFB_BLEND_NEON
+	if (features & NSFB_CPU_NEON)
+		return swap ? blend_row_xrgb_neon : blend_row_xbgr_neon;
+#endif
+
+	(void)features;
+	(void)swap;
+
+	return NULL;
+}
+
+/* exported interface documented in plot.h */
+nsfb_glyph8_rows_t *nsfb_glyph8_rows_select(enum nsfb_format_e format)
+{
+	unsigned int features = nsfb_cpu_features();
+
+	switch (format) {
+	case NSFB_FMT_XRGB8888:
+	case NSFB_FMT_ARGB8888:
+#ifdef NSFB_BLEND_X86
+		if (features & NSFB_CPU_AVX2)
+			return glyph8_rows_xrgb_avx2;
+		if (features & NSFB_CPU_SSE2)
+			return glyph8_rows_xrgb_sse2;
+#endif
+#ifdef NSFB_BLEND_NEON
+		if (features & NSFB_CPU_NEON)
+			return glyph8_rows_xrgb_neon;
+#endif
+		break;
+
+	case NSFB_FMT_XBGR8888:
+	case NSFB_FMT_ABGR8888:
+#ifdef NSFB_BLEND_X86
+		if (features & NSFB_CPU_AVX2)
+			return glyph8_rows_xbgr_avx2;
+		if (features & NSFB_CPU_SSE2)
+			return glyph8_rows_xbgr_sse2;
+#endif
+#ifdef NSFB_BLEND_NEON
+		if (features & NSFB_CPU_NEON)
+			return glyph8_rows_xbgr_neon;
+#endif
+		break;
+
+	case NSFB_FMT_RGB565:
+#ifdef NSFB_BLEND_X86
+		if (features & NSFB_CPU_SSE2)
+			return glyph8_rows_rgb565_sse2;
+#endif
+#ifdef NSFB_BLEND_NEON
+		if (features & NSFB_CPU_NEON)
+			return glyph8_rows_rgb565_neon;
+#endif
+		break;
+
+	default:
+		break;
+	}
+
+	(void)features;
+
+	return NULL;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset:8
+ * End:
+ */
@@ -16,45 +16,251 @@
 #error PLOT_LINELEN must be a macro to increment a line length
 #endif
 
+#include <string.h>
+
 #include "palette.h"
 
 #define SIGN(x)  ((x<0) ?  -1  :  ((x>0) ? 1 : 0))
 
+/**
+ * Fill a run of pixels on one row
+ *
+ * Long runs use the vector fill when the depth has one.
+ */
+static inline void
+span_fill(nsfb_t *nsfb, PLOT_TYPE *pvideo, int width, PLOT_TYPE ent)
+{
+        uint32_t pattern;
+
+        if ((nsfb->plotter_fns->fill_rows != NULL) && (width >= 8)) {
+                pattern = ent;
+                if (sizeof(PLOT_TYPE) == 2)
+                        pattern |= pattern << 16;
+                nsfb->plotter_fns->fill_rows((uint8_t *)pvideo,
+                                             nsfb->linelen,
+                                             width * sizeof(PLOT_TYPE),
+                                             1, pattern);
+                return;
+        }
+
+        while (width-- > 0)
+                *(pvideo + width) = ent;
+}
+
+static bool
+spans(nsfb_t *nsfb, int spanc, const nsfb_plot_span_t *span, nsfb_colour_t c)
+{
+        PLOT_TYPE ent;
+        int x0, x1;
+
+        ent = colour_to_pixel(nsfb, c);
+
+        for (; spanc > 0; spanc--, span++) {
+                if ((span->y < nsfb->clip.y0) || (span->y >= nsfb->clip.y1))
+                        continue;
+
+                if (span->x0 <= span->x1) {
+                        x0 = span->x0;
+                        x1 = span->x1;
+                } else {
+                        x0 = span->x1;
+                        x1 = span->x0;
+                }
+
+                if (x0 < nsfb->clip.x0)
+                        x0 = nsfb->clip.x0;
+                if (x1 > nsfb->clip.x1)
+                        x1 = nsfb->clip.x1;
+                if (x0 >= x1)
+                        continue;
+
+                span_fill(nsfb, get_xy_loc(nsfb, x0, span->y), x1 - x0, ent);
+        }
+        return true;
+}
+
+/**
+ * Rotate a stroke pattern mask right
+ */
+static inline uint32_t pattern_rotate(uint32_t mask, unsigned int n)
+{
+        n &= 31;
+        return (n == 0) ? mask : ((mask >> n) | (mask << (32 - n)));
+}
+
+/**
+ * Find the stroke pattern mask for a walk along a line
+ *
+ * The returned mask has the bit for pattern position \a pos in bit 0 and
+ * the bit for the next pixel of the walk is reached by rotating it right
+ * one place. A backwards walk visits decreasing pattern positions, so its
+ * mask is the reversed pattern.
+ */
+static inline uint32_t
+pattern_mask(uint32_t pattern, int pos, bool backwards)
+{
+        if (!backwards)
+                return pattern_rotate(pattern, pos);
+
+        pattern = ((pattern >> 1) & 0x55555555) | ((pattern & 0x55555555) << 1);
+        pattern = ((pattern >> 2) & 0x33333333) | ((pattern & 0x33333333) << 2);
+        pattern = ((pattern >> 4) & 0x0F0F0F0F) | ((pattern & 0x0F0F0F0F) << 4);
+        pattern = ((pattern >> 8) & 0x00FF00FF) | ((pattern & 0x00FF00FF) << 8);
+        pattern = (pattern >> 16) | (pattern << 16);
+
+        return pattern_rotate(pattern, 31 - pos);
+}
+
+/**
+ * Plot a horizontal line
+ *
+ * \param nsfb The context.
+ * \param line The line, which is clipped in place.
+ * \param ent The pixel value to plot.
+ * \param pattern The stroke pattern mask.
+ * \param phase The pattern position of the first pixel of the line.
+ */
+static inline void
+hline(nsfb_t *nsfb, nsfb_bbox_t *line, PLOT_TYPE ent, uint32_t pattern,
+      int phase)
+{
+        PLOT_TYPE *pvideo;
+        uint32_t mask;
+        bool backwards = (line->x1 < line->x0);
+        int x0 = line->x0;
+        int x;
+
+        if (!nsfb_plot_clip_ctx(nsfb, line)) {
+                /* line outside clipping */
+                return;
+        }
+
+        pvideo = get_xy_loc(nsfb, line->x0, line->y0);
+
+        if (pattern == 0xFFFFFFFF) {
+                span_fill(nsfb, pvideo, line->x1 - line->x0, ent);
+                return;
+        }
+
+        /* the clip leaves the run left to right */
+        if (backwards) {
+                mask = pattern_mask(pattern, phase + x0 - 1 - line->x0, true);
+        } else {
+                mask = pattern_mask(pattern, phase + line->x0 - x0, false);
+        }
+
+        for (x = line->x1 - line->x0; x > 0; x--) {
+                if (mask & 1)
+                        *pvideo = ent;
+                pvideo++;
+                mask = (mask >> 1) | (mask << 31);
+        }
+}
+
+/**
+ * Plot a vertical line
+ *
+ * The line is clipped as any other line so exactly the same pixels are
+ * plotted, but the walk only steps by the line length.
+ *
+ * \param nsfb The context.
+ * \param line The line, which is clipped in place.
+ * \param ent The pixel value to plot.
+ * \param pattern The stroke pattern mask.
+ * \param phase The pattern position of the first pixel of the line.
+ */
+static inline void
+vline(nsfb_t *nsfb, nsfb_bbox_t *line, PLOT_TYPE ent, uint32_t pattern,
+      int phase)
+{
+        PLOT_TYPE *pvideo;
+        uint32_t mask;
+        int y0 = line->y0;
+        int step;
+        int y;
+
+        if (!nsfb_plot_clip_line_ctx(nsfb, line)) {
+                /* line outside clipping */
+                return;
+        }
+
+        pvideo = get_xy_loc(nsfb, line->x0, line->y0);
+        step = PLOT_LINELEN(nsfb->linelen);
+        y = line->y1 - line->y0;
+        if (y < 0) {
+                step = -step;
+                y = -y;
+        }
+
+        if (pattern == 0xFFFFFFFF) {
+                for (; y > 0; y--) {
+                        *pvideo = ent;
+                        pvideo += step;
+                }
+                return;
+        }
+
+        mask = pattern_mask(pattern, phase + abs(line->y0 - y0), false);
+        for (; y > 0; y--) {
+                if (mask & 1)
+                        *pvideo = ent;
+                pvideo += step;
+                mask = (mask >> 1) | (mask << 31);
+        }
+}
+
+/**
+ * Plot lines
+ *
+ * Pattern strokes draw the pixels whose bit is set in the pen's stroke
+ * pattern. The pattern position runs on along each line in turn so
+ * joined lines such as polylines and rectangle edges keep their phase.
+ */
 static bool
 line(nsfb_t *nsfb, int linec, nsfb_bbox_t *line, nsfb_plot_pen_t *pen)
 {
-        int w;
         PLOT_TYPE ent;
         PLOT_TYPE *pvideo;
+        nsfb_bbox_t orig;
+        uint32_t pattern;
+        uint32_t mask;
         int x, y, i;
         int dx, dy, sdy;
         int dxabs, dyabs;
+        int phase = 0;
+        int len = 0;
+        int start;
+
+        if (pen->stroke_width > 1)
+                return nsfb_stroke_lines(nsfb, linec, line, pen);
 
         ent = colour_to_pixel(nsfb, pen->stroke_colour);
 
-        for (;linec > 0; linec--) {
+        if (pen->stroke_type == NFSB_PLOT_OPTYPE_PATTERN)
+                pattern = pen->stroke_pattern;
+        else
+                pattern = 0xFFFFFFFF;
+
+        /* the pattern position moves on by the length of each line */
+        for (; linec > 0; linec--, line++, phase += len) {
+                orig = *line;
+                dxabs = abs(orig.x1 - orig.x0);
+                dyabs = abs(orig.y1 - orig.y0);
+                len = (dxabs >= dyabs) ? dxabs : dyabs;
 
                 if (line->y0 == line->y1) {
                         /* horizontal line special cased */
+                        hline(nsfb, line, ent, pattern, phase);
 
-                        if (!nsfb_plot_clip_ctx(nsfb, line)) {
-                                /* line outside clipping */
-                                line++;
-                                continue;
-                        }
-
-                        pvideo = get_xy_loc(nsfb, line->x0, line->y0);
-
-                        w = line->x1 - line->x0;
-                        while (w-- > 0)
-                                *(pvideo + w) = ent;
+                } else if (line->x0 == line->x1) {
+                        /* vertical line special cased */
+                        vline(nsfb, line, ent, pattern, phase);
 
                 } else {
                         /* standard bresenham line */
 
                         if (!nsfb_plot_clip_line_ctx(nsfb, line)) {
                                 /* line outside clipping */
-                                line++;
                                 continue;
                         }
 
@@ -68,10 +274,26 @@ line(nsfb_t *nsfb, int linec, nsfb_bbox_t *line, nsfb_plot_pen_t *pen)
 
                         sdy = dx ? SIGN(dy) * SIGN(dx) : SIGN(dy);
 
-                        if (dx >= 0)
+                        /* The walk starts at the left end, so lines drawn
+                         * leftwards are walked back from their last pixel.
+                         * Either way the pattern position is the distance
+                         * from the unclipped start along its major axis.
+                         */
+                        if (dx >= 0) {
                                 pvideo = get_xy_loc(nsfb, line->x0, line->y0);
-                        else
+                                start = (len == abs(orig.x1 - orig.x0)) ?
+                                        abs(line->x0 - orig.x0) :
+                                        abs(line->y0 - orig.y0);
+                                mask = pattern_mask(pattern, phase + start,
+                                                    false);
+                        } else {
                                 pvideo = get_xy_loc(nsfb, line->x1, line->y1);
+                                start = (len == abs(orig.x1 - orig.x0)) ?
+                                        abs(line->x1 - orig.x0) :
+                                        abs(line->y1 - orig.y0);
+                                mask = pattern_mask(pattern, phase + start - 1,
+                                                    true);
+                        }
 
                         x = dyabs >> 1;
                         y = dxabs >> 1;
@@ -79,7 +301,9 @@ line(nsfb_t *nsfb, int linec, nsfb_bbox_t *line, nsfb_plot_pen_t *pen)
                         if (dxabs >= dyabs) {
                                 /* the line is more horizontal than vertical */
                                 for (i = 0; i < dxabs; i++) {
-                                        *pvideo = ent;
+                                        if (mask & 1)
+                                                *pvideo = ent;
+                                        mask = (mask >> 1) | (mask << 31);
 
                                         pvideo++;
                                         y += dyabs;
@@ -91,7 +315,9 @@ line(nsfb_t *nsfb, int linec, nsfb_bbox_t *line, nsfb_plot_pen_t *pen)
                         } else {
                                 /* the line is more vertical than horizontal */
                                 for (i = 0; i < dyabs; i++) {
-                                        *pvideo = ent;
+                                        if (mask & 1)
+                                                *pvideo = ent;
+                                        mask = (mask >> 1) | (mask << 31);
                                         pvideo += sdy * PLOT_LINELEN(nsfb->linelen);
 
                                         x += dxabs;
@@ -103,11 +329,70 @@ line(nsfb_t *nsfb, int linec, nsfb_bbox_t *line, nsfb_plot_pen_t *pen)
                         }
 
                 }
-                line++;
         }
         return true;
 }
 
+/**
+ * Plot a rectangle outline
+ *
+ * Thin outlines write their sides directly with the horizontal and
+ * vertical line plotters. The sides run around the rectangle so a pattern
+ * continues unbroken from one side into the next.
+ */
+static bool
+rectangle(nsfb_t *nsfb, nsfb_bbox_t *rect, int line_width, nsfb_colour_t c,
+          bool dotted, bool dashed)
+{
+        PLOT_TYPE ent;
+        nsfb_bbox_t side;
+        uint32_t pattern;
+        int w, h;
+
+        if (dotted)
+                pattern = NSFB_PLOT_PATTERN_DOTTED;
+        else if (dashed)
+                pattern = NSFB_PLOT_PATTERN_DASHED;
+        else
+                pattern = 0xFFFFFFFF;
+
+        if (line_width > 1)
+                return nsfb_stroke_rectangle(nsfb, rect, line_width, c,
+                                             pattern);
+
+        ent = colour_to_pixel(nsfb, c);
+        w = abs(rect->x1 - rect->x0);
+        h = abs(rect->y1 - rect->y0);
+
+        side.x0 = rect->x0;
+        side.y0 = side.y1 = rect->y0;
+        side.x1 = rect->x1;
+        hline(nsfb, &side, ent, pattern, 0);
+
+        side.x0 = side.x1 = rect->x1;
+        side.y0 = rect->y0;
+        side.y1 = rect->y1;
+        vline(nsfb, &side, ent, pattern, w);
+
+        side.x0 = rect->x1;
+        side.y0 = side.y1 = rect->y1;
+        side.x1 = rect->x0;
+        hline(nsfb, &side, ent, pattern, w + h);
+
+        side.x0 = side.x1 = rect->x0;
+        if (pattern == 0xFFFFFFFF) {
+                /* the line clipper keeps different pixels of an upward
+                 * line so solid outlines draw their left side downwards */
+                side.y0 = rect->y0;
+                side.y1 = rect->y1;
+        } else {
+                side.y0 = rect->y1;
+                side.y1 = rect->y0;
+        }
+        vline(nsfb, &side, ent, pattern, w + w + h);
+
+        return true;
+}
 
 static bool point(nsfb_t *nsfb, int x, int y, nsfb_colour_t c)
 {
@@ -132,6 +417,145 @@ static bool point(nsfb_t *nsfb, int x, int y, nsfb_colour_t c)
         return true;
 }
 
+/**
+ * Find the screen position of a pixel
+ */
+static inline void
+pixel_xy(nsfb_t *nsfb, const PLOT_TYPE *pvideo, int *x, int *y)
+{
+        int offset = (const uint8_t *)pvideo - nsfb->ptr;
+
+        *y = offset / nsfb->linelen;
+        *x = (offset % nsfb->linelen) / sizeof(PLOT_TYPE);
+}
+
+/**
+ * Convert a row of colours to pixels
+ *
+ * Uses the formats row converter when there is one, otherwise each pixel
+ * is converted in turn so paletted dithering sees them in order.
+ */
+static inline void
+colours_to_row(nsfb_t *nsfb,
+               PLOT_TYPE *pvideo,
+               const nsfb_colour_t *colours,
+               int width)
+{
+        int xloop;
+        int x, y;
+
+        if (nsfb->plotter_fns->row_from_colour != NULL) {
+                nsfb->plotter_fns->row_from_colour(pvideo, colours, width);
+                return;
+        }
+
+        if (nsfb->palette != NULL &&
+            nsfb_palette_dithering_ordered(nsfb->palette)) {
+                /* ordered dithering depends only on the screen position */
+                pixel_xy(nsfb, pvideo, &x, &y);
+                for (xloop = 0; xloop < width; xloop++) {
+                        pvideo[xloop] = nsfb_palette_best_match_ordered(
+                                        nsfb->palette, colours[xloop],
+                                        x + xloop, y);
+                }
+                return;
+        }
+
+        for (xloop = 0; xloop < width; xloop++) {
+                pvideo[xloop] = colour_to_pixel(nsfb, colours[xloop]);
+        }
+}
+
+/**
+ * Convert a row of pixels to colours
+ */
+static inline void
+row_to_colours(nsfb_t *nsfb,
+               nsfb_colour_t *colours,
+               const PLOT_TYPE *pvideo,
+               int width)
+{
+        int xloop;
+
+        if (nsfb->plotter_fns->row_to_colour != NULL) {
+                nsfb->plotter_fns->row_to_colour(colours, pvideo, width);
+                return;
+        }
+
+        for (xloop = 0; xloop < width; xloop++) {
+                colours[xloop] = pixel_to_colour(nsfb, pvideo[xloop]);
+        }
+}
+
+/**
+ * Alpha blend a row of colours onto pixels
+ *
+ * Uses the formats blend routine when there is one.
+ */
+static inline void
+colours_blend_row(nsfb_t *nsfb,
+                  PLOT_TYPE *pvideo,
+                  const nsfb_colour_t *colours,
+                  int width)
+{
+        nsfb_colour_t abpixel; /* alphablended pixel */
+        int xloop;
+        int x = 0, y = 0;
+        bool ordered = false;
+
+        if (nsfb->plotter_fns->blend_row != NULL) {
+                nsfb->plotter_fns->blend_row(pvideo, colours, width);
+                return;
+        }
+
+        if (nsfb->palette != NULL &&
+            nsfb_palette_dithering_ordered(nsfb->palette)) {
+                ordered = true;
+                pixel_xy(nsfb, pvideo, &x, &y);
+        }
+
+        for (xloop = 0; xloop < width; xloop++) {
+                abpixel = colours[xloop];
+                if ((abpixel & 0xFF000000) != 0) {
+                        /* pixel is not transparent; have to plot something */
+                        if ((abpixel & 0xFF000000) != 0xFF000000) {
+                                /* pixel is not opaque; need to blend */
+                                abpixel = nsfb_plot_ablend(abpixel,
+                                                pixel_to_colour(nsfb,
+                                                                pvideo[xloop]));
+                        }
+
+                        if (ordered) {
+                                pvideo[xloop] =
+                                        nsfb_palette_best_match_ordered(
+                                                nsfb->palette, abpixel,
+                                                x + xloop, y);
+                        } else {
+                                pvideo[xloop] = colour_to_pixel(nsfb,
+                                                                abpixel);
+                        }
+                }
+        }
+}
+
+/**
+ * Plot the set bits of one glyph byte as eight pixels
+ *
+ * Each bit is turned into a whole pixel mask so the pixels are merged
+ * without branches. Used when there is no vector routine for the depth.
+ */
+static inline void
+glyph1_byte(PLOT_TYPE *pvideo, unsigned int bits, PLOT_TYPE fgcol)
+{
+        PLOT_TYPE mask;
+        int bit;
+
+        for (bit = 0; bit < 8; bit++) {
+                mask = (PLOT_TYPE)0 - (PLOT_TYPE)((bits >> (7 - bit)) & 1);
+                pvideo[bit] = (pvideo[bit] & ~mask) | (fgcol & mask);
+        }
+}
+
 static bool
 glyph1(nsfb_t *nsfb,
        nsfb_bbox_t *loc,
@@ -148,6 +572,7 @@ glyph1(nsfb_t *nsfb,
         int y = loc->y0;
         int width;
         int height;
+        unsigned int bits;
         const size_t line_len = PLOT_LINELEN(nsfb->linelen);
         const uint8_t *row;
 
@@ -169,9 +594,44 @@ glyph1(nsfb_t *nsfb,
         row = pixel + yoff * pitch;
 
         for (; pvideo < pvideo_limit; pvideo += line_len) {
-                for (xloop = xoff; xloop < width; xloop++) {
+                xloop = xoff;
+
+                /* leading bits of a byte split by clipping */
+                for (; ((xloop & 7) != 0) && (xloop < width); xloop++) {
+                        if (row[xloop >> 3] & (0x80 >> (xloop & 7))) {
+                                *(pvideo + xloop) = fgcol;
+                        }
+                }
+
+                /* whole bytes */
+                if (nsfb->plotter_fns->glyph1_row != NULL) {
+                        nsfb->plotter_fns->glyph1_row(pvideo + xloop,
+                                                      row + (xloop >> 3),
+                                                      (width - xloop) >> 3,
+                                                      fgcol);
+                        xloop += (width - xloop) & ~7;
+                }
+                for (; xloop + 8 <= width; xloop += 8) {
+                        bits = row[xloop >> 3];
+                        if (bits == 0) {
+                                continue;
+                        } else if (bits == 0xFF) {
+                                pvideo[xloop + 0] = fgcol;
+                                pvideo[xloop + 1] = fgcol;
+                                pvideo[xloop + 2] = fgcol;
+                                pvideo[xloop + 3] = fgcol;
+                                pvideo[xloop + 4] = fgcol;
+                                pvideo[xloop + 5] = fgcol;
+                                pvideo[xloop + 6] = fgcol;
+                                pvideo[xloop + 7] = fgcol;
+                        } else {
+                                glyph1_byte(pvideo + xloop, bits, fgcol);
+                        }
+                }
 
-                        if (row[xloop / 8] & ((1<<7) >> (xloop % 8))) {
+                /* trailing bits of a byte split by clipping */
+                for (; xloop < width; xloop++) {
+                        if (row[xloop >> 3] & (0x80 >> (xloop & 7))) {
                                 *(pvideo + xloop) = fgcol;
                         }
                 }
@@ -209,6 +669,14 @@ glyph8(nsfb_t *nsfb,
 
         pvideo = get_xy_loc(nsfb, loc->x0, loc->y0);
 
+        if (nsfb->plotter_fns->glyph8_rows != NULL) {
+                nsfb->plotter_fns->glyph8_rows((uint8_t *)pvideo,
+                                               nsfb->linelen,
+                                               pixel + (yoff * pitch) + xoff,
+                                               pitch, width, height, c);
+                return true;
+        }
+
         fgcol = c & 0xFFFFFF;
 
         for (yloop = 0; yloop < height; yloop++) {
@@ -235,20 +703,20 @@ static bool bitmap_scaled(nsfb_t *nsfb, const nsfb_bbox_t *loc,
 		int bmp_stride, bool alpha)
 {
 	PLOT_TYPE *pvideo;
-	PLOT_TYPE *pvideo_limit;
-	nsfb_colour_t abpixel; /* alphablended pixel */
-	int xloop;
-	int xoff, yoff, xoffs; /* x and y offsets into image */
+	const nsfb_colour_t *colours; /* scaled source colours */
+	int yloop;
 	int x = loc->x0;
 	int y = loc->y0;
 	int width = loc->x1 - loc->x0; /* size to scale to */
 	int height = loc->y1 - loc->y0; /* size to scale to */
 	int rheight, rwidth; /* post-clipping render area dimensions */
-	int dx, dy; /* scale factor (integer part) */
-	int dxr, dyr; /* scale factor (remainder) */
-	int rx, ry, rxs; /* remainder trackers */
 	nsfb_bbox_t clipped; /* clipped display */
 	bool set_dither = false; /* true iff we enabled dithering here */
+	bool repeat; /* true if the row samples the same source as the last */
+	struct nsfb_scale_s scale;
+
+	if (width <= 0 || height <= 0)
+		return true;
 
 	/* The part of the scaled image actually displayed is cropped to the
 	 * current context. */
@@ -272,6 +740,12 @@ static bool bitmap_scaled(nsfb_t *nsfb, const nsfb_bbox_t *loc,
 	else
 		rwidth = width;
 
+	/* work out which source columns the plotted columns sample */
+	if (!nsfb_scale_init(&scale, nsfb, pixel, bmp_width, bmp_height,
+			     bmp_stride, width, height, clipped.x0 - x, rwidth,
+			     nsfb->bitmap_filter, alpha))
+		return false;
+
 	/* Enable error diffusion for paletted screens, if not already on */
 	if (nsfb->palette != NULL &&
 			nsfb_palette_dithering_on(nsfb->palette) == false) {
@@ -279,113 +753,33 @@ static bool bitmap_scaled(nsfb_t *nsfb, const nsfb_bbox_t *loc,
 		set_dither = true;
 	}
 
-	/* get veritcal (y) and horizontal (x) scale factors; both integer
-	 * part and remainder */
-	dx = bmp_width / width;
-	dy = (bmp_height / height) * bmp_stride;
-	dxr = bmp_width % width;
-	dyr = bmp_height % height;
-
-	/* get start offsets to part of image being scaled, after clipping and
-	 * set remainder trackers to correct starting value */
-	if (clipped.x0 - x != 0) {
-		xoffs = ((clipped.x0 - x) * bmp_width) / width;
-		rxs = ((clipped.x0 - x) * bmp_width) % width;
-	} else {
-		xoffs = 0;
-		rxs = 0;
-	}
-	if (clipped.y0 - y != 0) {
-		yoff = (((clipped.y0 - y) * bmp_height) / height) * bmp_stride;
-		ry = ((clipped.y0 - y) * bmp_height) % height;
-	} else {
-		yoff = 0;
-		ry = 0;
-	}
-
 	/* plot the image */
 	pvideo = get_xy_loc(nsfb, clipped.x0, clipped.y0);
-	pvideo_limit = pvideo + PLOT_LINELEN(nsfb->linelen) * rheight;
-	if (alpha) {
-		for (; pvideo < pvideo_limit;
-				pvideo += PLOT_LINELEN(nsfb->linelen)) {
-			/* looping through render area vertically */
-			xoff = xoffs;
-			rx = rxs;
-			for (xloop = 0; xloop < rwidth; xloop++) {
-				/* looping through render area horizontally */
-				/* get value of source pixel in question */
-				abpixel = pixel[yoff + xoff];
-				if ((abpixel & 0xFF000000) != 0) {
-					/* pixel is not transparent; have to
-					 * plot something */
-					if ((abpixel & 0xFF000000) !=
-							0xFF000000) {
-						/* pixel is not opaque; need to
-						 * blend */
-						abpixel = nsfb_plot_ablend(
-								abpixel,
-								pixel_to_colour(
-								nsfb, 
-								*(pvideo +
-								xloop)));
-					}
-					/* plot pixel */
-					*(pvideo + xloop) = colour_to_pixel(
-							nsfb, abpixel);
-				}
-				/* handle horizontal interpolation */
-				xoff += dx;
-				rx += dxr;
-				if (rx >= width) {
-					xoff++;
-					rx -= width;
-				}
-			}
-			/* handle vertical interpolation */
-			yoff += dy;
-			ry += dyr;
-			if (ry >= height) {
-				yoff += bmp_stride;
-				ry -= height;
-			}
-		}
-	} else {
-		for (; pvideo < pvideo_limit;
-				pvideo += PLOT_LINELEN(nsfb->linelen)) {
-			/* looping through render area vertically */
-			xoff = xoffs;
-			rx = rxs;
-			for (xloop = 0; xloop < rwidth; xloop++) {
-				/* looping through render area horizontally */
-				/* get value of source pixel in question */
-				abpixel = pixel[yoff + xoff];
-				/* plot pixel */
-				*(pvideo + xloop) = colour_to_pixel(
-						nsfb, abpixel);
-
-				/* handle horizontal interpolation */
-				xoff += dx;
-				rx += dxr;
-				if (rx >= width) {
-					xoff++;
-					rx -= width;
-				}
-			}
-			/* handle vertical interpolation */
-			yoff += dy;
-			ry += dyr;
-			if (ry >= height) {
-				yoff += bmp_stride;
-				ry -= height;
-			}
+	for (yloop = 0; yloop < rheight; yloop++) {
+		colours = nsfb_scale_row(&scale, clipped.y0 - y + yloop,
+					 &repeat);
+
+		if (alpha) {
+			colours_blend_row(nsfb, pvideo, colours, rwidth);
+		} else if (repeat && nsfb->palette == NULL) {
+			/* same source row as the one above; copy the pixels
+			 * already produced. Paletted screens dither each row
+			 * differently so they are converted again. */
+			memcpy(pvideo, pvideo - PLOT_LINELEN(nsfb->linelen),
+			       rwidth * sizeof(PLOT_TYPE));
+		} else {
+			colours_to_row(nsfb, pvideo, colours, rwidth);
 		}
+
+		pvideo += PLOT_LINELEN(nsfb->linelen);
 	}
 
 	if (set_dither) {
 		nsfb_palette_dither_fini(nsfb->palette);
 	}
 
+	nsfb_scale_fini(&scale);
+
 	return true;
 }
 
@@ -399,8 +793,7 @@ bitmap(nsfb_t *nsfb,
        bool alpha)
 {
         PLOT_TYPE *pvideo;
-        nsfb_colour_t abpixel; /* alphablended pixel */
-        int xloop, yloop;
+        int yloop;
         int xoff, yoff; /* x and y offset into image */
         int x = loc->x0;
         int y = loc->y0;
@@ -409,7 +802,7 @@ bitmap(nsfb_t *nsfb,
         nsfb_bbox_t clipped; /* clipped display */
         bool set_dither = false; /* true iff we enabled dithering here */
 
-        if (width == 0 || height == 0)
+        if (width <= 0 || height <= 0)
                 return true;
 
         /* Scaled bitmaps are handled by a separate function */
@@ -449,36 +842,14 @@ bitmap(nsfb_t *nsfb,
 
         if (alpha) {
                 for (yloop = yoff; yloop < height; yloop += bmp_stride) {
-                        for (xloop = 0; xloop < width; xloop++) {
-                                abpixel = pixel[yloop + xloop + xoff];
-                                if ((abpixel & 0xFF000000) != 0) {
-                                        /* pixel is not transparent; have to
-                                         * plot something */
-                                        if ((abpixel & 0xFF000000) !=
-                                                       0xFF000000) {
-                                                /* pixel is not opaque; need to
-                                                 * blend */
-                                                abpixel = nsfb_plot_ablend(
-                                                                abpixel,
-                                                                pixel_to_colour(
-                                                                nsfb,
-                                                                *(pvideo +
-                                                                xloop)));
-                                        }
-
-                                        *(pvideo + xloop) = colour_to_pixel(
-                                                        nsfb, abpixel);
-                                }
-                        }
+                        colours_blend_row(nsfb, pvideo, pixel + yloop + xoff,
+                                          width);
                         pvideo += PLOT_LINELEN(nsfb->linelen);
                 }
         } else {
                 for (yloop = yoff; yloop < height; yloop += bmp_stride) {
-                        for (xloop = 0; xloop < width; xloop++) {
-                                abpixel = pixel[yloop + xloop + xoff];
-                                *(pvideo + xloop) = colour_to_pixel(
-                                                nsfb, abpixel);
-                        }
+                        colours_to_row(nsfb, pvideo, pixel + yloop + xoff,
+                                       width);
                         pvideo += PLOT_LINELEN(nsfb->linelen);
                 }
         }
@@ -501,18 +872,17 @@ bitmap_tiles_x(nsfb_t *nsfb,
 	PLOT_TYPE *pvideo;
 	PLOT_TYPE *pvideo_pos;
 	PLOT_TYPE *pvideo_limit;
-	nsfb_colour_t abpixel; /* alphablended pixel */
-	int xloop;
 	int xoff, yoff; /* x and y offset into image */
-	int xlim;
-	int t;
+	int rwidth; /* width of the clipped render area */
+	int remain; /* pixels of the render area left in this row */
+	int start, count; /* run of the image row being plotted */
 	int x = loc->x0;
 	int y = loc->y0;
 	int width = loc->x1 - loc->x0;
 	int height = loc->y1 - loc->y0;
 	nsfb_bbox_t clipped; /* clipped display */
 
-	if (width == 0 || height == 0)
+	if (width <= 0 || height <= 0)
 		return true;
 
 	/* The part of the image actually displayed is cropped to the
@@ -532,125 +902,32 @@ bitmap_tiles_x(nsfb_t *nsfb,
 	pvideo_limit = pvideo + PLOT_LINELEN(nsfb->linelen) * height;
 
 	xoff = clipped.x0 - x;
-	xlim = width - (x + width * tiles_x - clipped.x1);
+	rwidth = clipped.x1 - clipped.x0;
 	yoff = (clipped.y0 - y) * bmp_stride;
 
-	/* plot the image */
-	if (alpha) {
-		for (; pvideo < pvideo_limit;
-				pvideo += PLOT_LINELEN(nsfb->linelen)) {
-			pvideo_pos = pvideo;
-			for (t = 0; t < 1; t++) {
-				for (xloop = xoff; xloop < width; xloop++) {
-					abpixel = pixel[yoff + xloop];
-					if ((abpixel & 0xFF000000) != 0) {
-						/* pixel is not transparent;
-						 * have to plot something */
-						if ((abpixel & 0xFF000000) !=
-								0xFF000000) {
-							/* pixel is not opaque;
-							 * need to blend */
-							abpixel =
-							nsfb_plot_ablend(
-								abpixel,
-								pixel_to_colour(
-								nsfb,
-								*(pvideo +
-								xloop - xoff)));
-						}
-						*(pvideo + xloop - xoff) =
-								colour_to_pixel(
-								nsfb, abpixel);
-					}
-				}
-			}
-			pvideo_pos += width - xoff;
-			for (; t < tiles_x - 1; t++) {
-				for (xloop = 0; xloop < width; xloop++) {
-					abpixel = pixel[yoff + xloop];
-					if ((abpixel & 0xFF000000) != 0) {
-						/* pixel is not transparent;
-						 * have to plot something */
-						if ((abpixel & 0xFF000000) !=
-								0xFF000000) {
-							/* pixel is not opaque;
-							 * need to blend */
-							abpixel =
-							nsfb_plot_ablend(
-								abpixel,
-								pixel_to_colour(
-								nsfb,
-								*(pvideo_pos +
-								xloop)));
-						}
-						*(pvideo_pos + xloop) =
-								colour_to_pixel(
-								nsfb, abpixel);
-					}
-				}
-				pvideo_pos += width;
-			}
-			for (; t < tiles_x; t++) {
-				for (xloop = 0; xloop < xlim; xloop++) {
-					abpixel = pixel[yoff + xloop];
-					if ((abpixel & 0xFF000000) != 0) {
-						/* pixel is not transparent;
-						 * have to plot something */
-						if ((abpixel & 0xFF000000) !=
-								0xFF000000) {
-							/* pixel is not opaque;
-							 * need to blend */
-							abpixel =
-							nsfb_plot_ablend(
-								abpixel,
-								pixel_to_colour(
-								nsfb,
-								*(pvideo_pos +
-								xloop)));
-						}
-						*(pvideo_pos + xloop) =
-								colour_to_pixel(
-								nsfb, abpixel);
-					}
-				}
-			}
-			yoff += bmp_stride;
-		}
-	} else {
-		for (; pvideo < pvideo_limit;
-				pvideo += PLOT_LINELEN(nsfb->linelen)) {
-			pvideo_pos = pvideo;
-			for (t = 0; t < 1; t++) {
-				for (xloop = xoff; xloop < width; xloop++) {
-					abpixel = pixel[yoff + xloop];
-					*(pvideo + xloop - xoff) =
-							colour_to_pixel(
-								nsfb,
-								abpixel);
-				}
-			}
-			pvideo_pos += width - xoff;
-			for (; t < tiles_x - 1; t++) {
-				for (xloop = 0; xloop < width; xloop++) {
-					abpixel = pixel[yoff + xloop];
-					*(pvideo_pos + xloop) =
-							colour_to_pixel(
-								nsfb,
-								abpixel);
-				}
-				pvideo_pos += width;
-			}
-			for (; t < tiles_x; t++) {
-				for (xloop = 0; xloop < xlim; xloop++) {
-					abpixel = pixel[yoff + xloop];
-					*(pvideo_pos + xloop) =
-							colour_to_pixel(
-								nsfb,
-								abpixel);
-				}
+	/* plot the image, each row is split into runs which end at the tile
+	 * or render area edges. The first run starts part way into a tile
+	 * when the left of the area is clipped. */
+	for (; pvideo < pvideo_limit; pvideo += PLOT_LINELEN(nsfb->linelen)) {
+		pvideo_pos = pvideo;
+		start = xoff;
+		for (remain = rwidth; remain > 0; remain -= count) {
+			count = width - start;
+			if (count > remain)
+				count = remain;
+
+			if (alpha) {
+				colours_blend_row(nsfb, pvideo_pos,
+						  pixel + yoff + start, count);
+			} else {
+				colours_to_row(nsfb, pvideo_pos,
+					       pixel + yoff + start, count);
 			}
-			yoff += bmp_stride;
+
+			pvideo_pos += count;
+			start = 0;
 		}
+		yoff += bmp_stride;
 	}
 
 	return true;
@@ -678,7 +955,7 @@ bitmap_tiles(nsfb_t *nsfb,
 	bool set_dither = false; /* true iff we enabled dithering here */
 
 	/* Avoid pointless rendering */
-	if (width == 0 || height == 0)
+	if (width <= 0 || height <= 0)
 		return true;
 
 	render_area.x0 = loc->x0;
@@ -689,9 +966,12 @@ bitmap_tiles(nsfb_t *nsfb,
 	if (!nsfb_plot_clip_ctx(nsfb, &render_area))
 		return true;
 
-	/* Enable error diffusion for paletted screens, if not already on,
-	 * if not scaled or if not repeating in x direction */
-	if ((!scaled || tiles_x == 1) && nsfb->palette != NULL &&
+	/* Enable dithering for paletted screens, if not already on. Error
+	 * diffusion is only used if not scaled or if not repeating in x
+	 * direction; ordered dithering does not depend on plotting order */
+	if (nsfb->palette != NULL &&
+			(!scaled || tiles_x == 1 ||
+			 nsfb->palette->dither_type == NSFB_PLOT_DITHER_ORDERED) &&
 			nsfb_palette_dithering_on(nsfb->palette) == false) {
 		nsfb_palette_dither_init(nsfb->palette,
 				render_area.x1 - render_area.x0);
@@ -723,9 +1003,9 @@ bitmap_tiles(nsfb_t *nsfb,
 				tloc.x0 += width;
 				tloc.x1 += width;
 			}
-			tloc.x0 = loc->x0;
+			tloc.x0 = loc->x0 + skip;
 			tloc.y0 += height;
-			tloc.x1 = loc->x1;
+			tloc.x1 = loc->x1 + skip;
 			tloc.y1 += height;
 		}
 	} else {
@@ -764,7 +1044,7 @@ bitmap_tiles(nsfb_t *nsfb,
 static bool readrect(nsfb_t *nsfb, nsfb_bbox_t *rect, nsfb_colour_t *buffer)
 {
         PLOT_TYPE *pvideo;
-        int xloop, yloop;
+        int yloop;
         int width;
 
         if (!nsfb_plot_clip_ctx(nsfb, rect)) {
@@ -776,10 +1056,8 @@ static bool readrect(nsfb_t *nsfb, nsfb_bbox_t *rect, nsfb_colour_t *buffer)
         pvideo = get_xy_loc(nsfb, rect->x0, rect->y0);
 
         for (yloop = rect->y0; yloop < rect->y1; yloop += 1) {
-                for (xloop = 0; xloop < width; xloop++) {
-                        *buffer = pixel_to_colour(nsfb, *(pvideo + xloop));
-                        buffer++;
-                }
+                row_to_colours(nsfb, buffer, pvideo, width);
+                buffer += width;
                 pvideo += PLOT_LINELEN(nsfb->linelen);
         }
         return true;
@@ -0,0 +1,675 @@
+/*
+ * Copyright 2026 libnsfb contributors
+ *
+ * This file is part of libnsfb, http://www.netsurf-browser.org/
+ * Licenced under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/** \file
+ * Row conversion between colours and native pixels (implementation).
+ *
+ * Each supported pixel format has a scalar converter in each direction,
+ * which the vector versions also use for the pixels left over at the end
+ * of a row. The scalar conversions are the same as the per format
+ * plotters so rows produced here are bit identical to the pixels they
+ * would plot one at a time.
+ *
+ * Only little endian layouts are provided; on big endian hosts no
+ * converters are selected and the plotters convert each pixel.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libnsfb.h"
+#include "libnsfb_plot.h"
+
+#include "nsfb.h"
+#include "plot.h"
+
+#ifndef NSFB_BE_BYTE_ORDER
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define NSFB_CONVERT_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#define NSFB_CONVERT_NEON 1
+#include <arm_neon.h>
+#endif
+
+static void
+from_colour_xbgr(void *dst, const nsfb_colour_t *src, int width)
+{
+	memcpy(dst, src, width * sizeof(nsfb_colour_t));
+}
+
+static void
+to_colour_xbgr(nsfb_colour_t *dst, const void *src, int width)
+{
+	const uint32_t *pixel = src;
+	int x;
+
+	for (x = 0; x < width; x++)
+		dst[x] = pixel[x] | 0xFF000000U;
+}
+
+/* red and blue swap places and alpha is dropped in both directions */
+static void
+from_colour_xrgb(void *dst, const nsfb_colour_t *src, int width)
+{
+	uint32_t *pixel = dst;
+	int x;
+
+	for (x = 0; x < width; x++)
+		pixel[x] = ((src[x] & 0xFF0000) >> 16) |
+			(src[x] & 0xFF00) |
+			((src[x] & 0xFF) << 16);
+}
+
+static void
+to_colour_xrgb(nsfb_colour_t *dst, const void *src, int width)
+{
+	from_colour_xrgb(dst, src, width);
+}
+
+static void
+from_colour_rgb565(void *dst, const nsfb_colour_t *src, int width)
+{
+	uint16_t *pixel = dst;
+	int x;
+
+	for (x = 0; x < width; x++)
+		pixel[x] = ((src[x] & 0xF8) << 8) |
+			((src[x] & 0xFC00) >> 5) |
+			((src[x] & 0xF80000) >> 19);
+}
+
+static void
+to_colour_rgb565(nsfb_colour_t *dst, const void *src, int width)
+{
+	const uint16_t *pixel = src;
+	int x;
+
+	for (x = 0; x < width; x++)
+		dst[x] = ((pixel[x] & 0x1F) << 19) |
+			((pixel[x] & 0x7E0) << 5) |
+			((pixel[x] & 0xF800) >> 8);
+}
+
+/* the alpha bit is the top bit of the colours alpha */
+static void
+from_colour_argb1555(void *dst, const nsfb_colour_t *src, int width)
+{
+	uint16_t *pixel = dst;
+	int x;
+
+	for (x = 0; x < width; x++)
+		pixel[x] = ((src[x] >> 16) & 0x8000) |
+			((src[x] & 0xF8) << 7) |
+			((src[x] & 0xF800) >> 6) |
+			((src[x] & 0xF80000) >> 19);
+}
+
+static void
+to_colour_argb1555(nsfb_colour_t *dst, const void *src, int width)
+{
+	const uint16_t *pixel = src;
+	int x;
+
+	for (x = 0; x < width; x++)
+		dst[x] = ((pixel[x] & 0x8000) ? 0xFF000000U : 0) |
+			((pixel[x] & 0x7C00) >> 7) |
+			((pixel[x] & 0x3E0) << 6) |
+			((pixel[x] & 0x1F) << 19);
+}
+
+/* pixels are three bytes, blue green red, with no alpha */
+static void
+from_colour_rgb888(void *dst, const nsfb_colour_t *src, int width)
+{
+	uint8_t *pixel = dst;
+	int x;
+
+	for (x = 0; x < width; x++, pixel += 3) {
+		pixel[0] = src[x] >> 16;
+		pixel[1] = src[x] >> 8;
+		pixel[2] = src[x];
+	}
+}
+
+static void
+to_colour_rgb888(nsfb_colour_t *dst, const void *src, int width)
+{
+	const uint8_t *pixel = src;
+	int x;
+
+	for (x = 0; x < width; x++, pixel += 3)
+		dst[x] = pixel[2] | (pixel[1] << 8) | (pixel[0] << 16);
+}
+
+#endif /* NSFB_BE_BYTE_ORDER */
+
+#ifdef NSFB_CONVERT_X86
+
+static void
+to_colour_xbgr_sse2(nsfb_colour_t *dst, const void *src, int width)
+{
+	const uint32_t *pixel = src;
+	const __m128i alpha = _mm_set1_epi32(0xFF000000);
+
+	for (; width >= 4; width -= 4, dst += 4, pixel += 4)
+		_mm_storeu_si128((void *)dst,
+			_mm_or_si128(_mm_loadu_si128((const void *)pixel),
+				     alpha));
+
+	to_colour_xbgr(dst, pixel, width);
+}
+
+static inline __m128i swizzle_sse2(__m128i s)
+{
+	__m128i rb;
+
+	rb = _mm_and_si128(s, _mm_set1_epi32(0x00FF00FF));
+	rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+	return _mm_or_si128(_mm_and_si128(rb, _mm_set1_epi32(0x00FF00FF)),
+			    _mm_and_si128(s, _mm_set1_epi32(0x0000FF00)));
+}
+
+static void
+from_colour_xrgb_sse2(void *dst, const nsfb_colour_t *src, int width)
+{
+	uint32_t *pixel = dst;
+
+	for (; width >= 4; width -= 4, src += 4, pixel += 4)
+		_mm_storeu_si128((void *)pixel,
+			swizzle_sse2(_mm_loadu_si128((const void *)src)));
+
+	from_colour_xrgb(pixel, src, width);
+}
+
+static void
+to_colour_xrgb_sse2(nsfb_colour_t *dst, const void *src, int width)
+{
+	from_colour_xrgb_sse2(dst, src, width);
+}
+
+/**
+ * Pack eight 16bit pixel values held in 32bit lanes.
+ *
+ * The pack saturates signed values so the lanes are sign extended first
+ * to pass values with the top bit set through unchanged.
+ */
+static inline __m128i pack16_sse2(__m128i lo, __m128i hi)
+{
+	return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(lo, 16), 16),
+			       _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16));
+}
+
+static inline __m128i rgb565_sse2(__m128i c)
+{
+	return _mm_or_si128(
+		_mm_or_si128(
+			_mm_slli_epi32(_mm_and_si128(c, _mm_set1_epi32(0xF8)),
+				       8),
+			_mm_srli_epi32(_mm_and_si128(c, _mm_set1_epi32(0xFC00)),
+				       5)),
+		_mm_srli_epi32(_mm_and_si128(c, _mm_set1_epi32(0xF80000)), 19));
+}
+
+static void
+from_colour_rgb565_sse2(void *dst, const nsfb_colour_t *src, int width)
+{
+	uint16_t *pixel = dst;
+
+	for (; width >= 8; width -= 8, src += 8, pixel += 8)
+		_mm_storeu_si128((void *)pixel, pack16_sse2(
+			rgb565_sse2(_mm_loadu_si128((const void *)src)),
+			rgb565_sse2(_mm_loadu_si128((const void *)(src + 4)))));
+
+	from_colour_rgb565(pixel, src, width);
+}
+
+static inline __m128i colour565_sse2(__m128i p)
+{
+	return _mm_or_si128(
+		_mm_or_si128(
+			_mm_slli_epi32(_mm_and_si128(p, _mm_set1_epi32(0x1F)),
+				       19),
+			_mm_slli_epi32(_mm_and_si128(p, _mm_set1_epi32(0x7E0)),
+				       5)),
+		_mm_srli_epi32(_mm_and_si128(p, _mm_set1_epi32(0xF800)), 8));
+}
+
+static void
+to_colour_rgb565_sse2(nsfb_colour_t *dst, const void *src, int width)
+{
+	const uint16_t *pixel = src;
+	const __m128i zero = _mm_setzero_si128();
+	__m128i p;
+
+	for (; width >= 8; width -= 8, dst += 8, pixel += 8) {
+		p = _mm_loadu_si128((const void *)pixel);
+		_mm_storeu_si128((void *)dst,
+				 colour565_sse2(_mm_unpacklo_epi16(p, zero)));
+		_mm_storeu_si128((void *)(dst + 4),
+				 colour565_sse2(_mm_unpackhi_epi16(p, zero)));
+	}
+
+	to_colour_rgb565(dst, pixel, width);
+}
+
+static inline __m128i argb1555_sse2(__m128i c)
+{
+	return _mm_or_si128(
+		_mm_or_si128(
+			_mm_and_si128(_mm_srli_epi32(c, 16),
+				      _mm_set1_epi32(0x8000)),
+			_mm_slli_epi32(_mm_and_si128(c, _mm_set1_epi32(0xF8)),
+				       7)),
+		_mm_or_si128(
+			_mm_srli_epi32(_mm_and_si128(c, _mm_set1_epi32(0xF800)),
+				       6),
+			_mm_srli_epi32(_mm_and_si128(c,
+						_mm_set1_epi32(0xF80000)),
+				       19)));
+}
+
+static void
+from_colour_argb1555_sse2(void *dst, const nsfb_colour_t *src, int width)
+{
+	uint16_t *pixel = dst;
+
+	for (; width >= 8; width -= 8, src += 8, pixel += 8)
+		_mm_storeu_si128((void *)pixel, pack16_sse2(
+			argb1555_sse2(_mm_loadu_si128((const void *)src)),
+			argb1555_sse2(_mm_loadu_si128((const void *)(src + 4)))));
+
+	from_colour_argb1555(pixel, src, width);
+}
+
+static inline __m128i colour1555_sse2(__m128i p)
+{
+	/* replicate the alpha bit across the top byte */
+	__m128i a = _mm_and_si128(_mm_srai_epi32(_mm_slli_epi32(p, 16), 31),
+				  _mm_set1_epi32(0xFF000000));
+
+	return _mm_or_si128(
+		_mm_or_si128(a,
+			_mm_srli_epi32(_mm_and_si128(p, _mm_set1_epi32(0x7C00)),
+				       7)),
+		_mm_or_si128(
+			_mm_slli_epi32(_mm_and_si128(p, _mm_set1_epi32(0x3E0)),
+				       6),
+			_mm_slli_epi32(_mm_and_si128(p, _mm_set1_epi32(0x1F)),
+				       19)));
+}
+
+static void
+to_colour_argb1555_sse2(nsfb_colour_t *dst, const void *src, int width)
+{
+	const uint16_t *pixel = src;
+	const __m128i zero = _mm_setzero_si128();
+	__m128i p;
+
+	for (; width >= 8; width -= 8, dst += 8, pixel += 8) {
+		p = _mm_loadu_si128((const void *)pixel);
+		_mm_storeu_si128((void *)dst,
+				 colour1555_sse2(_mm_unpacklo_epi16(p, zero)));
+		_mm_storeu_si128((void *)(dst + 4),
+				 colour1555_sse2(_mm_unpackhi_epi16(p, zero)));
+	}
+
+	to_colour_argb1555(dst, pixel, width);
+}
+
+/* The three byte format needs a byte shuffle which SSE2 does not have.
+ * Each iteration converts four pixels with one sixteen byte access of
+ * which only twelve bytes are pixels, so the loops stop while at least
+ * two more pixels remain to keep the access inside the row.
+ */
+__attribute__((target("ssse3")))
+static void
+from_colour_rgb888_ssse3(void *dst, const nsfb_colour_t *src, int width)
+{
+	const __m128i shuf = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+					   14, 13, 12, -1, -1, -1, -1);
+	uint8_t *pixel = dst;
+
+	for (; width >= 6; width -= 4, src += 4, pixel += 12)
+		_mm_storeu_si128((void *)pixel, _mm_shuffle_epi8(
+				_mm_loadu_si128((const void *)src), shuf));
+
+	from_colour_rgb888(pixel, src, width);
+}
+
+__attribute__((target("ssse3")))
+static void
+to_colour_rgb888_ssse3(nsfb_colour_t *dst, const void *src, int width)
+{
+	const __m128i shuf = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1,
+					   8, 7, 6, -1, 11, 10, 9, -1);
+	const uint8_t *pixel = src;
+
+	for (; width >= 6; width -= 4, dst += 4, pixel += 12)
+		_mm_storeu_si128((void *)dst, _mm_shuffle_epi8(
+				_mm_loadu_si128((const void *)pixel), shuf));
+
+	to_colour_rgb888(dst, pixel, width);
+}
+
+#endif /* NSFB_CONVERT_X86 */
+
+#ifdef NSFB_CONVERT_NEON
+
+static void
+to_colour_xbgr_neon(nsfb_colour_t *dst, const void *src, int width)
+{
+	const uint32_t *pixel = src;
+	const uint32x4_t alpha = vdupq_n_u32(0xFF000000);
+
+	for (; width >= 4; width -= 4, dst += 4, pixel += 4)
+		vst1q_u32(dst, vorrq_u32(vld1q_u32(pixel), alpha));
+
+	to_colour_xbgr(dst, pixel, width);
+}
+
+static void
+from_colour_xrgb_neon(void *dst, const nsfb_colour_t *src, int width)
+{
+	uint8_t *pixel = dst;
+	uint8x16x4_t c;
+	uint8x16_t t;
+
+	for (; width >= 16; width -= 16, src += 16, pixel += 64) {
+		c = vld4q_u8((const uint8_t *)src);
+		t = c.val[0];
+		c.val[0] = c.val[2];
+		c.val[2] = t;
+		c.val[3] = vdupq_n_u8(0);
+		vst4q_u8(pixel, c);
+	}
+
+	from_colour_xrgb(pixel, src, width);
+}
+
+static void
+to_colour_xrgb_neon(nsfb_colour_t *dst, const void *src, int width)
+{
+	from_colour_xrgb_neon(dst, src, width);
+}
+
+static void
+from_colour_rgb565_neon(void *dst, const nsfb_colour_t *src, int width)
+{
+	uint16_t *pixel = dst;
+	uint8x8x4_t c;
+
+	for (; width >= 8; width -= 8, src += 8, pixel += 8) {
+		c = vld4_u8((const uint8_t *)src);
+		vst1q_u16(pixel, vorrq_u16(
+			vorrq_u16(vshll_n_u8(vand_u8(c.val[0],
+						     vdup_n_u8(0xF8)), 8),
+				  vshll_n_u8(vand_u8(c.val[1],
+						     vdup_n_u8(0xFC)), 3)),
+			vmovl_u8(vshr_n_u8(c.val[2], 3))));
+	}
+
+	from_colour_rgb565(pixel, src, width);
+}
+
+static void
+to_colour_rgb565_neon(nsfb_colour_t *dst, const void *src, int width)
+{
+	const uint16_t *pixel = src;
+	uint16x8_t p;
+	uint8x8x4_t c;
+
+	for (; width >= 8; width -= 8, dst += 8, pixel += 8) {
+		p = vld1q_u16(pixel);
+		c.val[0] = vand_u8(vshrn_n_u16(p, 8), vdup_n_u8(0xF8));
+		c.val[1] = vand_u8(vshrn_n_u16(p, 3), vdup_n_u8(0xFC));
+		c.val[2] = vmovn_u16(vshlq_n_u16(p, 3));
+		c.val[2] = vand_u8(c.val[2], vdup_n_u8(0xF8));
+		c.val[3] = vdup_n_u8(0);
+		vst4_u8((uint8_t *)dst, c);
+	}
+
+	to_colour_rgb565(dst, pixel, width);
+}
+
+static void
+from_colour_argb1555_neon(void *dst, const nsfb_colour_t *src, int width)
+{
+	uint16_t *pixel = dst;
+	uint8x8x4_t c;
+
+	for (; width >= 8; width -= 8, src += 8, pixel += 8) {
+		c = vld4_u8((const uint8_t *)src);
+		vst1q_u16(pixel, vorrq_u16(
+			vorrq_u16(vshll_n_u8(vand_u8(c.val[3],
+						     vdup_n_u8(0x80)), 8),
+				  vshll_n_u8(vand_u8(c.val[0],
+						     vdup_n_u8(0xF8)), 7)),
+			vorrq_u16(vshll_n_u8(vand_u8(c.val[1],
+						     vdup_n_u8(0xF8)), 2),
+				  vmovl_u8(vshr_n_u8(c.val[2], 3)))));
+	}
+
+	from_colour_argb1555(pixel, src, width);
+}
+
+static void
+to_colour_argb1555_neon(nsfb_colour_t *dst, const void *src, int width)
+{
+	const uint16_t *pixel = src;
+	uint16x8_t p;
+	uint8x8x4_t c;
+
+	for (; width >= 8; width -= 8, dst += 8, pixel += 8) {
+		p = vld1q_u16(pixel);
+		c.val[0] = vand_u8(vshrn_n_u16(p, 7), vdup_n_u8(0xF8));
+		c.val[1] = vand_u8(vshrn_n_u16(p, 2), vdup_n_u8(0xF8));
+		c.val[2] = vmovn_u16(vshlq_n_u16(p, 3));
+		c.val[2] = vand_u8(c.val[2], vdup_n_u8(0xF8));
+		/* replicate the alpha bit across the alpha byte */
+		c.val[3] = vmovn_u16(vmulq_n_u16(vshrq_n_u16(p, 15), 0xFF));
+		vst4_u8((uint8_t *)dst, c);
+	}
+
+	to_colour_argb1555(dst, pixel, width);
+}
+
+static void
+from_colour_rgb888_neon(void *dst, const nsfb_colour_t *src, int width)
+{
+	uint8_t *pixel = dst;
+	uint8x16x4_t c;
+	uint8x16x3_t p;
+
+	for (; width >= 16; width -= 16, src += 16, pixel += 48) {
+		c = vld4q_u8((const uint8_t *)src);
+		p.val[0] = c.val[2];
+		p.val[1] = c.val[1];
+		p.val[2] = c.val[0];
+		vst3q_u8(pixel, p);
+	}
+
+	from_colour_rgb888(pixel, src, width);
+}
+
+static void
+to_colour_rgb888_neon(nsfb_colour_t *dst, const void *src, int width)
+{
+	const uint8_t *pixel = src;
+	uint8x16x3_t p;
+	uint8x16x4_t c;
+
+	for (; width >= 16; width -= 16, dst += 16, pixel += 48) {
+		p = vld3q_u8(pixel);
+		c.val[0] = p.val[2];
+		c.val[1] = p.val[1];
+		c.val[2] = p.val[0];
+		c.val[3] = vdupq_n_u8(0);
+		vst4q_u8((uint8_t *)dst, c);
+	}
+
+	to_colour_rgb888(dst, pixel, width);
+}
+
+#endif /* NSFB_CONVERT_NEON */
+
+/* exported interface documented in plot.h */
+nsfb_row_from_colour_t *nsfb_row_from_colour_select(enum nsfb_format_e format)
+{
+#ifndef NSFB_BE_BYTE_ORDER
+	unsigned int features = nsfb_cpu_features();
+
+	switch (format) {
+	case NSFB_FMT_XBGR8888:
+	case NSFB_FMT_ABGR8888:
+		/* pixels are the colour values */
+		return from_colour_xbgr;
+
+	case NSFB_FMT_XRGB8888:
+	case NSFB_FMT_ARGB8888:
+#ifdef NSFB_CONVERT_X86
+		if (features & NSFB_CPU_SSE2)
+			return from_colour_xrgb_sse2;
+#endif
+#ifdef NSFB_CONVERT_NEON
+		if (features & NSFB_CPU_NEON)
+			return from_colour_xrgb_neon;
+#endif
+		return from_colour_xrgb;
+
+	case NSFB_FMT_RGB565:
+#ifdef NSFB_CONVERT_X86
+		if (features & NSFB_CPU_SSE2)
+			return from_colour_rgb565_sse2;
+#endif
+#ifdef NSFB_CONVERT_NEON
+		if (features & NSFB_CPU_NEON)
+			return from_colour_rgb565_neon;
+#endif
+		return from_colour_rgb565;
+
+	case NSFB_FMT_ARGB1555:
+#ifdef NSFB_CONVERT_X86
+		if (features & NSFB_CPU_SSE2)
+			return from_colour_argb1555_sse2;
+#endif
+#ifdef NSFB_CONVERT_NEON
+		if (features & NSFB_CPU_NEON)
+			return from_colour_argb1555_neon;
+#endif
+		return from_colour_argb1555;
+
+	case NSFB_FMT_RGB888:
+#ifdef NSFB_CONVERT_X86
+		if (features & NSFB_CPU_SSSE3)
+			return from_colour_rgb888_ssse3;
+#endif
+#ifdef NSFB_CONVERT_NEON
+		if (features & NSFB_CPU_NEON)
+			return from_colour_rgb888_neon;
+#endif
+		return from_colour_rgb888;
+
+	default:
+		break;
+	}
+
+	(void)features;
+#else
+	(void)format;
+#endif
+
+	return NULL;
+}
+
+/* exported interface documented in plot.h */
+nsfb_row_to_colour_t *nsfb_row_to_colour_select(enum nsfb_format_e format)
+{
+#ifndef NSFB_BE_BYTE_ORDER
+	unsigned int features = nsfb_cpu_features();
+
+	switch (format) {
+	case NSFB_FMT_XBGR8888:
+	case NSFB_FMT_ABGR8888:
+#ifdef NSFB_CONVERT_X86
+		if (features & NSFB_CPU_SSE2)
+			return to_colour_xbgr_sse2;
+#endif
+#ifdef NSFB_CONVERT_NEON
+		if (features & NSFB_CPU_NEON)
+			return to_colour_xbgr_neon;
+#endif
+		return to_colour_xbgr;
+
+	case NSFB_FMT_XRGB8888:
+	case NSFB_FMT_ARGB8888:
+#ifdef NSFB_CONVERT_X86
+		if (features & NSFB_CPU_SSE2)
+			return to_colour_xrgb_sse2;
+#endif
+#ifdef NSFB_CONVERT_NEON
+		if (features & NSFB_CPU_NEON)
+			return to_colour_xrgb_neon;
+#endif
+		return to_colour_xrgb;
+
+	case NSFB_FMT_RGB565:
+#ifdef NSFB_CONVERT_X86
+		if (features & NSFB_CPU_SSE2)
+			return to_colour_rgb565_sse2;
+#endif
+#ifdef NSFB_CONVERT_NEON
+		if (features & NSFB_CPU_NEON)
+			return to_colour_rgb565_neon;
+#endif
+		return to_colour_rgb565;
+
+	case NSFB_FMT_ARGB1555:
+#ifdef NSFB_CONVERT_X86
+		if (features & NSFB_CPU_SSE2)
+			return to_colour_argb1555_sse2;
+#endif
+#ifdef NSFB_CONVERT_NEON
+		if (features & NSFB_CPU_NEON)
+			return to_colour_argb1555_neon;
+#endif
+		return to_colour_argb1555;
+
+	case NSFB_FMT_RGB888:
+#ifdef NSFB_CONVERT_X86
+		if (features & NSFB_CPU_SSSE3)
+			return to_colour_rgb888_ssse3;
+#endif
+#ifdef NSFB_CONVERT_NEON
+		if (features & NSFB_CPU_NEON)
+			return to_colour_rgb888_neon;
+#endif
+		return to_colour_rgb888;
+
+	default:
+		break;
+	}
+
+	(void)features;
+#else
+	(void)format;
+#endif
+
+	return NULL;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset:8
+ * End:
+ */
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2026 libnsfb contributors
+ *
+ * This file is part of libnsfb, http://www.netsurf-browser.org/
+ * Licenced under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/** \file
+ * Processor feature detection for the accelerated plotters (implementation).
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__linux__) && defined(__arm__) && !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include "libnsfb.h"
+#include "libnsfb_plot.h"
+
+#include "nsfb.h"
+#include "plot.h"
+
+/* exported interface documented in plot.h */
+unsigned int nsfb_cpu_features(void)
+{
+	static bool probed = false;
+	static unsigned int features = 0;
+
+	if (probed)
+		return features;
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		features |= NSFB_CPU_SSE2;
+	if (__builtin_cpu_supports("ssse3"))
+		features |= NSFB_CPU_SSSE3;
+	if (__builtin_cpu_supports("avx2"))
+		features |= NSFB_CPU_AVX2;
+#endif
+
+#if defined(__aarch64__)
+	features |= NSFB_CPU_NEON;
+#elif defined(__ARM_NEON)
+#if defined(__linux__)
+	if ((getauxval(AT_HWCAP) & HWCAP_NEON) != 0)
+		features |= NSFB_CPU_NEON;
+#else
+	features |= NSFB_CPU_NEON;
+#endif
+#endif
+
+	probed = true;
+
+	return features;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset:8
+ * End:
+ */
@@ -0,0 +1,1367 @@
+/*
+ * Copyright 2026 libnsfb contributors
+ *
+ * This file is part of libnsfb, http://www.netsurf-browser.org/
+ * Licenced under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/** \file
+ * Display list recording and execution (implementation).
+ */
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libnsfb.h"
+#include "libnsfb_plot.h"
+#include "libnsfb_plot_util.h"
+
+#include "nsfb.h"
+#include "plot.h"
+#include "dlist.h"
+#include "palette.h"
+#include "tiles.h"
+
+/** Number of opaque areas remembered while culling */
+#define DLIST_OCCLUDER_MAX 16
+
+/** Alignment of the arguments in the data buffer */
+#define DLIST_DATA_ALIGN 8
+
+/** Recorded operation types */
+enum nsfb_dlist_type_e {
+	NSFB_DLIST_NONE = 0, /**< Dropped operation */
+	NSFB_DLIST_FILL,
+	NSFB_DLIST_RECTANGLE,
+	NSFB_DLIST_LINES,
+	NSFB_DLIST_POLYLINES,
+	NSFB_DLIST_SPANS,
+	NSFB_DLIST_POLYGON,
+	NSFB_DLIST_ARC,
+	NSFB_DLIST_PIE,
+	NSFB_DLIST_POINT,
+	NSFB_DLIST_ELLIPSE,
+	NSFB_DLIST_ELLIPSE_FILL,
+	NSFB_DLIST_BITMAP,
+	NSFB_DLIST_BITMAP_TILES,
+	NSFB_DLIST_GLYPH8,
+	NSFB_DLIST_GLYPH1,
+	NSFB_DLIST_QUADRATIC,
+	NSFB_DLIST_CUBIC,
+	NSFB_DLIST_PATH,
+};
+
+/** A recorded operation. */
+struct nsfb_dlist_op_s {
+	enum nsfb_dlist_type_e type; /**< Type of operation */
+	bool opaque; /**< Every pixel in bounds is replaced */
+	int clip; /**< Index of the clip rectangle */
+	int count; /**< Number of items in a list argument */
+	nsfb_colour_t c; /**< Colour */
+	nsfb_bbox_t bounds; /**< Clipped area the operation can change */
+	size_t data; /**< Offset of the arguments in the data buffer */
+};
+
+/** A pen with the stroke style it was recorded with */
+struct dlist_pen {
+	nsfb_plot_pen_t pen;
+	nsfb_plot_cap_t cap;
+	nsfb_plot_join_t join;
+};
+
+/** Arguments of a rectangle outline */
+struct dlist_rectangle {
+	nsfb_bbox_t rect;
+	int line_width;
+	bool dotted;
+	bool dashed;
+};
+
+/** Arguments of an arc or pie */
+struct dlist_arc {
+	int x;
+	int y;
+	int radius;
+	int angle1;
+	int angle2;
+};
+
+/** Arguments of a bitmap */
+struct dlist_bitmap {
+	nsfb_bbox_t loc;
+	const nsfb_colour_t *pixel;
+	int width;
+	int height;
+	int stride;
+	int tiles_x;
+	int tiles_y;
+	bool alpha;
+	nsfb_plot_filter_t filter;
+};
+
+/** Arguments of a glyph, followed by its pixel rows */
+struct dlist_glyph {
+	nsfb_bbox_t loc;
+	int pitch;
+};
+
+/** Arguments of a bezier curve */
+struct dlist_bezier {
+	struct dlist_pen pen;
+	nsfb_bbox_t curve;
+	nsfb_point_t ctrla;
+	nsfb_point_t ctrlb;
+};
+
+static inline void *dlist_args(struct nsfb_dlist_s *dlist, size_t offset)
+{
+	return dlist->data + offset;
+}
+
+/** Find the clip index for a new operation, adding the current clip. */
+static bool dlist_clip(nsfb_t *nsfb, int *index)
+{
+	struct nsfb_dlist_s *dlist = &nsfb->dlist;
+	nsfb_bbox_t *last;
+	nsfb_bbox_t *clip;
+
+	if (dlist->clipc > 0) {
+		last = &dlist->clip[dlist->clipc - 1];
+		if ((last->x0 == nsfb->clip.x0) && (last->y0 == nsfb->clip.y0) &&
+		    (last->x1 == nsfb->clip.x1) && (last->y1 == nsfb->clip.y1)) {
+			*index = dlist->clipc - 1;
+			return true;
+		}
+	}
+
+	if (dlist->clipc == dlist->clip_size) {
+		clip = realloc(dlist->clip, (dlist->clip_size + 16) *
+			       sizeof(nsfb_bbox_t));
+		if (clip == NULL)
+			return false;
+		dlist->clip = clip;
+		dlist->clip_size += 16;
+	}
+
+	dlist->clip[dlist->clipc] = nsfb->clip;
+	*index = dlist->clipc++;
+
+	return true;
+}
+
+/** Reserve argument data for a new operation. */
+static bool dlist_data(struct nsfb_dlist_s *dlist, size_t size, size_t *offset)
+{
+	unsigned char *data;
+	size_t need;
+
+	size = (size + DLIST_DATA_ALIGN - 1) & ~(size_t)(DLIST_DATA_ALIGN - 1);
+	need = dlist->data_used + size;
+
+	if (need > dlist->data_size) {
+		if (need < dlist->data_size * 2)
+			need = dlist->data_size * 2;
+		if (need < 4096)
+			need = 4096;
+		data = realloc(dlist->data, need);
+		if (data == NULL)
+			return false;
+		dlist->data = data;
+		dlist->data_size = need;
+	}
+
+	*offset = dlist->data_used;
+	dlist->data_used += size;
+
+	return true;
+}
+
+/**
+ * Append an operation to a context's display list
+ *
+ * Operations which can not change anything inside the current clip are
+ * not recorded.
+ *
+ * \param nsfb The context.
+ * \param type The type of operation.
+ * \param bounds The area the operation can change, which is clipped.
+ * \param size The number of bytes of arguments to reserve.
+ * \param op_out Updated with the new operation or NULL if none was needed.
+ * \return true on success or false if the storage could not be allocated.
+ */
+static bool
+dlist_add(nsfb_t *nsfb,
+	  enum nsfb_dlist_type_e type,
+	  nsfb_bbox_t *bounds,
+	  size_t size,
+	  struct nsfb_dlist_op_s **op_out)
+{
+	struct nsfb_dlist_s *dlist = &nsfb->dlist;
+	struct nsfb_dlist_op_s *op;
+	size_t offset = 0;
+	int clip;
+
+	*op_out = NULL;
+
+	if (!nsfb_plot_clip(&nsfb->clip, bounds) ||
+	    (bounds->x0 >= bounds->x1) || (bounds->y0 >= bounds->y1))
+		return true;
+
+	if (dlist->opc == dlist->op_size) {
+		op = realloc(dlist->op, (dlist->op_size + 64) *
+			     sizeof(struct nsfb_dlist_op_s));
+		if (op == NULL)
+			return false;
+		dlist->op = op;
+		dlist->op_size += 64;
+	}
+
+	if (!dlist_clip(nsfb, &clip))
+		return false;
+
+	if ((size > 0) && !dlist_data(dlist, size, &offset))
+		return false;
+
+	op = &dlist->op[dlist->opc++];
+	op->type = type;
+	op->opaque = false;
+	op->clip = clip;
+	op->count = 0;
+	op->c = 0;
+	op->bounds = *bounds;
+	op->data = offset;
+
+	*op_out = op;
+
+	return true;
+}
+
+/** Start bounds which hold no points. */
+static inline void dlist_bounds_empty(nsfb_bbox_t *bounds)
+{
+	bounds->x0 = bounds->y0 = INT_MAX;
+	bounds->x1 = bounds->y1 = INT_MIN;
+}
+
+/** Widen bounds to hold a point. */
+static inline void dlist_bounds_add(nsfb_bbox_t *bounds, int x, int y)
+{
+	if (x < bounds->x0)
+		bounds->x0 = x;
+	if (x > bounds->x1)
+		bounds->x1 = x;
+	if (y < bounds->y0)
+		bounds->y0 = y;
+	if (y > bounds->y1)
+		bounds->y1 = y;
+}
+
+/**
+ * Turn bounds holding points into the area of pixels plotted around them
+ *
+ * \param bounds The bounds of the points.
+ * \param margin The furthest a plotted pixel can be from the points.
+ */
+static inline void dlist_bounds_widen(nsfb_bbox_t *bounds, int margin)
+{
+	bounds->x0 -= margin;
+	bounds->y0 -= margin;
+	bounds->x1 += margin + 1;
+	bounds->y1 += margin + 1;
+}
+
+/** The furthest a stroke can reach from the points it is drawn through. */
+static inline int dlist_pen_margin(const nsfb_plot_pen_t *pen)
+{
+	/* mitered joins are limited to twice the width */
+	if (pen->stroke_width > 1)
+		return (pen->stroke_width * 2) + 1;
+
+	return 1;
+}
+
+/** Record a pen with the context's current stroke style. */
+static inline void
+dlist_pen_record(nsfb_t *nsfb, struct dlist_pen *args,
+		 const nsfb_plot_pen_t *pen)
+{
+	args->pen = *pen;
+	args->cap = nsfb->stroke_cap;
+	args->join = nsfb->stroke_join;
+}
+
+/** Restore the stroke style of a recorded pen and return the pen. */
+static inline nsfb_plot_pen_t *
+dlist_pen_replay(nsfb_t *nsfb, struct dlist_pen *args)
+{
+	nsfb->stroke_cap = args->cap;
+	nsfb->stroke_join = args->join;
+	return &args->pen;
+}
+
+/* exported interface documented in dlist.h */
+bool nsfb_dlist_clg(nsfb_t *nsfb, nsfb_colour_t c)
+{
+	return nsfb_dlist_fill(nsfb, &nsfb->clip, c);
+}
+
+/* exported interface documented in dlist.h */
+bool
+nsfb_dlist_rectangle(nsfb_t *nsfb,
+		     const nsfb_bbox_t *rect,
+		     int line_width,
+		     nsfb_colour_t c,
+		     bool dotted,
+		     bool dashed)
+{
+	struct nsfb_dlist_op_s *op;
+	struct dlist_rectangle *args;
+	nsfb_bbox_t bounds;
+
+	dlist_bounds_empty(&bounds);
+	dlist_bounds_add(&bounds, rect->x0, rect->y0);
+	dlist_bounds_add(&bounds, rect->x1, rect->y1);
+	dlist_bounds_widen(&bounds, (line_width > 1) ? (line_width * 2) + 1 : 1);
+
+	if (!dlist_add(nsfb, NSFB_DLIST_RECTANGLE, &bounds,
+		       sizeof(struct dlist_rectangle), &op))
+		return false;
+
+	if (op != NULL) {
+		op->c = c;
+		args = dlist_args(&nsfb->dlist, op->data);
+		args->rect = *rect;
+		args->line_width = line_width;
+		args->dotted = dotted;
+		args->dashed = dashed;
+	}
+
+	return true;
+}
+
+/* exported interface documented in dlist.h */
+bool nsfb_dlist_fill(nsfb_t *nsfb, const nsfb_bbox_t *rect, nsfb_colour_t c)
+{
+	struct nsfb_dlist_op_s *op;
+	nsfb_bbox_t bounds = *rect;
+
+	/* the clipped bounds are the rectangle the fill plots */
+	if (!dlist_add(nsfb, NSFB_DLIST_FILL, &bounds, 0, &op))
+		return false;
+
+	if (op != NULL) {
+		op->c = c;
+		op->opaque = true;
+	}
+
+	return true;
+}
+
+/* exported interface documented in dlist.h */
+bool
+nsfb_dlist_lines(nsfb_t *nsfb,
+		 int linec,
+		 const nsfb_bbox_t *line,
+		 const nsfb_plot_pen_t *pen)
+{
+	struct nsfb_dlist_op_s *op;
+	struct dlist_pen *args;
+	nsfb_bbox_t bounds;
+	int i;
+
+	if (linec <= 0)
+		return true;
+
+	dlist_bounds_empty(&bounds);
+	for (i = 0; i < linec; i++) {
+		dlist_bounds_add(&bounds, line[i].x0, line[i].y0);
+		dlist_bounds_add(&bounds, line[i].x1, line[i].y1);
+	}
+	dlist_bounds_widen(&bounds, dlist_pen_margin(pen));
+
+	if (!dlist_add(nsfb, NSFB_DLIST_LINES, &bounds,
+		       sizeof(struct dlist_pen) + linec * sizeof(nsfb_bbox_t),
+		       &op))
+		return false;
+
+	if (op != NULL) {
+		op->count = linec;
+		args = dlist_args(&nsfb->dlist, op->data);
+		dlist_pen_record(nsfb, args, pen);
+		memcpy(args + 1, line, linec * sizeof(nsfb_bbox_t));
+	}
+
+	return true;
+}
+
+/* exported interface documented in dlist.h */
+bool
+nsfb_dlist_polylines(nsfb_t *nsfb,
+		     int pointc,
+		     const nsfb_point_t *points,
+		     const nsfb_plot_pen_t *pen)
+{
+	struct nsfb_dlist_op_s *op;
+	struct dlist_pen *args;
+	nsfb_bbox_t bounds;
+	int i;
+
+	if (pointc <= 0)
+		return true;
+
+	dlist_bounds_empty(&bounds);
+	for (i = 0; i < pointc; i++) {
+		dlist_bounds_add(&bounds, points[i].x, points[i].y);
+	}
+	dlist_bounds_widen(&bounds, dlist_pen_margin(pen));
+
+	if (!dlist_add(nsfb, NSFB_DLIST_POLYLINES, &bounds,
+		       sizeof(struct dlist_pen) + pointc * sizeof(nsfb_point_t),
+		       &op))
+		return false;
+
+	if (op != NULL) {
+		op->count = pointc;
+		args = dlist_args(&nsfb->dlist, op->data);
+		dlist_pen_record(nsfb, args, pen);
+		memcpy(args + 1, points, pointc * sizeof(nsfb_point_t));
+	}
+
+	return true;
+}
+
+/* exported interface documented in dlist.h */
+bool
+nsfb_dlist_spans(nsfb_t *nsfb,
+		 int spanc,
+		 const nsfb_plot_span_t *spans,
+		 nsfb_colour_t c)
+{
+	struct nsfb_dlist_op_s *op;
+	nsfb_bbox_t bounds;
+	int i;
+
+	if (spanc <= 0)
+		return true;
+
+	dlist_bounds_empty(&bounds);
+	for (i = 0; i < spanc; i++) {
+		dlist_bounds_add(&bounds, spans[i].x0, spans[i].y);
+		dlist_bounds_add(&bounds, spans[i].x1, spans[i].y);
+	}
+	dlist_bounds_widen(&bounds, 0);
+
+	if (!dlist_add(nsfb, NSFB_DLIST_SPANS, &bounds,
+		       spanc * sizeof(nsfb_plot_span_t), &op))
+		return false;
+
+	if (op != NULL) {
+		op->c = c;
+		op->count = spanc;
+		memcpy(dlist_args(&nsfb->dlist, op->data), spans,
+		       spanc * sizeof(nsfb_plot_span_t));
+	}
+
+	return true;
+}
+
+/* exported interface documented in dlist.h */
+bool
+nsfb_dlist_polygon(nsfb_t *nsfb, const int *p, unsigned int n, nsfb_colour_t fill)
+{
+	struct nsfb_dlist_op_s *op;
+	nsfb_bbox_t bounds;
+	unsigned int i;
+
+	if ((n == 0) || (n > INT_MAX / (2 * sizeof(int))))
+		return true;
+
+	dlist_bounds_empty(&bounds);
+	for (i = 0; i < n; i++) {
+		dlist_bounds_add(&bounds, p[i * 2], p[i * 2 + 1]);
+	}
+	dlist_bounds_widen(&bounds, 1);
+
+	if (!dlist_add(nsfb, NSFB_DLIST_POLYGON, &bounds,
+		       n * 2 * sizeof(int), &op))
+		return false;
+
+	if (op != NULL) {
+		op->c = fill;
+		op->count = n;
+		memcpy(dlist_args(&nsfb->dlist, op->data), p, n * 2 * sizeof(int));
+	}
+
+	return true;
+}
+
+/** Record an arc or pie. */
+static bool
+dlist_arc(nsfb_t *nsfb,
+	  enum nsfb_dlist_type_e type,
+	  int x, int y, int radius,
+	  int angle1, int angle2,
+	  nsfb_colour_t c)
+{
+	struct nsfb_dlist_op_s *op;
+	struct dlist_arc *args;
+	nsfb_bbox_t bounds;
+	int r = abs(radius);
+
+	bounds.x0 = bounds.x1 = x;
+	bounds.y0 = bounds.y1 = y;
+	dlist_bounds_widen(&bounds, r + 1);
+
+	if (!dlist_add(nsfb, type, &bounds, sizeof(struct dlist_arc), &op))
+		return false;
+
+	if (op != NULL) {
+		op->c = c;
+		args = dlist_args(&nsfb->dlist, op->data);
+		args->x = x;
+		args->y = y;
+		args->radius = radius;
+		args->angle1 = angle1;
+		args->angle2 = angle2;
+	}
+
+	return true;
+}
+
+/* exported interface documented in dlist.h */
+bool
+nsfb_dlist_arc(nsfb_t *nsfb, int x, int y, int radius,
+	       int angle1, int angle2, nsfb_colour_t c)
+{
+	return dlist_arc(nsfb, NSFB_DLIST_ARC, x, y, radius, angle1, angle2, c);
+}
+
+/* exported interface documented in dlist.h */
+bool
+nsfb_dlist_pie(nsfb_t *nsfb, int x, int y, int radius,
+	       int angle1, int angle2, nsfb_colour_t c)
+{
+	return dlist_arc(nsfb, NSFB_DLIST_PIE, x, y, radius, angle1, angle2, c);
+}
+
+/* exported interface documented in dlist.h */
+bool nsfb_dlist_point(nsfb_t *nsfb, int x, int y, nsfb_colour_t c)
+{
+	struct nsfb_dlist_op_s *op;
+	nsfb_bbox_t bounds;
+
+	/* the bounds are the point */
+	bounds.x0 = bounds.x1 = x;
+	bounds.y0 = bounds.y1 = y;
+	dlist_bounds_widen(&bounds, 0);
+
+	if (!dlist_add(nsfb, NSFB_DLIST_POINT, &bounds, 0, &op))
+		return false;
+
+	if (op != NULL)
+		op->c = c;
+
+	return true;
+}
+
+/** Record an ellipse outline or fill. */
+static bool
+dlist_ellipse(nsfb_t *nsfb,
+	      enum nsfb_dlist_type_e type,
+	      const nsfb_bbox_t *ellipse,
+	      nsfb_colour_t c)
+{
+	struct nsfb_dlist_op_s *op;
+	nsfb_bbox_t bounds;
+
+	dlist_bounds_empty(&bounds);
+	dlist_bounds_add(&bounds, ellipse->x0, ellipse->y0);
+	dlist_bounds_add(&bounds, ellipse->x1, ellipse->y1);
+	dlist_bounds_widen(&bounds, 1);
+
+	if (!dlist_add(nsfb, type, &bounds, sizeof(nsfb_bbox_t), &op))
+		return false;
+
+	if (op != NULL) {
+		op->c = c;
+		*(nsfb_bbox_t *)dlist_args(&nsfb->dlist, op->data) = *ellipse;
+	}
+
+	return true;
+}
+
+/* exported interface documented in dlist.h */
+bool
+nsfb_dlist_ellipse(nsfb_t *nsfb, const nsfb_bbox_t *ellipse, nsfb_colour_t c)
+{
+	return dlist_ellipse(nsfb, NSFB_DLIST_ELLIPSE, ellipse, c);
+}
+
+/* exported interface documented in dlist.h */
+bool
+nsfb_dlist_ellipse_fill(nsfb_t *nsfb, const nsfb_bbox_t *ellipse,
+			nsfb_colour_t c)
+{
+	return dlist_ellipse(nsfb, NSFB_DLIST_ELLIPSE_FILL, ellipse, c);
+}
+
+/** Record a bitmap or tiled bitmap. */
+static bool
+dlist_bitmap(nsfb_t *nsfb,
+	     enum nsfb_dlist_type_e type,
+	     const nsfb_bbox_t *loc,
+	     int tiles_x,
+	     int tiles_y,
+	     const nsfb_colour_t *pixel,
+	     int bmp_width,
+	     int bmp_height,
+	     int bmp_stride,
+	     bool alpha)
+{
+	struct nsfb_dlist_op_s *op;
+	struct dlist_bitmap *args;
+	nsfb_bbox_t bounds;
+
+	if (type == NSFB_DLIST_BITMAP_TILES) {
+		/* tiles can repeat over the whole clip */
+		bounds = nsfb->clip;
+	} else {
+		bounds = *loc;
+	}
+
+	if (!dlist_add(nsfb, type, &bounds, sizeof(struct dlist_bitmap), &op))
+		return false;
+
+	if (op == NULL)
+		return true;
+
+	/* a bitmap without alpha replaces every pixel it covers */
+	op->opaque = ((type == NSFB_DLIST_BITMAP) && !alpha &&
+		      (loc->x0 < loc->x1) && (loc->y0 < loc->y1) &&
+		      (bmp_width > 0) && (bmp_height > 0));
+
+	args = dlist_args(&nsfb->dlist, op->data);
+	args->loc = *loc;
+	args->pixel = pixel;
+	args->width = bmp_width;
+	args->height = bmp_height;
+	args->stride = bmp_stride;
+	args->tiles_x = tiles_x;
+	args->tiles_y = tiles_y;
+	args->alpha = alpha;
+	args->filter = nsfb->bitmap_filter;
+
+	return true;
+}
+
+/* exported interface documented in dlist.h */
+bool
+nsfb_dlist_bitmap(nsfb_t *nsfb,
+		  const nsfb_bbox_t *loc,
+		  const nsfb_colour_t *pixel,
+		  int bmp_width,
+		  int bmp_height,
+		  int bmp_stride,
+		  bool alpha)
+{
+	return dlist_bitmap(nsfb, NSFB_DLIST_BITMAP, loc, 0, 0, pixel,
+			    bmp_width, bmp_height, bmp_stride, alpha);
+}
+
+/* exported interface documented in dlist.h */
+bool
+nsfb_dlist_bitmap_tiles(nsfb_t *nsfb,
+			const nsfb_bbox_t *loc,
+			int tiles_x,
+			int tiles_y,
+			const nsfb_colour_t *pixel,
+			int bmp_width,
+			int bmp_height,
+			int bmp_stride,
+			bool alpha)
+{
+	return dlist_bitmap(nsfb, NSFB_DLIST_BITMAP_TILES, loc,
+			    tiles_x, tiles_y, pixel,
+			    bmp_width, bmp_height, bmp_stride, alpha);
+}
+
+/**
+ * Record a glyph
+ *
+ * The glyph's pixels are copied as callers usually reuse their glyph
+ * buffers.
+ *
+ * \param pitch The number of bytes between rows of the glyph's pixels.
+ * \param row The number of bytes in each row of the glyph's pixels.
+ */
+static bool
+dlist_glyph(nsfb_t *nsfb,
+	    enum nsfb_dlist_type_e type,
+	    const nsfb_bbox_t *loc,
+	    const uint8_t *pixel,
+	    int pitch,
+	    int row,
+	    nsfb_colour_t c)
+{
+	struct nsfb_dlist_op_s *op;
+	struct dlist_glyph *args;
+	nsfb_bbox_t bounds = *loc;
+	uint8_t *dst;
+	int height = loc->y1 - loc->y0;
+	int y;
+
+	if ((row <= 0) || (height <= 0))
+		return true;
+
+	if (!dlist_add(nsfb, type, &bounds,
+		       sizeof(struct dlist_glyph) + (size_t)row * height, &op))
+		return false;
+
+	if (op == NULL)
+		return true;
+
+	op->c = c;
+	args = dlist_args(&nsfb->dlist, op->data);
+	args->loc = *loc;
+	args->pitch = row;
+
+	dst = (uint8_t *)(args + 1);
+	for (y = 0; y < height; y++) {
+		memcpy(dst, pixel, row);
+		dst += row;
+		pixel += pitch;
+	}
+
+	return true;
+}
+
+/* exported interface documented in dlist.h */
+bool
+nsfb_dlist_glyph8(nsfb_t *nsfb,
+		  const nsfb_bbox_t *loc,
+		  const uint8_t *pixel,
+		  int pitch,
+		  nsfb_colour_t c)
+{
+	return dlist_glyph(nsfb, NSFB_DLIST_GLYPH8, loc, pixel, pitch,
+			   loc->x1 - loc->x0, c);
+}
+
+/* exported interface documented in dlist.h */
+bool
+nsfb_dlist_glyph1(nsfb_t *nsfb,
+		  const nsfb_bbox_t *loc,
+		  const uint8_t *pixel,
+		  int pitch,
+		  nsfb_colour_t c)
+{
+	/* the pitch of one bit glyphs is in bits */
+	return dlist_glyph(nsfb, NSFB_DLIST_GLYPH1, loc, pixel, pitch >> 3,
+			   (loc->x1 - loc->x0 + 7) / 8, c);
+}
+
+/** Record a bezier curve, which lies inside its control points. */
+static bool
+dlist_bezier(nsfb_t *nsfb,
+	     enum nsfb_dlist_type_e type,
+	     const nsfb_bbox_t *curve,
+	     const nsfb_point_t *ctrla,
+	     const nsfb_point_t *ctrlb,
+	     const nsfb_plot_pen_t *pen)
+{
+	struct nsfb_dlist_op_s *op;
+	struct dlist_bezier *args;
+	nsfb_bbox_t bounds;
+
+	dlist_bounds_empty(&bounds);
+	dlist_bounds_add(&bounds, curve->x0, curve->y0);
+	dlist_bounds_add(&bounds, curve->x1, curve->y1);
+	dlist_bounds_add(&bounds, ctrla->x, ctrla->y);
+	if (ctrlb != NULL)
+		dlist_bounds_add(&bounds, ctrlb->x, ctrlb->y);
+	dlist_bounds_widen(&bounds, dlist_pen_margin(pen));
+
+	if (!dlist_add(nsfb, type, &bounds, sizeof(struct dlist_bezier), &op))
+		return false;
+
+	if (op != NULL) {
+		args = dlist_args(&nsfb->dlist, op->data);
+		dlist_pen_record(nsfb, &args->pen, pen);
+		args->curve = *curve;
+		args->ctrla = *ctrla;
+		if (ctrlb != NULL)
+			args->ctrlb = *ctrlb;
+	}
+
+	return true;
+}
+
+/* exported interface documented in dlist.h */
+bool
+nsfb_dlist_quadratic(nsfb_t *nsfb,
+		     const nsfb_bbox_t *curve,
+		     const nsfb_point_t *ctrla,
+		     const nsfb_plot_pen_t *pen)
+{
+	return dlist_bezier(nsfb, NSFB_DLIST_QUADRATIC, curve, ctrla, NULL, pen);
+}
+
+/* exported interface documented in dlist.h */
+bool
+nsfb_dlist_cubic(nsfb_t *nsfb,
+		 const nsfb_bbox_t *curve,
+		 const nsfb_point_t *ctrla,
+		 const nsfb_point_t *ctrlb,
+		 const nsfb_plot_pen_t *pen)
+{
+	return dlist_bezier(nsfb, NSFB_DLIST_CUBIC, curve, ctrla, ctrlb, pen);
+}
+
+/* exported interface documented in dlist.h */
+bool
+nsfb_dlist_path(nsfb_t *nsfb,
+		int pathc,
+		const nsfb_plot_pathop_t *pathop,
+		const nsfb_plot_pen_t *pen)
+{
+	struct nsfb_dlist_op_s *op;
+	struct dlist_pen *args;
+	nsfb_bbox_t bounds;
+	int i;
+
+	if (pathc <= 0)
+		return true;
+
+	/* the curves of a path lie inside their control points */
+	dlist_bounds_empty(&bounds);
+	for (i = 0; i < pathc; i++) {
+		dlist_bounds_add(&bounds, pathop[i].point.x, pathop[i].point.y);
+	}
+	dlist_bounds_widen(&bounds, dlist_pen_margin(pen));
+
+	if (!dlist_add(nsfb, NSFB_DLIST_PATH, &bounds,
+		       sizeof(struct dlist_pen) +
+		       pathc * sizeof(nsfb_plot_pathop_t), &op))
+		return false;
+
+	if (op != NULL) {
+		op->count = pathc;
+		args = dlist_args(&nsfb->dlist, op->data);
+		dlist_pen_record(nsfb, args, pen);
+		memcpy(args + 1, pathop, pathc * sizeof(nsfb_plot_pathop_t));
+	}
+
+	return true;
+}
+
+static inline bool
+dlist_contains(const nsfb_bbox_t *outer, const nsfb_bbox_t *inner)
+{
+	return ((outer->x0 <= inner->x0) && (outer->y0 <= inner->y0) &&
+		(outer->x1 >= inner->x1) && (outer->y1 >= inner->y1));
+}
+
+static inline long dlist_area(const nsfb_bbox_t *box)
+{
+	return (long)(box->x1 - box->x0) * (box->y1 - box->y0);
+}
+
+/** Remember an opaque area, keeping the largest when there are many. */
+static void
+dlist_occluder_add(nsfb_bbox_t *occluder, int *occluderc,
+		   const nsfb_bbox_t *area)
+{
+	int smallest = 0;
+	int i;
+
+	for (i = 0; i < *occluderc; i++) {
+		if (dlist_contains(area, &occluder[i])) {
+			occluder[i] = *area;
+			return;
+		}
+		if (dlist_area(&occluder[i]) < dlist_area(&occluder[smallest]))
+			smallest = i;
+	}
+
+	if (*occluderc < DLIST_OCCLUDER_MAX) {
+		occluder[(*occluderc)++] = *area;
+	} else if (dlist_area(area) > dlist_area(&occluder[smallest])) {
+		occluder[smallest] = *area;
+	}
+}
+
+/**
+ * Drop operations which are entirely covered by later opaque ones
+ *
+ * The list is walked backwards remembering the opaque areas still to be
+ * plotted; nothing an operation plots inside one of them can be seen.
+ *
+ * \param dlist The display list.
+ * \param keep_bitmaps Bitmaps must be plotted as they carry dither state.
+ */
+static void dlist_cull(struct nsfb_dlist_s *dlist, bool keep_bitmaps)
+{
+	nsfb_bbox_t occluder[DLIST_OCCLUDER_MAX];
+	int occluderc = 0;
+	struct nsfb_dlist_op_s *op;
+	int i;
+	int o;
+
+	for (i = dlist->opc - 1; i >= 0; i--) {
+		op = &dlist->op[i];
+
+		for (o = 0; o < occluderc; o++) {
+			if (dlist_contains(&occluder[o], &op->bounds))
+				break;
+		}
+
+		if (o < occluderc) {
+			if (!keep_bitmaps || ((op->type != NSFB_DLIST_BITMAP) &&
+					      (op->type != NSFB_DLIST_BITMAP_TILES))) {
+				op->type = NSFB_DLIST_NONE;
+			} else {
+				/* the kept bitmap may blend with anything
+				 * beneath it, so that must be kept too */
+				occluderc = 0;
+			}
+			continue;
+		}
+
+		if (op->opaque)
+			dlist_occluder_add(occluder, &occluderc, &op->bounds);
+	}
+}
+
+/**
+ * Merge fills of one colour that together make a rectangle
+ *
+ * Fills replace the pixels they cover so overlapping or touching fills
+ * can be joined when nothing is plotted between them.
+ */
+static void dlist_merge(struct nsfb_dlist_s *dlist)
+{
+	struct nsfb_dlist_op_s *prev = NULL;
+	struct nsfb_dlist_op_s *op;
+	nsfb_bbox_t *a;
+	nsfb_bbox_t *b;
+	int i;
+
+	for (i = 0; i < dlist->opc; i++) {
+		op = &dlist->op[i];
+		if (op->type == NSFB_DLIST_NONE)
+			continue;
+
+		if ((prev != NULL) &&
+		    (prev->type == NSFB_DLIST_FILL) &&
+		    (op->type == NSFB_DLIST_FILL) &&
+		    (prev->c == op->c) && (prev->clip == op->clip)) {
+			a = &prev->bounds;
+			b = &op->bounds;
+
+			if (((a->y0 == b->y0) && (a->y1 == b->y1) &&
+			     (a->x0 <= b->x1) && (b->x0 <= a->x1)) ||
+			    ((a->x0 == b->x0) && (a->x1 == b->x1) &&
+			     (a->y0 <= b->y1) && (b->y0 <= a->y1))) {
+				nsfb_plot_add_rect(a, b, a);
+				op->type = NSFB_DLIST_NONE;
+				continue;
+			}
+		}
+
+		prev = op;
+	}
+}
+
+/**
+ * Plot one recorded operation
+ *
+ * Plotters which clip a bounding box in place are given a copy so the
+ * operation can be plotted again, once for each tile it touches.
+ */
+static bool dlist_plot(nsfb_t *nsfb, struct nsfb_dlist_op_s *op)
+{
+	const nsfb_plotter_fns_t *fns = nsfb->plotter_fns;
+	void *args = dlist_args(&nsfb->dlist, op->data);
+	nsfb_bbox_t box;
+
+	switch (op->type) {
+	case NSFB_DLIST_NONE:
+		return true;
+
+	case NSFB_DLIST_FILL:
+		box = op->bounds;
+		return fns->fill(nsfb, &box, op->c);
+
+	case NSFB_DLIST_RECTANGLE: {
+		struct dlist_rectangle *rect = args;
+		return fns->rectangle(nsfb, &rect->rect, rect->line_width,
+				      op->c, rect->dotted, rect->dashed);
+	}
+
+	case NSFB_DLIST_LINES: {
+		struct dlist_pen *pen = args;
+		return fns->line(nsfb, op->count, (nsfb_bbox_t *)(pen + 1),
+				 dlist_pen_replay(nsfb, pen));
+	}
+
+	case NSFB_DLIST_POLYLINES: {
+		struct dlist_pen *pen = args;
+		return fns->polylines(nsfb, op->count,
+				      (const nsfb_point_t *)(pen + 1),
+				      dlist_pen_replay(nsfb, pen));
+	}
+
+	case NSFB_DLIST_SPANS:
+		return fns->spans(nsfb, op->count, args, op->c);
+
+	case NSFB_DLIST_POLYGON:
+		return fns->polygon(nsfb, args, op->count, op->c);
+
+	case NSFB_DLIST_ARC:
+	case NSFB_DLIST_PIE: {
+		struct dlist_arc *arc = args;
+		if (op->type == NSFB_DLIST_ARC)
+			return fns->arc(nsfb, arc->x, arc->y, arc->radius,
+					arc->angle1, arc->angle2, op->c);
+		return fns->pie(nsfb, arc->x, arc->y, arc->radius,
+				arc->angle1, arc->angle2, op->c);
+	}
+
+	case NSFB_DLIST_POINT:
+		return fns->point(nsfb, op->bounds.x0, op->bounds.y0, op->c);
+
+	case NSFB_DLIST_ELLIPSE:
+		box = *(nsfb_bbox_t *)args;
+		return fns->ellipse(nsfb, &box, op->c);
+
+	case NSFB_DLIST_ELLIPSE_FILL:
+		box = *(nsfb_bbox_t *)args;
+		return fns->ellipse_fill(nsfb, &box, op->c);
+
+	case NSFB_DLIST_BITMAP:
+	case NSFB_DLIST_BITMAP_TILES: {
+		struct dlist_bitmap *bmp = args;
+		nsfb->bitmap_filter = bmp->filter;
+		if (op->type == NSFB_DLIST_BITMAP)
+			return fns->bitmap(nsfb, &bmp->loc, bmp->pixel,
+					   bmp->width, bmp->height,
+					   bmp->stride, bmp->alpha);
+		return fns->bitmap_tiles(nsfb, &bmp->loc,
+					 bmp->tiles_x, bmp->tiles_y,
+					 bmp->pixel, bmp->width, bmp->height,
+					 bmp->stride, bmp->alpha);
+	}
+
+	case NSFB_DLIST_GLYPH8:
+	case NSFB_DLIST_GLYPH1: {
+		struct dlist_glyph *glyph = args;
+		box = glyph->loc;
+		if (op->type == NSFB_DLIST_GLYPH8)
+			return fns->glyph8(nsfb, &box,
+					   (const uint8_t *)(glyph + 1),
+					   glyph->pitch, op->c);
+		return fns->glyph1(nsfb, &box,
+				   (const uint8_t *)(glyph + 1),
+				   glyph->pitch << 3, op->c);
+	}
+
+	case NSFB_DLIST_QUADRATIC: {
+		struct dlist_bezier *bez = args;
+		return fns->quadratic(nsfb, &bez->curve, &bez->ctrla,
+				      dlist_pen_replay(nsfb, &bez->pen));
+	}
+
+	case NSFB_DLIST_CUBIC: {
+		struct dlist_bezier *bez = args;
+		return fns->cubic(nsfb, &bez->curve, &bez->ctrla, &bez->ctrlb,
+				  dlist_pen_replay(nsfb, &bez->pen));
+	}
+
+	case NSFB_DLIST_PATH: {
+		struct dlist_pen *pen = args;
+		return fns->path(nsfb, op->count,
+				 (nsfb_plot_pathop_t *)(pen + 1),
+				 dlist_pen_replay(nsfb, pen));
+	}
+	}
+
+	return false;
+}
+
+/** Plot a range of recorded operations on the calling thread. */
+static bool dlist_plot_range(nsfb_t *nsfb, int start, int end)
+{
+	struct nsfb_dlist_s *dlist = &nsfb->dlist;
+	bool ret = true;
+	int i;
+
+	for (i = start; i < end; i++) {
+		if (dlist->op[i].type == NSFB_DLIST_NONE)
+			continue;
+
+		nsfb->clip = dlist->clip[dlist->op[i].clip];
+		if (!dlist_plot(nsfb, &dlist->op[i]))
+			ret = false;
+	}
+
+	return ret;
+}
+
+/**
+ * Whether an operation can be plotted a tile at a time
+ *
+ * Clipping a line moves its ends, so the pixels plotted near the clip
+ * edge depend on the clip. Error diffusion carries along each clipped
+ * bitmap row. Everything else plots the same pixels however it is
+ * clipped.
+ */
+static bool dlist_tileable(nsfb_t *nsfb, const struct nsfb_dlist_op_s *op)
+{
+	switch (op->type) {
+	case NSFB_DLIST_RECTANGLE:
+	case NSFB_DLIST_LINES:
+	case NSFB_DLIST_POLYLINES:
+	case NSFB_DLIST_QUADRATIC:
+	case NSFB_DLIST_CUBIC:
+	case NSFB_DLIST_PATH:
+		return false;
+
+	case NSFB_DLIST_BITMAP:
+	case NSFB_DLIST_BITMAP_TILES:
+		return (nsfb->palette == NULL) ||
+		       (nsfb->palette->dither_type == NSFB_PLOT_DITHER_ORDERED);
+
+	default:
+		return true;
+	}
+}
+
+/** Find the columns and rows of tiles an operation touches. */
+static inline void
+dlist_tiles(const struct nsfb_dlist_op_s *op,
+	    int columns,
+	    int rows,
+	    nsfb_bbox_t *tiles)
+{
+	tiles->x0 = op->bounds.x0 / NSFB_TILE_SIZE;
+	tiles->y0 = op->bounds.y0 / NSFB_TILE_SIZE;
+	tiles->x1 = (op->bounds.x1 - 1) / NSFB_TILE_SIZE + 1;
+	tiles->y1 = (op->bounds.y1 - 1) / NSFB_TILE_SIZE + 1;
+	if (tiles->x1 > columns)
+		tiles->x1 = columns;
+	if (tiles->y1 > rows)
+		tiles->y1 = rows;
+}
+
+/**
+ * Sort a range of recorded operations into the tiles they touch
+ *
+ * \param nsfb The context.
+ * \param start The first operation.
+ * \param end The operation after the last.
+ * \param tilec Updated with the number of tiles touched, which are listed
+ *              in the display list's tile array.
+ * \return true on success or false if the storage could not be allocated.
+ */
+static bool dlist_bin(nsfb_t *nsfb, int start, int end, int *tilec)
+{
+	struct nsfb_dlist_s *dlist = &nsfb->dlist;
+	const struct nsfb_dlist_op_s *op;
+	int columns = nsfb_tiles_columns(nsfb);
+	int rows = nsfb_tiles_rows(nsfb);
+	int tilen = columns * rows;
+	nsfb_bbox_t tiles;
+	int x, y, i, t;
+	int refs = 0;
+	int *mem;
+
+	if (dlist->tile_size < tilen) {
+		mem = realloc(dlist->bin, (tilen + 1) * sizeof(int));
+		if (mem == NULL)
+			return false;
+		dlist->bin = mem;
+		mem = realloc(dlist->tile, tilen * sizeof(int));
+		if (mem == NULL)
+			return false;
+		dlist->tile = mem;
+		dlist->tile_size = tilen;
+	}
+	memset(dlist->bin, 0, (tilen + 1) * sizeof(int));
+
+	/* Count the operations touching each tile */
+	for (i = start; i < end; i++) {
+		op = &dlist->op[i];
+		if (op->type == NSFB_DLIST_NONE)
+			continue;
+
+		dlist_tiles(op, columns, rows, &tiles);
+
+		for (y = tiles.y0; y < tiles.y1; y++)
+			for (x = tiles.x0; x < tiles.x1; x++)
+				dlist->bin[y * columns + x]++;
+		refs += (tiles.x1 - tiles.x0) * (tiles.y1 - tiles.y0);
+	}
+
+	if (dlist->ref_size < refs) {
+		mem = realloc(dlist->ref, refs * sizeof(int));
+		if (mem == NULL)
+			return false;
+		dlist->ref = mem;
+		dlist->ref_size = refs;
+	}
+
+	/* List the touched tiles and turn the counts into starts */
+	*tilec = 0;
+	refs = 0;
+	for (t = 0; t < tilen; t++) {
+		if (dlist->bin[t] != 0)
+			dlist->tile[(*tilec)++] = t;
+		i = dlist->bin[t];
+		dlist->bin[t] = refs;
+		refs += i;
+	}
+
+	/* Place the operations, in order, moving each start to its end */
+	for (i = start; i < end; i++) {
+		op = &dlist->op[i];
+		if (op->type == NSFB_DLIST_NONE)
+			continue;
+
+		dlist_tiles(op, columns, rows, &tiles);
+
+		for (y = tiles.y0; y < tiles.y1; y++)
+			for (x = tiles.x0; x < tiles.x1; x++)
+				dlist->ref[dlist->bin[y * columns + x]++] = i;
+	}
+
+	for (t = tilen; t > 0; t--)
+		dlist->bin[t] = dlist->bin[t - 1];
+	dlist->bin[0] = 0;
+
+	return true;
+}
+
+/** Plot the binned operations touching one tile. */
+static bool
+dlist_plot_tile(nsfb_t *nsfb, int tile, const nsfb_bbox_t *area, void *ctx)
+{
+	struct nsfb_dlist_s *dlist = ctx;
+	struct nsfb_dlist_op_s *op;
+	bool ret = true;
+	int i;
+
+	for (i = dlist->bin[tile]; i < dlist->bin[tile + 1]; i++) {
+		op = &dlist->op[dlist->ref[i]];
+
+		nsfb->clip = dlist->clip[op->clip];
+		nsfb_plot_clip(area, &nsfb->clip);
+		if (!dlist_plot(nsfb, op))
+			ret = false;
+	}
+
+	return ret;
+}
+
+/**
+ * Plot recorded operations with the context's worker threads
+ *
+ * Each run of operations which can be plotted a tile at a time is binned
+ * and its tiles plotted in parallel, each tile's operations in order.
+ * The operations between runs are plotted on the calling thread once the
+ * run before them is complete.
+ */
+static bool dlist_plot_tiles(nsfb_t *nsfb)
+{
+	struct nsfb_dlist_s *dlist = &nsfb->dlist;
+	bool ret = true;
+	int start = 0;
+	int end;
+	int tilec;
+
+	while (start < dlist->opc) {
+		end = start;
+		while ((end < dlist->opc) &&
+		       dlist_tileable(nsfb, &dlist->op[end]))
+			end++;
+
+		if (end == start) {
+			/* Plot the operation which can't be split up */
+			end = start + 1;
+			if (!dlist_plot_range(nsfb, start, end))
+				ret = false;
+		} else if (!dlist_bin(nsfb, start, end, &tilec)) {
+			if (!dlist_plot_range(nsfb, start, end))
+				ret = false;
+		} else if (!nsfb_tiles_run(nsfb, dlist->tile, tilec,
+					   dlist_plot_tile, dlist)) {
+			ret = false;
+		}
+
+		start = end;
+	}
+
+	return ret;
+}
+
+/* exported interface documented in dlist.h */
+bool nsfb_dlist_execute(nsfb_t *nsfb)
+{
+	struct nsfb_dlist_s *dlist = &nsfb->dlist;
+	nsfb_bbox_t clip = nsfb->clip;
+	nsfb_plot_filter_t filter = nsfb->bitmap_filter;
+	nsfb_plot_cap_t cap = nsfb->stroke_cap;
+	nsfb_plot_join_t join = nsfb->stroke_join;
+	bool ret;
+
+	if (dlist->opc == 0)
+		return true;
+
+	dlist_cull(dlist, nsfb->palette != NULL);
+	dlist_merge(dlist);
+
+	if (nsfb->tiles != NULL)
+		ret = dlist_plot_tiles(nsfb);
+	else
+		ret = dlist_plot_range(nsfb, 0, dlist->opc);
+
+	nsfb->clip = clip;
+	nsfb->bitmap_filter = filter;
+	nsfb->stroke_cap = cap;
+	nsfb->stroke_join = join;
+
+	dlist->opc = 0;
+	dlist->clipc = 0;
+	dlist->data_used = 0;
+
+	return ret;
+}
+
+/* exported interface documented in dlist.h */
+void nsfb_dlist_fini(struct nsfb_dlist_s *dlist)
+{
+	free(dlist->op);
+	free(dlist->clip);
+	free(dlist->data);
+	free(dlist->bin);
+	free(dlist->ref);
+	free(dlist->tile);
+
+	dlist->op = NULL;
+	dlist->opc = dlist->op_size = 0;
+	dlist->clip = NULL;
+	dlist->clipc = dlist->clip_size = 0;
+	dlist->data = NULL;
+	dlist->data_used = dlist->data_size = 0;
+	dlist->bin = dlist->ref = dlist->tile = NULL;
+	dlist->ref_size = dlist->tile_size = 0;
+	dlist->recording = false;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset:8
+ * End:
+ */
@@ -0,0 +1,241 @@
+/*
+ * Copyright 2026 libnsfb contributors
+ *
+ * This file is part of libnsfb, http://www.netsurf-browser.org/
+ * Licenced under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/** \file
+ * Accelerated rectangle fill kernels (implementation).
+ *
+ * The kernels fill rows of video memory with a repeating 32bit pattern using
+ * the widest vector stores the processor offers. Each row is started and
+ * finished with unaligned stores, which overlap the aligned body, so no
+ * per-pixel head or tail loop is needed. Fills larger than the last level
+ * cache use non-temporal stores so they do not evict everything else.
+ *
+ * The routine to use is selected at runtime by nsfb_fill_rows_select().
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define NSFB_FILL_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#define NSFB_FILL_NEON 1
+#include <arm_neon.h>
+#endif
+
+#include "libnsfb.h"
+#include "libnsfb_plot.h"
+
+#include "nsfb.h"
+#include "plot.h"
+
+/** fill size used when the cache size cannot be determined */
+#define FILL_STREAM_DEFAULT (8 * 1024 * 1024)
+
+/** fills of at least this many bytes are written with streaming stores */
+static long fill_stream_threshold = FILL_STREAM_DEFAULT;
+
+/**
+ * Fill the start of a row which is too narrow for a vector store.
+ */
+static inline void
+fill_row_short(uint8_t *ptr, int width, uint32_t ent)
+{
+	if (((uintptr_t)ptr & 2) && (width >= 2)) {
+		*(uint16_t *)(void *)ptr = ent;
+		ptr += 2;
+		width -= 2;
+	}
+	while (width >= 4) {
+		*(uint32_t *)(void *)ptr = ent;
+		ptr += 4;
+		width -= 4;
+	}
+	if (width >= 2) {
+		*(uint16_t *)(void *)ptr = ent;
+	}
+}
+
+#ifdef NSFB_FILL_X86
+
+static void
+fill_rows_sse2(uint8_t *ptr, int linelen, int width, int height, uint32_t ent)
+{
+	const __m128i v = _mm_set1_epi32(ent);
+	const bool stream = ((long)width * height) >= fill_stream_threshold;
+	uint8_t *p;
+	uint8_t *end;
+
+	if (width < 16) {
+		for (; height > 0; height--, ptr += linelen)
+			fill_row_short(ptr, width, ent);
+		return;
+	}
+
+	for (; height > 0; height--, ptr += linelen) {
+		end = ptr + width;
+
+		/* unaligned head and tail */
+		_mm_storeu_si128((void *)ptr, v);
+		_mm_storeu_si128((void *)(end - 16), v);
+
+		p = (uint8_t *)(((uintptr_t)ptr + 16) & ~(uintptr_t)15);
+		if (stream) {
+			for (; p + 64 <= end; p += 64) {
+				_mm_stream_si128((void *)p, v);
+				_mm_stream_si128((void *)(p + 16), v);
+				_mm_stream_si128((void *)(p + 32), v);
+				_mm_stream_si128((void *)(p + 48), v);
+			}
+			for (; p + 16 <= end; p += 16)
+				_mm_stream_si128((void *)p, v);
+		} else {
+			for (; p + 64 <= end; p += 64) {
+				_mm_store_si128((void *)p, v);
+				_mm_store_si128((void *)(p + 16), v);
+				_mm_store_si128((void *)(p + 32), v);
+				_mm_store_si128((void *)(p + 48), v);
+			}
+			for (; p + 16 <= end; p += 16)
+				_mm_store_si128((void *)p, v);
+		}
+	}
+
+	if (stream)
+		_mm_sfence();
+}
+
+__attribute__((target("avx2")))
+static void
+fill_rows_avx2(uint8_t *ptr, int linelen, int width, int height, uint32_t ent)
+{
+	const __m256i v = _mm256_set1_epi32(ent);
+	const bool stream = ((long)width * height) >= fill_stream_threshold;
+	uint8_t *p;
+	uint8_t *end;
+
+	if (width < 32) {
+		fill_rows_sse2(ptr, linelen, width, height, ent);
+		return;
+	}
+
+	for (; height > 0; height--, ptr += linelen) {
+		end = ptr + width;
+
+		/* unaligned head and tail */
+		_mm256_storeu_si256((void *)ptr, v);
+		_mm256_storeu_si256((void *)(end - 32), v);
+
+		p = (uint8_t *)(((uintptr_t)ptr + 32) & ~(uintptr_t)31);
+		if (stream) {
+			for (; p + 128 <= end; p += 128) {
+				_mm256_stream_si256((void *)p, v);
+				_mm256_stream_si256((void *)(p + 32), v);
+				_mm256_stream_si256((void *)(p + 64), v);
+				_mm256_stream_si256((void *)(p + 96), v);
+			}
+			for (; p + 32 <= end; p += 32)
+				_mm256_stream_si256((void *)p, v);
+		} else {
+			for (; p + 128 <= end; p += 128) {
+				_mm256_store_si256((void *)p, v);
+				_mm256_store_si256((void *)(p + 32), v);
+				_mm256_store_si256((void *)(p + 64), v);
+				_mm256_store_si256((void *)(p + 96), v);
+			}
+			for (; p + 32 <= end; p += 32)
+				_mm256_store_si256((void *)p, v);
+		}
+	}
+
+	if (stream)
+		_mm_sfence();
+	_mm256_zeroupper();
+}
+
+#endif /* NSFB_FILL_X86 */
+
+#ifdef NSFB_FILL_NEON
+
+/* NEON has no non-temporal store intrinsic so this kernel always uses
+ * ordinary stores.
+ */
+static void
+fill_rows_neon(uint8_t *ptr, int linelen, int width, int height, uint32_t ent)
+{
+	const uint32x4_t v = vdupq_n_u32(ent);
+	uint8_t *p;
+	uint8_t *end;
+
+	if (width < 16) {
+		for (; height > 0; height--, ptr += linelen)
+			fill_row_short(ptr, width, ent);
+		return;
+	}
+
+	for (; height > 0; height--, ptr += linelen) {
+		end = ptr + width;
+
+		/* unaligned head and tail */
+		vst1q_u32((void *)ptr, v);
+		vst1q_u32((void *)(end - 16), v);
+
+		p = (uint8_t *)(((uintptr_t)ptr + 16) & ~(uintptr_t)15);
+		for (; p + 64 <= end; p += 64) {
+			vst1q_u32((void *)p, v);
+			vst1q_u32((void *)(p + 16), v);
+			vst1q_u32((void *)(p + 32), v);
+			vst1q_u32((void *)(p + 48), v);
+		}
+		for (; p + 16 <= end; p += 16)
+			vst1q_u32((void *)p, v);
+	}
+}
+
+#endif /* NSFB_FILL_NEON */
+
+/* exported interface documented in plot.h */
+nsfb_fill_rows_t *nsfb_fill_rows_select(void)
+{
+	unsigned int features = nsfb_cpu_features();
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+	long llc;
+
+	llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+	if (llc <= 0)
+		llc = sysconf(_SC_LEVEL2_CACHE_SIZE);
+	if (llc > 0)
+		fill_stream_threshold = llc;
+#endif
+
+#ifdef NSFB_FILL_X86
+	if (features & NSFB_CPU_AVX2)
+		return fill_rows_avx2;
+	if (features & NSFB_CPU_SSE2)
+		return fill_rows_sse2;
+#endif
+
+#ifdef NSFB_FILL_NEON
+	if (features & NSFB_CPU_NEON)
+		return fill_rows_neon;
+#endif
+
+	/* no accelerated routine, use the plotters scalar loops */
+	return NULL;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset:8
+ * End:
+ */
@@ -31,6 +31,9 @@ extern const nsfb_plotter_fns_t _nsfb_24bpp_plotters;
 extern const nsfb_plotter_fns_t _nsfb_32bpp_xrgb8888_plotters;
 extern const nsfb_plotter_fns_t _nsfb_32bpp_xbgr8888_plotters;
 
+/** Number of spans the rasterisers collect before plotting them */
+#define SPAN_BATCH 64
+
 static bool set_clip(nsfb_t *nsfb, nsfb_bbox_t *clip)
 {
 	nsfb_bbox_t fbarea;
@@ -64,16 +67,41 @@ static bool clg(nsfb_t *nsfb, nsfb_colour_t c)
 }
 
 /**
- * Establish whether there is any value in a line's crossing.
- * (Helper function for find_span().)
+ * Plot spans as single row fills
+ *
+ * Used by plotters which have no native span loop.
+ */
+static bool
+fill_spans(nsfb_t *nsfb, int spanc, const nsfb_plot_span_t *spans,
+	   nsfb_colour_t c)
+{
+	nsfb_bbox_t fline;
+
+	for (; spanc > 0; spanc--, spans++) {
+		fline.x0 = spans->x0;
+		fline.y0 = spans->y;
+		fline.x1 = spans->x1;
+		fline.y1 = spans->y + 1;
+		nsfb->plotter_fns->fill(nsfb, &fline, c);
+	}
+	return true;
+}
+
+/**
+ * A polygon edge in the edge table
  *
- * \param  x	 x coordinate of intersection
- * \param  y	 current y level
- * \param  x0	 line start coordinate
- * \param  y0	 line start coordinate
- * \param  x1	 line end coordinate
- * \param  y1	 line end coordinate
- * \return true	 if crossing has value
+ * The crossing of an edge with a scan line is its first vertex plus the
+ * horizontal offset rounded to nearest, half away from zero:
+ *
+ *   x = x0 + sign(dx) * ((|y - y0| * |dx| + |dy| / 2) / |dy|)
+ *
+ * The quotient and remainder of that division are stepped from one scan
+ * line to the next so no division is needed once an edge is active.
+ * Rounding is always from the first vertex, as the order of the vertices
+ * decides which way exact halves round.
+ *
+ * Edges are active from their top vertex down to, but not including, their
+ * bottom vertex:
  *
  *                         +            |                             | /
  *                        /             |                             |/
@@ -83,179 +111,84 @@ static bool clg(nsfb_t *nsfb, nsfb_colour_t c)
  *
  *                      (a)            (b)            (c)            (d)
  *
+ * Figure (a) crossings:  1     = 1  --  Odd  -- Valid crossing
+ * Figure (b) crossings:  0 + 1 = 1  --  Odd  -- Valid crossing
+ * Figure (c) crossings:  1 + 1 = 2  --  Even -- Not valid crossing
+ * Figure (d) crossings:  0 + 0 = 0  --  Even -- Not valid crossing
  *
- * Figure (a) values:  1     = 1  --  Odd  -- Valid crossing
- * Figure (b) values:  0 + 1 = 1  --  Odd  -- Valid crossing
- * Figure (c) values:  1 + 1 = 2  --  Even -- Not valid crossing
- * Figure (d) values:  0 + 0 = 0  --  Even -- Not valid crossing
- *
- * Vertices are shared between consecutive lines.  This function ensures that
- * the vertex point is only counted as a crossing for one of the lines by
- * only considering crossings of the top vertex.  This is what NetSurf's
- * plotter API expects.
- *
- * It's up to the client to call this function for both lines and check the
- * evenness of the total.
+ * Vertices are shared between consecutive lines, so only counting the top
+ * vertex ensures each vertex is crossed once, which is what NetSurf's
+ * plotter API expects. Horizontal edges are never active.
  */
-static bool establish_crossing_value(int x, int y, int x0, int y0,
-		int x1, int y1)
+struct poly_edge {
+	int ymin; /**< first scan line the edge is active on */
+	int ymax; /**< scan line after the last the edge is active on */
+	int x0; /**< x of the first vertex */
+	int y0; /**< y of the first vertex */
+	int sx; /**< sign of the horizontal delta */
+	int adx; /**< magnitude of the horizontal delta */
+	int ady; /**< magnitude of the vertical delta */
+	bool down; /**< the first vertex is the top one */
+	int q; /**< rounded offset from x0 on the current scan line */
+	int r; /**< remainder of the offset division */
+	int x; /**< crossing on the current scan line */
+};
+
+/**
+ * Set up an edge's crossing for a scan line
+ */
+static inline void poly_edge_start(struct poly_edge *e, int y)
 {
-	bool v1 = (x == x0 && y == y0); /* whether we're crossing 1st vertex */
-	bool v2 = (x == x1 && y == y1); /* whether we're crossing 2nd vertex */
+	int n = (y > e->y0) ? (y - e->y0) : (e->y0 - y);
 
-	if ((v1 && (y0 < y1)) || (v2 && (y1 < y0))) {
-		/* crossing top vertex */
-		return true;
-	} else if (!v1 && !v2) {
-		/* Intersection with current y level is not at a vertex.
-		 * Normal crossing. */
-		return true;
-	}
-	return false;
+	n = n * e->adx + e->ady / 2;
+	e->q = n / e->ady;
+	e->r = n % e->ady;
+	e->x = e->x0 + e->sx * e->q;
 }
 
-
 /**
- * Find first filled span along horizontal line at given coordinate
- *
- * \param  p	 array of polygon vertices (x1, y1, x2, y2, ... , xN, yN)
- * \param  n	 number of polygon vertex values (N * 2)
- * \param  x	 current position along current scan line
- * \param  y	 position of current scan line
- * \param  x0	 updated to start of filled area
- * \param  x1	 updated to end of filled area
- * \return true	 if an intersection was found
+ * Move an edge's crossing on to the next scan line
  */
-static bool find_span(const int *p, int n, int x, int y, int *x0, int *x1)
+static inline void poly_edge_step(struct poly_edge *e)
 {
-	enum {
-		NO_MIN = INT_MIN + 1,
-		NO_MAX = INT_MAX - 1,
-	};
-	int i;
-	int p_x0, p_y0;
-	int p_x1, p_y1;
-	int x0_min, x1_min;
-	int x_new;
-	unsigned int x0c, x1c; /* counters for crossings at span end points */
-	bool crossing_value;
-	bool found_span_start = false;
-
-	x0_min = x1_min = NO_MIN;
-	x0c = x1c = 0;
-
-	/* search row for next span, returning it if one exists */
-	do {
-		/* reset endpoint info, if valid span endpoints not found */
-		if (!found_span_start) {
-			*x0 = NO_MAX;
-		}
-		*x1 = NO_MAX;
-
-		/* search all lines in polygon */
-		for (i = 0; i < n; i = i + 2) {
-			/* get line endpoints */
-			if (i != n - 2) {
-				/* not the last line */
-				p_x0 = p[i];		p_y0 = p[i + 1];
-				p_x1 = p[i + 2];	p_y1 = p[i + 3];
-			} else {
-				/* last line; 2nd endpoint is first vertex */
-				p_x0 = p[i];		p_y0 = p[i + 1];
-				p_x1 = p[0];		p_y1 = p[1];
-			}
-			/* ignore horizontal lines */
-			if (p_y0 == p_y1)
-				continue;
-
-			/* ignore lines that don't cross this y level */
-			if ((y < p_y0 && y < p_y1) || (y > p_y0 && y > p_y1))
-				continue;
-
-			if (p_x0 == p_x1) {
-				/* vertical line, x is constant */
-				x_new = p_x0;
-			} else {
-				/* find crossing (intersection of this line and
-				 * current y level) */
-				int num = (y - p_y0) * (p_x1 - p_x0);
-				int den = (p_y1 - p_y0);
-
-				/* To round to nearest (rather than down)
-				 * half the denominator is either added to
-				 * or subtracted from the numerator,
-				 * depending on whether the numerator and
-				 * denominator have the same sign. */
-				num = ((num < 0) == (den < 0)) ?
-						num + (den / 2) :
-						num - (den / 2);
-				x_new = p_x0 + num / den;
-			}
-
-			/* ignore crossings before current x */
-			if (x_new < x ||
-					(!found_span_start && x_new < x0_min) ||
-					(found_span_start && x_new < x1_min))
-				continue;
-
-			crossing_value = establish_crossing_value(x_new, y,
-					p_x0, p_y0, p_x1, p_y1);
-
-			/* set nearest intersections as filled area endpoints */
-			if (!found_span_start &&
-				x_new < *x0 && crossing_value) {
-				/* nearer than first endpoint */
-				*x1 = *x0;
-				x1c = x0c;
-				*x0 = x_new;
-				x0c = 1;
-			} else if (!found_span_start &&
-					x_new == *x0 && crossing_value) {
-				/* same as first endpoint */
-				x0c++;
-			} else if (x_new < *x1 && crossing_value) {
-				/* nearer than second endpoint */
-				*x1 = x_new;
-				x1c = 1;
-			} else if (x_new == *x1 && crossing_value) {
-				/* same as second endpoint */
-				x1c++;
-			}
+	if (e->down) {
+		/* moving away from the first vertex */
+		e->q += e->adx / e->ady;
+		e->r += e->adx % e->ady;
+		if (e->r >= e->ady) {
+			e->r -= e->ady;
+			e->q++;
 		}
-		/* check whether the span endpoints have been found */
-		if (!found_span_start && x0c % 2 == 1) {
-			/* valid fill start found */
-			found_span_start = true;
-
-		}
-		if (x1c % 2 == 1) {
-			/* valid fill endpoint found */
-			if (!found_span_start) {
-				/* not got a start yet; use this as start */
-				found_span_start = true;
-				x0c = x1c;
-				*x0 = *x1;
-			} else {
-				/* got valid end of span */
-				return true;
-			}
+	} else {
+		/* moving towards the first vertex */
+		e->q -= e->adx / e->ady;
+		e->r -= e->adx % e->ady;
+		if (e->r < 0) {
+			e->r += e->ady;
+			e->q--;
 		}
-		/* if current positions aren't valid endpoints, set new
-		 * minimums after current positions */
-		if (!found_span_start)
-			x0_min = *x0 + 1;
-		x1_min = *x1 + 1;
+	}
+	e->x = e->x0 + e->sx * e->q;
+}
 
-	} while (*x1 != NO_MAX);
+static int poly_edge_cmp(const void *a, const void *b)
+{
+	const struct poly_edge *ea = a;
+	const struct poly_edge *eb = b;
 
-	/* no spans found */
-	return false;
+	return ea->ymin - eb->ymin;
 }
 
 
 /**
  * Plot a polygon
  *
+ * The edges are sorted into a table by their top. Each scan line the edges
+ * starting on it join an active list which is kept in crossing order,
+ * positions crossed an odd number of times are paired into spans and the
+ * spans filled.
+ *
  * \param  nsfb	 framebuffer context
  * \param  p	 array of polygon vertices (x1, y1, x2, y2, ... , xN, yN)
  * \param  n	 number of polygon vertices (N)
@@ -270,8 +203,17 @@ static bool polygon(nsfb_t *nsfb, const int *p, unsigned int n, nsfb_colour_t c)
 	int x0, x1; /* filled span extents */
 	int y; /* current y coordinate */
 	int y_max; /* bottom of plot area */
-	nsfb_bbox_t fline;
-	nsfb_plot_pen_t pen;
+	struct poly_edge *edges; /* edge table sorted by top */
+	struct poly_edge **active; /* active edges sorted by crossing */
+	struct poly_edge *e;
+	int edgec; /* number of edges in the table */
+	int next; /* next edge in the table to become active */
+	int activec; /* number of active edges */
+	int count; /* crossings at the same position */
+	bool have_x0;
+	nsfb_plot_span_t batch[SPAN_BATCH]; /* spans waiting to be filled */
+	int batchc = 0;
+	size_t mark; /* scratch arena position before the edge table */
 
 	/* find no. of vertex values */
 	int v = n * 2;
@@ -280,8 +222,6 @@ static bool polygon(nsfb_t *nsfb, const int *p, unsigned int n, nsfb_colour_t c)
 	if (n <= 2)
 		return true;
 
-	pen.stroke_colour = c;
-
 	/* Find polygon bounding box */
 	poly_x0 = poly_x1 = *p;
 	poly_y0 = poly_y1 = p[1];
@@ -316,10 +256,93 @@ static bool polygon(nsfb_t *nsfb, const int *p, unsigned int n, nsfb_colour_t c)
 	else
 		y_max = nsfb->clip.y1;
 
+	if (y >= y_max)
+		return true;
+
+	/* one allocation holds the active list followed by the table */
+	mark = nsfb_scratch_mark(nsfb);
+	active = nsfb_scratch_alloc(nsfb, n * (sizeof(struct poly_edge *) +
+					       sizeof(struct poly_edge)));
+	if (active == NULL)
+		return false;
+	edges = (struct poly_edge *)(void *)(active + n);
+
+	/* build the edge table, the last edge closes the polygon */
+	edgec = 0;
+	for (i = 0; i < v; i = i + 2) {
+		j = (i + 2) % v;
+
+		/* ignore horizontal lines and those above the area */
+		if ((p[i + 1] == p[j + 1]) ||
+				((p[i + 1] <= y) && (p[j + 1] <= y)))
+			continue;
+
+		e = &edges[edgec++];
+		e->x0 = p[i];
+		e->y0 = p[i + 1];
+		e->sx = (p[j] < p[i]) ? -1 : 1;
+		e->adx = (p[j] < p[i]) ? (p[i] - p[j]) : (p[j] - p[i]);
+		e->down = (p[i + 1] < p[j + 1]);
+		if (e->down) {
+			e->ymin = p[i + 1];
+			e->ymax = p[j + 1];
+		} else {
+			e->ymin = p[j + 1];
+			e->ymax = p[i + 1];
+		}
+		e->ady = e->ymax - e->ymin;
+	}
+	qsort(edges, edgec, sizeof(struct poly_edge), poly_edge_cmp);
+
+	next = 0;
+	activec = 0;
 	for (; y < y_max; y++) {
-		x1 = poly_x0 - 1;
-		/* For each row */
-		while (find_span(p, v, x1 + 1, y, &x0, &x1)) {
+		/* step the active edges, dropping those which have ended */
+		for (i = 0, j = 0; i < activec; i++) {
+			e = active[i];
+			if (e->ymax <= y)
+				continue;
+			if (e->ymin < y)
+				poly_edge_step(e);
+			active[j++] = e;
+		}
+		activec = j;
+
+		/* add the edges which start here, or above a clipped top */
+		for (; (next < edgec) && (edges[next].ymin <= y); next++) {
+			e = &edges[next];
+			poly_edge_start(e, y);
+			active[activec++] = e;
+		}
+
+		/* restore crossing order, the list is almost always sorted
+		 * already so an insertion sort is cheap */
+		for (i = 1; i < activec; i++) {
+			e = active[i];
+			for (j = i; (j > 0) && (active[j - 1]->x > e->x); j--)
+				active[j] = active[j - 1];
+			active[j] = e;
+		}
+
+		/* spans lie between positions crossed an odd number of
+		 * times */
+		have_x0 = false;
+		x0 = 0;
+		for (i = 0; i < activec; i += count) {
+			for (count = 1; (i + count < activec) &&
+				     (active[i + count]->x == active[i]->x);
+			     count++);
+			if ((count & 1) == 0)
+				continue;
+
+			if (!have_x0) {
+				x0 = active[i]->x;
+				have_x0 = true;
+				continue;
+			}
+			x1 = active[i]->x;
+			have_x0 = false;
+
 			/* don't draw anything outside clip region */
 			if (x1 < nsfb->clip.x0)
 				continue;
@@ -330,13 +353,17 @@ static bool polygon(nsfb_t *nsfb, const int *p, unsigned int n, nsfb_colour_t c)
 			else if (x1 > nsfb->clip.x1)
 				x1 = nsfb->clip.x1;
 
-			fline.x0 = x0;
-			fline.y0 = y;
-			fline.x1 = x1;
-			fline.y1 = y;
-
-			/* draw this filled span on current row */
-			nsfb->plotter_fns->line(nsfb, 1, &fline, &pen);
+			/* queue this span on the current row, the crossing at
+			 * its end is not included */
+			if (batchc == SPAN_BATCH) {
+				nsfb->plotter_fns->spans(nsfb, batchc, batch,
+							 c);
+				batchc = 0;
+			}
+			batch[batchc].y = y;
+			batch[batchc].x0 = x0;
+			batch[batchc].x1 = x1;
+			batchc++;
 
 			/* don't look for more spans if already at end of clip
 			 * region or polygon */
@@ -344,6 +371,12 @@ static bool polygon(nsfb_t *nsfb, const int *p, unsigned int n, nsfb_colour_t c)
 				break;
 		}
 	}
+
+	if (batchc > 0)
+		nsfb->plotter_fns->spans(nsfb, batchc, batch, c);
+
+	nsfb_scratch_release(nsfb, mark);
+
 	return true;
 }
 
@@ -355,64 +388,66 @@ rectangle(nsfb_t *nsfb, nsfb_bbox_t *rect,
 	nsfb_bbox_t side[4];
 	nsfb_plot_pen_t pen;
 
+	if (line_width > 1) {
+		return nsfb_stroke_rectangle(nsfb, rect, line_width, c,
+			dotted ? NSFB_PLOT_PATTERN_DOTTED :
+			dashed ? NSFB_PLOT_PATTERN_DASHED : 0xFFFFFFFF);
+	}
+
 	pen.stroke_colour = c;
 	pen.stroke_width = line_width;
-	if (dotted || dashed) {
+	if (dotted) {
+		pen.stroke_type = NFSB_PLOT_OPTYPE_PATTERN;
+		pen.stroke_pattern = NSFB_PLOT_PATTERN_DOTTED;
+	} else if (dashed) {
 		pen.stroke_type = NFSB_PLOT_OPTYPE_PATTERN;
+		pen.stroke_pattern = NSFB_PLOT_PATTERN_DASHED;
 	} else {
 		pen.stroke_type = NFSB_PLOT_OPTYPE_SOLID;
 	}
 
-	side[0] = *rect;
-	side[1] = *rect;
-	side[2] = *rect;
-	side[3] = *rect;
-
-	side[0].y1 = side[0].y0;
-	side[1].y0 = side[1].y1;
-	side[2].x1 = side[2].x0;
-	side[3].x0 = side[3].x1;
+	/* the sides run around the rectangle so a pattern continues
+	 * unbroken from one side into the next */
+	side[0].x0 = side[3].x1 = side[2].x1 = side[3].x0 = rect->x0;
+	side[0].x1 = side[1].x0 = side[1].x1 = side[2].x0 = rect->x1;
+	side[0].y0 = side[0].y1 = side[1].y0 = side[3].y1 = rect->y0;
+	side[1].y1 = side[2].y0 = side[2].y1 = side[3].y0 = rect->y1;
+
+	if (pen.stroke_type == NFSB_PLOT_OPTYPE_SOLID) {
+		/* the line clipper keeps different pixels of an upward
+		 * line so solid outlines draw their left side downwards */
+		side[3].y0 = rect->y0;
+		side[3].y1 = rect->y1;
+	}
 
 	return nsfb->plotter_fns->line(nsfb, 4, side, &pen);
 }
 
-/* plotter routine for ellipse points */
-static void
-ellipsepoints(nsfb_t *nsfb, int cx, int cy, int x, int y, nsfb_colour_t c)
+/** Widen the outline run of a row to include a point. */
+static inline void
+ellipse_row_add(int *lo, int *hi, int x, int y)
 {
-	nsfb->plotter_fns->point(nsfb, cx + x, cy + y, c);
-	nsfb->plotter_fns->point(nsfb, cx - x, cy + y, c);
-	nsfb->plotter_fns->point(nsfb, cx + x, cy - y, c);
-	nsfb->plotter_fns->point(nsfb, cx - x, cy - y, c);
-}
-
-static void
-ellipsefill(nsfb_t *nsfb, int cx, int cy, int x, int y, nsfb_colour_t c)
-{
-	nsfb_bbox_t fline[2];
-	nsfb_plot_pen_t pen;
-
-	pen.stroke_colour = c;
-
-	fline[0].x0 = fline[1].x0 = cx - x;
-	fline[0].x1 = fline[1].x1 = cx + x;
-	fline[0].y0 = fline[0].y1 = cy + y;
-	fline[1].y0 = fline[1].y1 = cy - y;
-
-	nsfb->plotter_fns->line(nsfb, 2, fline, &pen);
-
+	if (x < lo[y])
+		lo[y] = x;
+	if (x > hi[y])
+		hi[y] = x;
 }
 
 #define ROUND(a) ((int)(a+0.5))
 
-static bool
-ellipse_midpoint(nsfb_t *nsfb,
-		 int cx,
-		 int cy,
-		 int rx,
-		 int ry,
-		 nsfb_colour_t c,
-		 void (ellipsefn)(nsfb_t *nsfb, int cx, int cy, int x, int y, nsfb_colour_t c))
+/**
+ * Walk a quadrant of an ellipse with the midpoint algorithm
+ *
+ * The points of each row of the quadrant form a single run, which is
+ * recorded for the row instead of being plotted.
+ *
+ * \param rx The horizontal radius.
+ * \param ry The vertical radius.
+ * \param lo Updated with the smallest x on each row from 0 to \a ry.
+ * \param hi Updated with the largest x on each row from 0 to \a ry.
+ */
+static void
+ellipse_midpoint(int rx, int ry, int *lo, int *hi)
 {
 	int rx2 = rx * rx;
 	int ry2 = ry * ry;
@@ -424,7 +459,7 @@ ellipse_midpoint(nsfb_t *nsfb,
 	int px = 0;
 	int py = tworx2 * y;
 
-	ellipsefn(nsfb, cx, cy, x, y, c);
+	ellipse_row_add(lo, hi, x, y);
 
 	/* region 1 */
 	p = ROUND(ry2 - (rx2 * ry) + (0.25 * rx2));
@@ -438,7 +473,7 @@ ellipse_midpoint(nsfb_t *nsfb,
 			py -= tworx2;
 			p+=ry2 + px - py;
 		}
-		ellipsefn(nsfb, cx, cy, x, y, c);
+		ellipse_row_add(lo, hi, x, y);
 	}
 
 	/* region 2 */
@@ -453,59 +488,25 @@ ellipse_midpoint(nsfb_t *nsfb,
 			px += twory2;
 			p+=rx2 - py + px;
 		}
-		ellipsefn(nsfb, cx, cy, x, y, c);
+		ellipse_row_add(lo, hi, x, y);
 	}
-	return true;
-}
-
-
-/* plotter routine for 8way circle symetry */
-static void
-circlepoints(nsfb_t *nsfb, int cx, int cy, int x, int y, nsfb_colour_t c)
-{
-	nsfb->plotter_fns->point(nsfb, cx + x, cy + y, c);
-	nsfb->plotter_fns->point(nsfb, cx - x, cy + y, c);
-	nsfb->plotter_fns->point(nsfb, cx + x, cy - y, c);
-	nsfb->plotter_fns->point(nsfb, cx - x, cy - y, c);
-	nsfb->plotter_fns->point(nsfb, cx + y, cy + x, c);
-	nsfb->plotter_fns->point(nsfb, cx - y, cy + x, c);
-	nsfb->plotter_fns->point(nsfb, cx + y, cy - x, c);
-	nsfb->plotter_fns->point(nsfb, cx - y, cy - x, c);
 }
 
+/**
+ * Walk an octant of a circle with the midpoint algorithm
+ *
+ * Each point is recorded in the runs of its row and, reflected in the
+ * diagonal, of the row it becomes, which gives the quadrant.
+ */
 static void
-circlefill(nsfb_t *nsfb, int cx, int cy, int x, int y, nsfb_colour_t c)
-{
-	nsfb_bbox_t fline[4];
-	nsfb_plot_pen_t pen;
-
-	pen.stroke_colour = c;
-
-	fline[0].x0 = fline[1].x0 = cx - x;
-	fline[0].x1 = fline[1].x1 = cx + x;
-	fline[0].y0 = fline[0].y1 = cy + y;
-	fline[1].y0 = fline[1].y1 = cy - y;
-
-	fline[2].x0 = fline[3].x0 = cx - y;
-	fline[2].x1 = fline[3].x1 = cx + y;
-	fline[2].y0 = fline[2].y1 = cy + x;
-	fline[3].y0 = fline[3].y1 = cy - x;
-
-	nsfb->plotter_fns->line(nsfb, 4, fline, &pen);
-}
-
-static bool circle_midpoint(nsfb_t *nsfb,
-		int cx,
-		int cy,
-		int r,
-		nsfb_colour_t c,
-		void (circfn)(nsfb_t *nsfb, int cx, int cy, int x, int y, nsfb_colour_t c))
+circle_midpoint(int r, int *lo, int *hi)
 {
 	int x = 0;
 	int y = r;
 	int p = 1 - r;
 
-	circfn(nsfb, cx, cy, x, y, c);
+	ellipse_row_add(lo, hi, x, y);
+	ellipse_row_add(lo, hi, y, x);
 	while (x < y) {
 		x++;
 		if (p < 0) {
@@ -514,41 +515,119 @@ static bool circle_midpoint(nsfb_t *nsfb,
 			y--;
 			p += 2 * (x - y) + 1;
 		}
-		circfn(nsfb, cx, cy, x, y, c);
+		ellipse_row_add(lo, hi, x, y);
+		ellipse_row_add(lo, hi, y, x);
 	}
-	return true;
 }
 
-static bool ellipse(nsfb_t *nsfb, nsfb_bbox_t *ellipse, nsfb_colour_t c)
+/**
+ * Plot an ellipse outline or fill
+ *
+ * A quadrant is walked once to find the run of each row, then every
+ * visible row is plotted once: filled between the runs or with the runs
+ * mirrored to both sides.
+ */
+static bool
+ellipse_plot(nsfb_t *nsfb, nsfb_bbox_t *ellipse, nsfb_colour_t c, bool fill)
 {
-	int width = (ellipse->x1 - ellipse->x0)>>1;
-	int height = (ellipse->y1 - ellipse->y0)>>1;
+	int rx = (ellipse->x1 - ellipse->x0) >> 1;
+	int ry = (ellipse->y1 - ellipse->y0) >> 1;
+	int cx = ellipse->x0 + rx;
+	int cy = ellipse->y0 + ry;
+	nsfb_plot_span_t batch[SPAN_BATCH]; /* spans waiting to be filled */
+	int batchc = 0;
+	int *lo, *hi; /* run of each row from the centre down */
+	int dy, x, y, side;
+	size_t mark;
+
+	if ((rx < 0) || (ry < 0))
+		return true;
+
+	/* clip the bounding box once */
+	if ((cx - rx - 1 >= nsfb->clip.x1) || (cx + rx + 1 < nsfb->clip.x0) ||
+	    (cy - ry >= nsfb->clip.y1) || (cy + ry < nsfb->clip.y0))
+		return true;
 
-	if (width == height) {
-		/* circle */
-		return circle_midpoint(nsfb, ellipse->x0 + width,
-				ellipse->y0 + height, width, c, circlepoints);
+	mark = nsfb_scratch_mark(nsfb);
+	lo = nsfb_scratch_alloc(nsfb, 2 * (ry + 1) * sizeof(int));
+	if (lo == NULL)
+		return false;
+	hi = lo + ry + 1;
+	for (dy = 0; dy <= ry; dy++) {
+		lo[dy] = INT_MAX;
+		hi[dy] = -1;
+	}
+
+	if (rx == ry) {
+		circle_midpoint(rx, lo, hi);
 	} else {
-		return ellipse_midpoint(nsfb, ellipse->x0 + width,
-				ellipse->y0 + height, width, height, c,
-				ellipsepoints);
+		ellipse_midpoint(rx, ry, lo, hi);
+	}
+
+	for (dy = 0; dy <= ry; dy++) {
+		if (hi[dy] < 0)
+			continue;
+
+		/* the row below the centre and its reflection above */
+		for (side = 0; side < ((dy == 0) ? 1 : 2); side++) {
+			y = side ? cy - dy : cy + dy;
+			if ((y < nsfb->clip.y0) || (y >= nsfb->clip.y1))
+				continue;
+
+			if (!fill && ((c & 0xFF000000) != 0xFF000000)) {
+				/* blended pixels are plotted singly, once */
+				for (x = lo[dy]; x <= hi[dy]; x++) {
+					nsfb->plotter_fns->point(nsfb, cx + x,
+								 y, c);
+					if (x != 0)
+						nsfb->plotter_fns->point(nsfb,
+								cx - x, y, c);
+				}
+				continue;
+			}
+
+			if (batchc > SPAN_BATCH - 2) {
+				nsfb->plotter_fns->spans(nsfb, batchc, batch,
+							 c);
+				batchc = 0;
+			}
+
+			batch[batchc].y = y;
+			if (fill) {
+				batch[batchc].x0 = cx - hi[dy];
+				batch[batchc].x1 = cx + hi[dy];
+			} else if (lo[dy] == 0) {
+				/* the two runs meet in the middle */
+				batch[batchc].x0 = cx - hi[dy];
+				batch[batchc].x1 = cx + hi[dy] + 1;
+			} else {
+				batch[batchc].x0 = cx - hi[dy];
+				batch[batchc].x1 = cx - lo[dy] + 1;
+				batchc++;
+				batch[batchc].y = y;
+				batch[batchc].x0 = cx + lo[dy];
+				batch[batchc].x1 = cx + hi[dy] + 1;
+			}
+			batchc++;
+		}
 	}
+
+	if (batchc > 0)
+		nsfb->plotter_fns->spans(nsfb, batchc, batch, c);
+
+	nsfb_scratch_release(nsfb, mark);
+
+	return true;
 }
 
-static bool ellipse_fill(nsfb_t *nsfb, nsfb_bbox_t *ellipse, nsfb_colour_t c)
+static bool ellipse(nsfb_t *nsfb, nsfb_bbox_t *ellipse, nsfb_colour_t c)
 {
-	int width = (ellipse->x1 - ellipse->x0) >> 1;
-	int height = (ellipse->y1 - ellipse->y0) >> 1;
+	return ellipse_plot(nsfb, ellipse, c, false);
+}
 
-	if (width == height) {
-		/* circle */
-		return circle_midpoint(nsfb, ellipse->x0 + width,
-				ellipse->y0 + height, width, c, circlefill);
-	} else {
-		return ellipse_midpoint(nsfb, ellipse->x0 + width,
-				ellipse->y0 + height, width, height, c,
-				ellipsefill);
-	}
+static bool ellipse_fill(nsfb_t *nsfb, nsfb_bbox_t *ellipse, nsfb_colour_t c)
+{
+	return ellipse_plot(nsfb, ellipse, c, true);
 }
 
 
@@ -612,59 +691,502 @@ copy(nsfb_t *nsfb, nsfb_bbox_t *srcbox, nsfb_bbox_t *dstbox)
 
 
 
+/** sin of each whole degree from 0 to 90, scaled by 16384 */
+static const int arc_sin[91] = {
+	0, 286, 572, 857, 1143, 1428, 1713, 1997, 2280, 2563,
+	2845, 3126, 3406, 3686, 3964, 4240, 4516, 4790, 5063, 5334,
+	5604, 5872, 6138, 6402, 6664, 6924, 7182, 7438, 7692, 7943,
+	8192, 8438, 8682, 8923, 9162, 9397, 9630, 9860, 10087, 10311,
+	10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+	12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+	14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+	15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+	16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+	16384
+};
+
+/** The angles an arc sweeps through */
+struct arc_sweep {
+	int start; /**< first angle, 0 to 359 degrees */
+	int sweep; /**< angle swept anticlockwise, 1 to 360 degrees */
+	int ax, ay; /**< direction of the first angle */
+	int bx, by; /**< direction of the last angle */
+};
+
+static int arc_sin_deg(int angle)
+{
+	if (angle <= 90)
+		return arc_sin[angle];
+	if (angle <= 180)
+		return arc_sin[180 - angle];
+	if (angle <= 270)
+		return -arc_sin[angle - 180];
+	return -arc_sin[360 - angle];
+}
+
+/**
+ * Work out the sweep of an arc
+ *
+ * \return false if the arc is empty.
+ */
+static bool arc_sweep_init(struct arc_sweep *arc, int angle1, int angle2)
+{
+	int end;
+
+	if (angle1 == angle2)
+		return false;
+
+	arc->start = angle1 % 360;
+	if (arc->start < 0)
+		arc->start += 360;
+
+	if ((angle2 - angle1 >= 360) || (angle1 - angle2 >= 360)) {
+		arc->sweep = 360;
+	} else {
+		arc->sweep = (angle2 - angle1) % 360;
+		if (arc->sweep <= 0)
+			arc->sweep += 360;
+	}
+
+	end = (arc->start + arc->sweep) % 360;
+	arc->ax = arc_sin_deg((arc->start + 90) % 360);
+	arc->ay = arc_sin_deg(arc->start);
+	arc->bx = arc_sin_deg((end + 90) % 360);
+	arc->by = arc_sin_deg(end);
+
+	return true;
+}
+
+/**
+ * Whether a point lies within the sweep of an arc
+ *
+ * \param arc The sweep.
+ * \param x The horizontal offset from the centre.
+ * \param y The vertical offset from the centre, upwards.
+ */
+static bool arc_sweep_inside(const struct arc_sweep *arc, int x, int y)
+{
+	int64_t a = ((int64_t)arc->ax * y) - ((int64_t)arc->ay * x);
+	int64_t b = ((int64_t)x * arc->by) - ((int64_t)y * arc->bx);
+
+	if (arc->sweep <= 180)
+		return (a >= 0) && (b >= 0);
+
+	/* outside the gap from the last angle round to the first */
+	return (a >= 0) || (b >= 0);
+}
+
+/**
+ * Whether an octant of an arc is plotted and needs its points testing
+ *
+ * \return 0 if the octant is outside the sweep, 1 if it is partly inside
+ *         and 2 if it is wholly inside.
+ */
+static int arc_octant(const struct arc_sweep *arc, int octant)
+{
+	int rel = ((octant * 45) - arc->start + 360) % 360;
+
+	if (rel + 45 <= arc->sweep)
+		return 2;
+	if ((rel < arc->sweep) || (rel + 45 > 360))
+		return 1;
+	return 0;
+}
+
+static inline int64_t arc_floordiv(int64_t n, int64_t d)
+{
+	if (d < 0) {
+		n = -n;
+		d = -d;
+	}
+	return (n >= 0) ? n / d : -((-n + d - 1) / d);
+}
+
+static inline int64_t arc_ceildiv(int64_t n, int64_t d)
+{
+	return -arc_floordiv(-n, d);
+}
+
+/**
+ * Narrow a row to the points on one side of a direction
+ *
+ * Points (x, y) with dx * y - dy * x >= 0 are kept, or > 0 if strict,
+ * reversing the sense when \a sign is -1.
+ */
+static bool
+arc_row_limit(int64_t *lo, int64_t *hi, int y, int dx, int dy, int sign,
+	      bool strict)
+{
+	int64_t n = (int64_t)sign * dx * y;
+	int64_t d = (int64_t)sign * dy;
+
+	/* n - d * x >= 0 (or > 0) */
+	if (d == 0)
+		return strict ? (n > 0) : (n >= 0);
+
+	if (d > 0) {
+		int64_t lim = strict ? arc_ceildiv(n, d) - 1 :
+			arc_floordiv(n, d);
+		if (lim < *hi)
+			*hi = lim;
+	} else {
+		int64_t lim = strict ? arc_floordiv(n, d) + 1 :
+			arc_ceildiv(n, d);
+		if (lim > *lo)
+			*lo = lim;
+	}
+	return *lo <= *hi;
+}
+
+/** Queue a span, merging it with the previous one when they touch. */
+static void
+arc_span(nsfb_t *nsfb, nsfb_plot_span_t *batch, int *batchc, int y, int x0,
+	 int x1, nsfb_colour_t c)
+{
+	nsfb_plot_span_t *prev;
+
+	if (*batchc > 0) {
+		prev = &batch[*batchc - 1];
+		if ((prev->y == y) && (prev->x1 == x0)) {
+			prev->x1 = x1;
+			return;
+		}
+	}
+	if (*batchc == SPAN_BATCH) {
+		nsfb->plotter_fns->spans(nsfb, *batchc, batch, c);
+		*batchc = 0;
+	}
+	batch[*batchc].y = y;
+	batch[*batchc].x0 = x0;
+	batch[*batchc].x1 = x1;
+	(*batchc)++;
+}
+
+/**
+ * Plot an arc of a circle
+ *
+ * The midpoint algorithm walks one octant and each point is reflected
+ * into the octants the sweep covers; only octants partly covered test
+ * their points against the start and end angles. Points on the boundary
+ * of two octants are plotted by one of them so every pixel is plotted
+ * once.
+ */
 static bool arc(nsfb_t *nsfb, int x, int y, int radius, int angle1,
 		int angle2, nsfb_colour_t c)
 {
-	nsfb=nsfb;
-	x = x;
-	y = y;
-	radius = radius;
-	c = c;
-	angle1=angle1;
-	angle2=angle2;
+	/* reflections of (a, b) as x = a * xa + b * xb, y = a * ya + b * yb,
+	 * upwards, for the octants anticlockwise from 0 degrees */
+	static const int oct[8][4] = {
+		{ 0, 1, 1, 0 }, { 1, 0, 0, 1 }, { -1, 0, 0, 1 },
+		{ 0, -1, 1, 0 }, { 0, -1, -1, 0 }, { -1, 0, 0, -1 },
+		{ 1, 0, 0, -1 }, { 0, 1, -1, 0 }
+	};
+	struct arc_sweep sweep;
+	nsfb_plot_span_t batch[SPAN_BATCH];
+	int batchc = 0;
+	int cover[8];
+	int octant;
+	int a, b, p;
+	int px, py;
+	bool opaque = ((c & 0xFF000000) == 0xFF000000);
+
+	if ((radius < 0) || !arc_sweep_init(&sweep, angle1, angle2))
+		return true;
+
+	/* clip the bounding box once */
+	if ((x - radius >= nsfb->clip.x1) || (x + radius < nsfb->clip.x0) ||
+	    (y - radius >= nsfb->clip.y1) || (y + radius < nsfb->clip.y0))
+		return true;
+
+	/* skip octants outside the sweep or whose quadrant is clipped */
+	for (octant = 0; octant < 8; octant++) {
+		cover[octant] = arc_octant(&sweep, octant);
+		if (((octant < 4) ? (y < nsfb->clip.y0) :
+		     (y >= nsfb->clip.y1)) ||
+		    (((octant + 2) % 8 < 4) ? (x >= nsfb->clip.x1) :
+		     (x < nsfb->clip.x0)))
+			cover[octant] = 0;
+	}
+
+	a = 0;
+	b = radius;
+	p = 1 - radius;
+	for (;;) {
+		for (octant = 0; octant < 8; octant++) {
+			if (cover[octant] == 0)
+				continue;
+
+			/* each boundary point belongs to one octant */
+			if ((octant == 0 || octant == 3 || octant == 4 ||
+			     octant == 7) && (a == b))
+				continue;
+			if ((octant == 2 || octant == 4 || octant == 6 ||
+			     octant == 7) && (a == 0))
+				continue;
+			if ((octant == 5) && (b == 0))
+				continue; /* centre of a zero radius arc */
+
+			px = (a * oct[octant][0]) + (b * oct[octant][1]);
+			py = (a * oct[octant][2]) + (b * oct[octant][3]);
+			if ((cover[octant] == 1) &&
+			    !arc_sweep_inside(&sweep, px, py))
+				continue;
+
+			if (opaque) {
+				arc_span(nsfb, batch, &batchc, y - py, x + px,
+					 x + px + 1, c);
+			} else {
+				nsfb->plotter_fns->point(nsfb, x + px, y - py,
+							 c);
+			}
+		}
+
+		if (a >= b)
+			break;
+		a++;
+		if (p < 0) {
+			p += 2 * a + 1;
+		} else {
+			b--;
+			p += 2 * (a - b) + 1;
+		}
+		if (a > b)
+			break;
+	}
+
+	if (batchc > 0)
+		nsfb->plotter_fns->spans(nsfb, batchc, batch, c);
+
+	return true;
+}
+
+/**
+ * Plot a filled sector of a circle
+ *
+ * Each row of the circle is cut down to the columns within the sweep,
+ * which are found directly from the start and end directions, and the
+ * remainder is filled as one or two spans.
+ */
+static bool pie(nsfb_t *nsfb, int x, int y, int radius, int angle1,
+		int angle2, nsfb_colour_t c)
+{
+	struct arc_sweep sweep;
+	nsfb_plot_span_t batch[SPAN_BATCH];
+	int batchc = 0;
+	int *lo, *hi; /* circle run of each row from the centre */
+	int64_t dlo, dhi; /* disc columns of a row */
+	int64_t glo, ghi; /* columns of the gap outside a reflex sweep */
+	int row, row_end, dy, off;
+	size_t mark;
+
+	if ((radius < 0) || !arc_sweep_init(&sweep, angle1, angle2))
+		return true;
+
+	/* clip the bounding box once */
+	if ((x - radius >= nsfb->clip.x1) || (x + radius < nsfb->clip.x0) ||
+	    (y - radius >= nsfb->clip.y1) || (y + radius < nsfb->clip.y0))
+		return true;
+
+	mark = nsfb_scratch_mark(nsfb);
+	lo = nsfb_scratch_alloc(nsfb, 2 * (radius + 1) * sizeof(int));
+	if (lo == NULL)
+		return false;
+	hi = lo + radius + 1;
+	for (dy = 0; dy <= radius; dy++) {
+		lo[dy] = INT_MAX;
+		hi[dy] = -1;
+	}
+	circle_midpoint(radius, lo, hi);
+
+	row = (y - radius < nsfb->clip.y0) ? nsfb->clip.y0 : y - radius;
+	row_end = (y + radius >= nsfb->clip.y1) ? nsfb->clip.y1 - 1 :
+		y + radius;
+
+	for (; row <= row_end; row++) {
+		off = y - row;
+		dy = (off < 0) ? -off : off;
+
+		/* the same columns as a filled circle */
+		dlo = -hi[dy];
+		dhi = hi[dy] - 1;
+		if (dlo > dhi)
+			continue;
+
+		if (sweep.sweep == 360) {
+			arc_span(nsfb, batch, &batchc, row, x + dlo,
+				 x + dhi + 1, c);
+			continue;
+		}
+
+		if (sweep.sweep <= 180) {
+			/* inside both the first and last directions */
+			if (arc_row_limit(&dlo, &dhi, off, sweep.ax, sweep.ay,
+					  1, false) &&
+			    arc_row_limit(&dlo, &dhi, off, sweep.bx, sweep.by,
+					  -1, false))
+				arc_span(nsfb, batch, &batchc, row, x + dlo,
+					 x + dhi + 1, c);
+			continue;
+		}
+
+		/* a reflex sweep is the row less the gap between the last
+		 * and first directions */
+		glo = dlo;
+		ghi = dhi;
+		if (!arc_row_limit(&glo, &ghi, off, sweep.bx, sweep.by,
+				   1, true) ||
+		    !arc_row_limit(&glo, &ghi, off, sweep.ax, sweep.ay,
+				   -1, true)) {
+			arc_span(nsfb, batch, &batchc, row, x + dlo,
+				 x + dhi + 1, c);
+			continue;
+		}
+		if (glo > dlo)
+			arc_span(nsfb, batch, &batchc, row, x + dlo, x + glo,
+				 c);
+		if (ghi < dhi)
+			arc_span(nsfb, batch, &batchc, row, x + ghi + 1,
+				 x + dhi + 1, c);
+	}
+
+	if (batchc > 0)
+		nsfb->plotter_fns->spans(nsfb, batchc, batch, c);
+
+	nsfb_scratch_release(nsfb, mark);
+
 	return true;
 }
 
-#define N_SEG 30
+/** Largest number of segments a curve is flattened into */
+#define BEZIER_SEG_MAX 1024
 
+/**
+ * Number of line segments needed to flatten a curve
+ *
+ * By Wang's formula a curve of degree d is within tolerance tol of the
+ * lines joining n evenly spaced points on it when
+ *
+ *   n * n >= d * (d - 1) / 8 * m / tol
+ *
+ * where m is the largest second difference of its control points. The
+ * tolerance is a quarter of a pixel and m is overestimated as the sum of
+ * the absolute components, so the factor is 3 for cubics and 1 for
+ * quadratics.
+ *
+ * \param factor The degree factor.
+ * \param ddx0 The first second difference in x.
+ * \param ddy0 The first second difference in y.
+ * \param ddx1 The second second difference in x, or 0 for quadratics.
+ * \param ddy1 The second second difference in y, or 0 for quadratics.
+ * \return The number of segments.
+ */
+static int
+bezier_segments(int factor, int ddx0, int ddy0, int ddx1, int ddy1)
+{
+	int64_t m0 = (int64_t)abs(ddx0) + abs(ddy0);
+	int64_t m1 = (int64_t)abs(ddx1) + abs(ddy1);
+	int64_t need = factor * ((m0 > m1) ? m0 : m1);
+	int segs = 1;
+
+	while ((segs < BEZIER_SEG_MAX) && ((int64_t)segs * segs < need))
+		segs++;
+
+	return segs;
+}
+
+static int cubic_segments(nsfb_bbox_t *curve,
+			  nsfb_point_t *ctrla,
+			  nsfb_point_t *ctrlb)
+{
+	return bezier_segments(3,
+			       curve->x0 - 2 * ctrla->x + ctrlb->x,
+			       curve->y0 - 2 * ctrla->y + ctrlb->y,
+			       ctrla->x - 2 * ctrlb->x + curve->x1,
+			       ctrla->y - 2 * ctrlb->y + curve->y1);
+}
+
+static int quadratic_segments(nsfb_bbox_t *curve, nsfb_point_t *ctrla)
+{
+	return bezier_segments(1,
+			       curve->x0 - 2 * ctrla->x + curve->x1,
+			       curve->y0 - 2 * ctrla->y + curve->y1,
+			       0, 0);
+}
+
+/**
+ * Divide a forward difference accumulator back to a coordinate
+ *
+ * Rounds to nearest, halves upwards.
+ */
+static inline int bezier_round(int64_t v, int64_t scale)
+{
+	v = 2 * v + scale;
+	scale *= 2;
+	if (v < 0)
+		return -(int)((-v + scale - 1) / scale);
+	return (int)(v / scale);
+}
+
+/* calculate a series of points which describe a cubic bezier spline.
+ *
+ * fills an array of points with values describing a cubic curve. Both the
+ * start and end points are included as the first and last points
+ * respectively. Only if the next point on the curve is different from its
+ * predecessor is the point added which ensures points for the same position
+ * are not repeated.
+ *
+ * The curve is evaluated at segs evenly spaced steps by forward
+ * differencing. With every term scaled by segs cubed the differences are
+ * exact integers, so no error accumulates along the curve.
+ *
+ * The point array must have room for segs + 1 points.
+ */
 static int
-cubic_points(unsigned int pointc,
-			 nsfb_point_t *point,
-			 nsfb_bbox_t *curve,
-			 nsfb_point_t *ctrla,
-			 nsfb_point_t *ctrlb)
-{
-	unsigned int seg_loop;
-	double t;
-	double one_minus_t;
-	double a;
-	double b;
-	double c;
-	double d;
-	double x;
-	double y;
+cubic_points(int segs,
+	     nsfb_point_t *point,
+	     nsfb_bbox_t *curve,
+	     nsfb_point_t *ctrla,
+	     nsfb_point_t *ctrlb)
+{
+	int64_t n = segs;
+	int64_t scale = n * n * n;
+	int64_t a, b, c; /* polynomial coefficients */
+	int64_t fx, dfx, ddfx, dddfx;
+	int64_t fy, dfy, ddfy, dddfy;
+	int seg_loop;
 	int cur_point;
 
+	/* P(t) = a t^3 + b t^2 + c t + P0 */
+	a = -curve->x0 + 3 * ctrla->x - 3 * ctrlb->x + curve->x1;
+	b = 3 * curve->x0 - 6 * ctrla->x + 3 * ctrlb->x;
+	c = -3 * curve->x0 + 3 * ctrla->x;
+	fx = curve->x0 * scale;
+	dfx = a + b * n + c * n * n;
+	ddfx = 6 * a + 2 * b * n;
+	dddfx = 6 * a;
+
+	a = -curve->y0 + 3 * ctrla->y - 3 * ctrlb->y + curve->y1;
+	b = 3 * curve->y0 - 6 * ctrla->y + 3 * ctrlb->y;
+	c = -3 * curve->y0 + 3 * ctrla->y;
+	fy = curve->y0 * scale;
+	dfy = a + b * n + c * n * n;
+	ddfy = 6 * a + 2 * b * n;
+	dddfy = 6 * a;
+
 	point[0].x = curve->x0;
 	point[0].y = curve->y0;
 	cur_point = 1;
-	pointc--;
-
-	for (seg_loop = 1; seg_loop < pointc; ++seg_loop) {
-		t = (double)seg_loop / (double)pointc;
-
-		one_minus_t = 1.0 - t;
-
-		a = one_minus_t * one_minus_t * one_minus_t;
-		b = 3.0 * t * one_minus_t * one_minus_t;
-		c = 3.0 * t * t * one_minus_t;
-		d = t * t * t;
 
-		x = a * curve->x0 + b * ctrla->x + c * ctrlb->x + d * curve->x1;
-		y = a * curve->y0 + b * ctrla->y + c * ctrlb->y + d * curve->y1;
+	for (seg_loop = 1; seg_loop < segs; ++seg_loop) {
+		fx += dfx;
+		dfx += ddfx;
+		ddfx += dddfx;
+		fy += dfy;
+		dfy += ddfy;
+		ddfy += dddfy;
 
-		point[cur_point].x = x;
-		point[cur_point].y = y;
+		point[cur_point].x = bezier_round(fx, scale);
+		point[cur_point].y = bezier_round(fy, scale);
 		if ((point[cur_point].x != point[cur_point - 1].x) ||
 				(point[cur_point].y != point[cur_point - 1].y))
 			cur_point++;
@@ -681,47 +1203,47 @@ cubic_points(unsigned int pointc,
 
 /* calculate a series of points which describe a quadratic bezier spline.
  *
- * fills an array of points with values describing a quadratic curve. Both the
- * start and end points are included as the first and last points
- * respectively. Only if the next point on the curve is different from its
- * predecessor is the point added which ensures points for the same position
- * are not repeated.
+ * As cubic_points() with every term scaled by segs squared.
  */
 static int
-quadratic_points(unsigned int pointc,
-				 nsfb_point_t *point,
-				 nsfb_bbox_t *curve,
-				 nsfb_point_t *ctrla)
-{
-	unsigned int seg_loop;
-	double t;
-	double one_minus_t;
-	double a;
-	double b;
-	double c;
-	double x;
-	double y;
+quadratic_points(int segs,
+		 nsfb_point_t *point,
+		 nsfb_bbox_t *curve,
+		 nsfb_point_t *ctrla)
+{
+	int64_t n = segs;
+	int64_t scale = n * n;
+	int64_t a, b; /* polynomial coefficients */
+	int64_t fx, dfx, ddfx;
+	int64_t fy, dfy, ddfy;
+	int seg_loop;
 	int cur_point;
 
+	/* P(t) = a t^2 + b t + P0 */
+	a = curve->x0 - 2 * ctrla->x + curve->x1;
+	b = 2 * (ctrla->x - curve->x0);
+	fx = curve->x0 * scale;
+	dfx = a + b * n;
+	ddfx = 2 * a;
+
+	a = curve->y0 - 2 * ctrla->y + curve->y1;
+	b = 2 * (ctrla->y - curve->y0);
+	fy = curve->y0 * scale;
+	dfy = a + b * n;
+	ddfy = 2 * a;
+
 	point[0].x = curve->x0;
 	point[0].y = curve->y0;
 	cur_point = 1;
-	pointc--; /* we have added the start point, one less point in the curve */
-
-	for (seg_loop = 1; seg_loop < pointc; ++seg_loop) {
-		t = (double)seg_loop / (double)pointc;
-
-		one_minus_t = 1.0 - t;
 
-		a = one_minus_t * one_minus_t;
-		b = 2.0 * t * one_minus_t;
-		c = t * t;
+	for (seg_loop = 1; seg_loop < segs; ++seg_loop) {
+		fx += dfx;
+		dfx += ddfx;
+		fy += dfy;
+		dfy += ddfy;
 
-		x = a * curve->x0 + b * ctrla->x + c * curve->x1;
-		y = a * curve->y0 + b * ctrla->y + c * curve->y1;
-
-		point[cur_point].x = x;
-		point[cur_point].y = y;
+		point[cur_point].x = bezier_round(fx, scale);
+		point[cur_point].y = bezier_round(fy, scale);
 		if ((point[cur_point].x != point[cur_point - 1].x) ||
 				(point[cur_point].y != point[cur_point - 1].y))
 			cur_point++;
@@ -743,15 +1265,37 @@ polylines(nsfb_t *nsfb,
 		  nsfb_plot_pen_t *pen)
 {
 	int point_loop;
-	nsfb_bbox_t line;
+	nsfb_bbox_t *lines;
+	size_t mark;
+	bool ret;
 
-	if (pen->stroke_type != NFSB_PLOT_OPTYPE_NONE) {
-		for (point_loop = 0; point_loop < (pointc - 1); point_loop++) {
-			line = *(nsfb_bbox_t *)&points[point_loop];
-			nsfb->plotter_fns->line(nsfb, 1, &line, pen);
-		}
+	if ((pen->stroke_type == NFSB_PLOT_OPTYPE_NONE) || (pointc < 2))
+		return true;
+
+	if (pen->stroke_width > 1) {
+		/* wide segments are joined rather than overlapped */
+		return nsfb_stroke_polyline(nsfb, pointc, points, false, pen);
 	}
-	return true;
+
+	/* the segments are plotted together so a stroke pattern carries
+	 * on from one segment into the next */
+	mark = nsfb_scratch_mark(nsfb);
+	lines = nsfb_scratch_alloc(nsfb, (pointc - 1) * sizeof(nsfb_bbox_t));
+	if (lines == NULL)
+		return false;
+
+	for (point_loop = 0; point_loop < (pointc - 1); point_loop++) {
+		lines[point_loop].x0 = points[point_loop].x;
+		lines[point_loop].y0 = points[point_loop].y;
+		lines[point_loop].x1 = points[point_loop + 1].x;
+		lines[point_loop].y1 = points[point_loop + 1].y;
+	}
+
+	ret = nsfb->plotter_fns->line(nsfb, pointc - 1, lines, pen);
+
+	nsfb_scratch_release(nsfb, mark);
+
+	return ret;
 }
 
 
@@ -762,13 +1306,26 @@ quadratic(nsfb_t *nsfb,
 		  nsfb_point_t *ctrla,
 		  nsfb_plot_pen_t *pen)
 {
-	nsfb_point_t points[N_SEG];
+	nsfb_point_t *points;
+	size_t mark;
+	int segs;
+	bool ret;
 
 	if (pen->stroke_type == NFSB_PLOT_OPTYPE_NONE)
 		return false;
 
-	return polylines(nsfb, quadratic_points(N_SEG, points, curve, ctrla),
+	segs = quadratic_segments(curve, ctrla);
+	mark = nsfb_scratch_mark(nsfb);
+	points = nsfb_scratch_alloc(nsfb, (segs + 1) * sizeof(nsfb_point_t));
+	if (points == NULL)
+		return false;
+
+	ret = polylines(nsfb, quadratic_points(segs, points, curve, ctrla),
 			points, pen);
+
+	nsfb_scratch_release(nsfb, mark);
+
+	return ret;
 }
 
 static bool
@@ -778,16 +1335,55 @@ cubic(nsfb_t *nsfb,
 	  nsfb_point_t *ctrlb,
 	  nsfb_plot_pen_t *pen)
 {
-	nsfb_point_t points[N_SEG];
+	nsfb_point_t *points;
+	size_t mark;
+	int segs;
+	bool ret;
 
 	if (pen->stroke_type == NFSB_PLOT_OPTYPE_NONE)
 		return false;
 
-	return polylines(nsfb, cubic_points(N_SEG, points, curve, ctrla,ctrlb),
+	segs = cubic_segments(curve, ctrla, ctrlb);
+	mark = nsfb_scratch_mark(nsfb);
+	points = nsfb_scratch_alloc(nsfb, (segs + 1) * sizeof(nsfb_point_t));
+	if (points == NULL)
+		return false;
+
+	ret = polylines(nsfb, cubic_points(segs, points, curve, ctrla, ctrlb),
 			points, pen);
+
+	nsfb_scratch_release(nsfb, mark);
+
+	return ret;
 }
 
 
+/**
+ * Gather the points of a path curve
+ *
+ * \param op The path operation of the curve's start point.
+ * \param curve Updated with the start and end points.
+ * \param ctrla Updated with the first control point.
+ * \param ctrlb Updated with the second control point, or NULL for a
+ *              quadratic curve.
+ */
+static void
+path_curve(const nsfb_plot_pathop_t *op,
+	   nsfb_bbox_t *curve,
+	   nsfb_point_t *ctrla,
+	   nsfb_point_t *ctrlb)
+{
+	curve->x0 = op[0].point.x;
+	curve->y0 = op[0].point.y;
+	*ctrla = op[1].point;
+	if (ctrlb != NULL) {
+		*ctrlb = op[2].point;
+		op++;
+	}
+	curve->x1 = op[2].point.x;
+	curve->y1 = op[2].point.y;
+}
+
 static bool
 path(nsfb_t *nsfb, int pathc, nsfb_plot_pathop_t *pathop, nsfb_plot_pen_t *pen)
 {
@@ -800,18 +1396,33 @@ path(nsfb_t *nsfb, int pathc, nsfb_plot_pathop_t *pathop, nsfb_plot_pen_t *pen)
 	nsfb_point_t ctrlb;
 	int added_count = 0;
 	int bpts;
+	size_t mark;
 
-	/* count the verticies in the path and add N_SEG extra for curves */
+	/* count the verticies in the path and add the segments of curves,
+	 * which reuse the vertices of their start and control points */
 	for (path_loop = 0; path_loop < pathc; path_loop++) {
 		ptc++;
-		if ((pathop[path_loop].operation == NFSB_PLOT_PATHOP_QUAD) ||
-				(pathop[path_loop].operation ==
-				 NFSB_PLOT_PATHOP_CUBIC))
-			ptc += N_SEG;
+		switch (pathop[path_loop].operation) {
+		case NFSB_PLOT_PATHOP_QUAD:
+			path_curve(pathop + path_loop - 2, &curve, &ctrla,
+				   NULL);
+			ptc += quadratic_segments(&curve, &ctrla);
+			break;
+
+		case NFSB_PLOT_PATHOP_CUBIC:
+			path_curve(pathop + path_loop - 3, &curve, &ctrla,
+				   &ctrlb);
+			ptc += cubic_segments(&curve, &ctrla, &ctrlb);
+			break;
+
+		default:
+			break;
+		}
 	}
 
 	/* allocate storage for the vertexes */
-	curpt = pts = malloc(ptc * sizeof(nsfb_point_t));
+	mark = nsfb_scratch_mark(nsfb);
+	curpt = pts = nsfb_scratch_alloc(nsfb, ptc * sizeof(nsfb_point_t));
 	if (curpt == NULL) {
 		return false;
 	}
@@ -821,13 +1432,11 @@ path(nsfb_t *nsfb, int pathc, nsfb_plot_pathop_t *pathop, nsfb_plot_pen_t *pen)
 		case NFSB_PLOT_PATHOP_QUAD:
 			curpt-=2;
 			added_count -= 2;
-			curve.x0 = pathop[path_loop - 2].point.x;
-			curve.y0 = pathop[path_loop - 2].point.y;
-			ctrla.x = pathop[path_loop - 1].point.x;
-			ctrla.y = pathop[path_loop - 1].point.y;
-			curve.x1 = pathop[path_loop].point.x;
-			curve.y1 = pathop[path_loop].point.y;
-			bpts = quadratic_points(N_SEG, curpt, &curve, &ctrla);
+			path_curve(pathop + path_loop - 2, &curve, &ctrla,
+				   NULL);
+			bpts = quadratic_points(quadratic_segments(&curve,
+								   &ctrla),
+						curpt, &curve, &ctrla);
 			curpt += bpts;
 			added_count += bpts;
 			break;
@@ -835,15 +1444,11 @@ path(nsfb_t *nsfb, int pathc, nsfb_plot_pathop_t *pathop, nsfb_plot_pen_t *pen)
 		case NFSB_PLOT_PATHOP_CUBIC:
 			curpt-=3;
 			added_count -=3;
-			curve.x0 = pathop[path_loop - 3].point.x;
-			curve.y0 = pathop[path_loop - 3].point.y;
-			ctrla.x = pathop[path_loop - 2].point.x;
-			ctrla.y = pathop[path_loop - 2].point.y;
-			ctrlb.x = pathop[path_loop - 1].point.x;
-			ctrlb.y = pathop[path_loop - 1].point.y;
-			curve.x1 = pathop[path_loop].point.x;
-			curve.y1 = pathop[path_loop].point.y;
-			bpts = cubic_points(N_SEG, curpt, &curve, &ctrla, &ctrlb);
+			path_curve(pathop + path_loop - 3, &curve, &ctrla,
+				   &ctrlb);
+			bpts = cubic_points(cubic_segments(&curve, &ctrla,
+							   &ctrlb),
+					    curpt, &curve, &ctrla, &ctrlb);
 			curpt += bpts;
 			added_count += bpts;
 			break;
@@ -864,7 +1469,7 @@ path(nsfb_t *nsfb, int pathc, nsfb_plot_pathop_t *pathop, nsfb_plot_pen_t *pen)
 		polylines(nsfb, added_count, pts, pen);
 	}
 
-	free(pts);
+	nsfb_scratch_release(nsfb, mark);
 
 	return true;
 }
@@ -872,6 +1477,7 @@ path(nsfb_t *nsfb, int pathc, nsfb_plot_pathop_t *pathop, nsfb_plot_pen_t *pen)
 bool select_plotters(nsfb_t *nsfb)
 {
 	const nsfb_plotter_fns_t *table = NULL;
+	enum nsfb_format_e rowfmt;
 
 	switch (nsfb->format) {
 
@@ -933,16 +1539,38 @@ bool select_plotters(nsfb_t *nsfb)
 
 	memcpy(nsfb->plotter_fns, table, sizeof(nsfb_plotter_fns_t));
 
+	if (nsfb->plotter_fns->spans == NULL) {
+		nsfb->plotter_fns->spans = fill_spans;
+	}
+
+	if (nsfb->plotter_fns->rectangle == NULL) {
+		nsfb->plotter_fns->rectangle = rectangle;
+	}
+
+	/* use vector routines where the processor has them */
+	if ((nsfb->bpp == 32) || (nsfb->bpp == 16)) {
+		nsfb->plotter_fns->fill_rows = nsfb_fill_rows_select();
+	}
+	nsfb->plotter_fns->blend_row = nsfb_blend_row_select(nsfb->format);
+	nsfb->plotter_fns->glyph1_row = nsfb_glyph1_row_select(nsfb->bpp);
+	nsfb->plotter_fns->glyph8_rows = nsfb_glyph8_rows_select(nsfb->format);
+
+	/* row conversion must match the plotters pixel encoding and the
+	 * 16bpp plotters always encode RGB565 */
+	rowfmt = (nsfb->bpp == 16) ? NSFB_FMT_RGB565 : nsfb->format;
+	nsfb->plotter_fns->row_from_colour = nsfb_row_from_colour_select(rowfmt);
+	nsfb->plotter_fns->row_to_colour = nsfb_row_to_colour_select(rowfmt);
+
 	/* set the generics */
 	nsfb->plotter_fns->clg = clg;
 	nsfb->plotter_fns->set_clip = set_clip;
 	nsfb->plotter_fns->get_clip = get_clip;
 	nsfb->plotter_fns->polygon = polygon;
-	nsfb->plotter_fns->rectangle = rectangle;
 	nsfb->plotter_fns->ellipse = ellipse;
 	nsfb->plotter_fns->ellipse_fill = ellipse_fill;
 	nsfb->plotter_fns->copy = copy;
 	nsfb->plotter_fns->arc = arc;
+	nsfb->plotter_fns->pie = pie;
 	nsfb->plotter_fns->quadratic = quadratic;
 	nsfb->plotter_fns->cubic = cubic;
 	nsfb->plotter_fns->path = path;
@@ -0,0 +1,292 @@
+/*
+ * Copyright 2026 libnsfb contributors
+ *
+ * This file is part of libnsfb, http://www.netsurf-browser.org/
+ * Licenced under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/** \file
+ * Accelerated glyph expansion (implementation).
+ *
+ * A 1bpp glyph byte is broadcast to every lane of a vector, masked with the
+ * bit each lane represents and compared, giving a per pixel mask which
+ * merges the foreground pixel into the destination. Eight pixels are
+ * produced per glyph byte with no per-pixel branches.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "libnsfb.h"
+#include "libnsfb_plot.h"
+
+#include "nsfb.h"
+#include "plot.h"
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define NSFB_GLYPH_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#define NSFB_GLYPH_NEON 1
+#include <arm_neon.h>
+#endif
+
+#ifdef NSFB_GLYPH_X86
+
+static void
+glyph1_row32_sse2(void *dst, const uint8_t *bits, int count, uint32_t ent)
+{
+	const __m128i sel0 = _mm_setr_epi32(0x80, 0x40, 0x20, 0x10);
+	const __m128i sel1 = _mm_setr_epi32(0x08, 0x04, 0x02, 0x01);
+	const __m128i fg = _mm_set1_epi32(ent);
+	uint32_t *pvideo = dst;
+	__m128i b, m0, m1;
+
+	for (; count > 0; count--, bits++, pvideo += 8) {
+		if (*bits == 0)
+			continue;
+
+		if (*bits == 0xFF) {
+			_mm_storeu_si128((void *)pvideo, fg);
+			_mm_storeu_si128((void *)(pvideo + 4), fg);
+			continue;
+		}
+
+		b = _mm_set1_epi32(*bits);
+		m0 = _mm_cmpeq_epi32(_mm_and_si128(b, sel0), sel0);
+		m1 = _mm_cmpeq_epi32(_mm_and_si128(b, sel1), sel1);
+
+		_mm_storeu_si128((void *)pvideo,
+			_mm_or_si128(_mm_and_si128(m0, fg),
+				_mm_andnot_si128(m0,
+					_mm_loadu_si128((void *)pvideo))));
+		_mm_storeu_si128((void *)(pvideo + 4),
+			_mm_or_si128(_mm_and_si128(m1, fg),
+				_mm_andnot_si128(m1,
+					_mm_loadu_si128((void *)(pvideo + 4)))));
+	}
+}
+
+__attribute__((target("avx2")))
+static void
+glyph1_row32_avx2(void *dst, const uint8_t *bits, int count, uint32_t ent)
+{
+	const __m256i sel = _mm256_setr_epi32(0x80, 0x40, 0x20, 0x10,
+					      0x08, 0x04, 0x02, 0x01);
+	const __m256i fg = _mm256_set1_epi32(ent);
+	uint32_t *pvideo = dst;
+	__m256i m;
+
+	for (; count > 0; count--, bits++, pvideo += 8) {
+		if (*bits == 0)
+			continue;
+
+		if (*bits == 0xFF) {
+			_mm256_storeu_si256((void *)pvideo, fg);
+			continue;
+		}
+
+		m = _mm256_cmpeq_epi32(_mm256_and_si256(
+					_mm256_set1_epi32(*bits), sel), sel);
+		_mm256_storeu_si256((void *)pvideo,
+			_mm256_blendv_epi8(_mm256_loadu_si256((void *)pvideo),
+					   fg, m));
+	}
+	_mm256_zeroupper();
+}
+
+static void
+glyph1_row16_sse2(void *dst, const uint8_t *bits, int count, uint32_t ent)
+{
+	const __m128i sel = _mm_setr_epi16(0x80, 0x40, 0x20, 0x10,
+					   0x08, 0x04, 0x02, 0x01);
+	const __m128i fg = _mm_set1_epi16(ent);
+	uint16_t *pvideo = dst;
+	__m128i m;
+
+	for (; count > 0; count--, bits++, pvideo += 8) {
+		if (*bits == 0)
+			continue;
+
+		if (*bits == 0xFF) {
+			_mm_storeu_si128((void *)pvideo, fg);
+			continue;
+		}
+
+		m = _mm_cmpeq_epi16(_mm_and_si128(_mm_set1_epi16(*bits), sel),
+				    sel);
+		_mm_storeu_si128((void *)pvideo,
+			_mm_or_si128(_mm_and_si128(m, fg),
+				_mm_andnot_si128(m,
+					_mm_loadu_si128((void *)pvideo))));
+	}
+}
+
+static void
+glyph1_row8_sse2(void *dst, const uint8_t *bits, int count, uint32_t ent)
+{
+	const __m128i sel = _mm_setr_epi8((char)0x80, 0x40, 0x20, 0x10,
+					  0x08, 0x04, 0x02, 0x01,
+					  0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i fg = _mm_set1_epi8(ent);
+	uint8_t *pvideo = dst;
+	__m128i m;
+
+	for (; count > 0; count--, bits++, pvideo += 8) {
+		if (*bits == 0)
+			continue;
+
+		if (*bits == 0xFF) {
+			_mm_storel_epi64((void *)pvideo, fg);
+			continue;
+		}
+
+		m = _mm_cmpeq_epi8(_mm_and_si128(_mm_set1_epi8(*bits), sel),
+				   sel);
+		_mm_storel_epi64((void *)pvideo,
+			_mm_or_si128(_mm_and_si128(m, fg),
+				_mm_andnot_si128(m,
+					_mm_loadl_epi64((void *)pvideo))));
+	}
+}
+
+#endif /* NSFB_GLYPH_X86 */
+
+#ifdef NSFB_GLYPH_NEON
+
+static void
+glyph1_row32_neon(void *dst, const uint8_t *bits, int count, uint32_t ent)
+{
+	static const uint32_t sel[8] = {
+		0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01
+	};
+	const uint32x4_t sel0 = vld1q_u32(sel);
+	const uint32x4_t sel1 = vld1q_u32(sel + 4);
+	const uint32x4_t fg = vdupq_n_u32(ent);
+	uint32_t *pvideo = dst;
+	uint32x4_t b;
+
+	for (; count > 0; count--, bits++, pvideo += 8) {
+		if (*bits == 0)
+			continue;
+
+		if (*bits == 0xFF) {
+			vst1q_u32(pvideo, fg);
+			vst1q_u32(pvideo + 4, fg);
+			continue;
+		}
+
+		b = vdupq_n_u32(*bits);
+		vst1q_u32(pvideo, vbslq_u32(vtstq_u32(b, sel0), fg,
+					    vld1q_u32(pvideo)));
+		vst1q_u32(pvideo + 4, vbslq_u32(vtstq_u32(b, sel1), fg,
+						vld1q_u32(pvideo + 4)));
+	}
+}
+
+static void
+glyph1_row16_neon(void *dst, const uint8_t *bits, int count, uint32_t ent)
+{
+	static const uint16_t sel[8] = {
+		0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01
+	};
+	const uint16x8_t selv = vld1q_u16(sel);
+	const uint16x8_t fg = vdupq_n_u16(ent);
+	uint16_t *pvideo = dst;
+
+	for (; count > 0; count--, bits++, pvideo += 8) {
+		if (*bits == 0)
+			continue;
+
+		if (*bits == 0xFF) {
+			vst1q_u16(pvideo, fg);
+			continue;
+		}
+
+		vst1q_u16(pvideo, vbslq_u16(vtstq_u16(vdupq_n_u16(*bits), selv),
+					    fg, vld1q_u16(pvideo)));
+	}
+}
+
+static void
+glyph1_row8_neon(void *dst, const uint8_t *bits, int count, uint32_t ent)
+{
+	static const uint8_t sel[8] = {
+		0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01
+	};
+	const uint8x8_t selv = vld1_u8(sel);
+	const uint8x8_t fg = vdup_n_u8(ent);
+	uint8_t *pvideo = dst;
+
+	for (; count > 0; count--, bits++, pvideo += 8) {
+		if (*bits == 0)
+			continue;
+
+		if (*bits == 0xFF) {
+			vst1_u8(pvideo, fg);
+			continue;
+		}
+
+		vst1_u8(pvideo, vbsl_u8(vtst_u8(vdup_n_u8(*bits), selv),
+					fg, vld1_u8(pvideo)));
+	}
+}
+
+#endif /* NSFB_GLYPH_NEON */
+
+/* exported interface documented in plot.h */
+nsfb_glyph1_row_t *nsfb_glyph1_row_select(int bpp)
+{
+	unsigned int features = nsfb_cpu_features();
+
+#ifdef NSFB_GLYPH_X86
+	switch (bpp) {
+	case 32:
+		if (features & NSFB_CPU_AVX2)
+			return glyph1_row32_avx2;
+		if (features & NSFB_CPU_SSE2)
+			return glyph1_row32_sse2;
+		break;
+
+	case 16:
+		if (features & NSFB_CPU_SSE2)
+			return glyph1_row16_sse2;
+		break;
+
+	case 8:
+		if (features & NSFB_CPU_SSE2)
+			return glyph1_row8_sse2;
+		break;
+	}
+#endif
+
+#ifdef NSFB_GLYPH_NEON
+	if (features & NSFB_CPU_NEON) {
+		switch (bpp) {
+		case 32:
+			return glyph1_row32_neon;
+
+		case 16:
+			return glyph1_row16_neon;
+
+		case 8:
+			return glyph1_row8_neon;
+		}
+	}
+#endif
+
+	(void)features;
+	(void)bpp;
+
+	return NULL;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset:8
+ * End:
+ */
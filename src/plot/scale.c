@@ -0,0 +1,356 @@
+/*
+ * Copyright 2026 libnsfb contributors
+ *
+ * This file is part of libnsfb, http://www.netsurf-browser.org/
+ * Licenced under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/** \file
+ * Scaled bitmap sampling (implementation).
+ *
+ * The source column of every plotted destination column is worked out once
+ * per bitmap rather than stepped for every row. Rows are sampled with the
+ * nearest, box or bilinear filter; a destination row which samples the same
+ * source rows as the one before it is reported as a repeat so the plotter
+ * can reuse the pixels it has already produced.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "libnsfb.h"
+#include "libnsfb_plot.h"
+
+#include "nsfb.h"
+#include "plot.h"
+#include "scratch.h"
+
+/** Sum of the colours averaged by the box filter */
+struct scale_sum {
+	uint64_t a; /**< alpha */
+	uint64_t r; /**< red, premultiplied when alpha */
+	uint64_t g; /**< green, premultiplied when alpha */
+	uint64_t b; /**< blue, premultiplied when alpha */
+	uint64_t count; /**< number of colours */
+};
+
+static inline void
+scale_add(struct scale_sum *sum, nsfb_colour_t c, bool alpha)
+{
+	uint64_t a = c >> 24;
+	uint64_t cw = alpha ? a : 1;
+
+	sum->a += a;
+	sum->r += (c & 0xFF) * cw;
+	sum->g += ((c >> 8) & 0xFF) * cw;
+	sum->b += ((c >> 16) & 0xFF) * cw;
+	sum->count++;
+}
+
+static inline nsfb_colour_t
+scale_resolve(const struct scale_sum *sum, bool alpha)
+{
+	uint64_t a;
+	uint64_t div;
+
+	a = (sum->a + (sum->count / 2)) / sum->count;
+	if (alpha) {
+		if (sum->a == 0)
+			return 0;
+		div = sum->a;
+	} else {
+		div = sum->count;
+	}
+
+	return (nsfb_colour_t)(a << 24) |
+		(nsfb_colour_t)((sum->r + (div / 2)) / div) |
+		(nsfb_colour_t)(((sum->g + (div / 2)) / div) << 8) |
+		(nsfb_colour_t)(((sum->b + (div / 2)) / div) << 16);
+}
+
+/**
+ * Linear interpolation between two colours
+ *
+ * Red and blue, then alpha and green, are interpolated in pairs in one
+ * 32bit multiply each, rounded, with \a f in 0 to 256 weighting
+ * colour \a b.
+ */
+static inline nsfb_colour_t
+scale_lerp(nsfb_colour_t a, nsfb_colour_t b, unsigned int f)
+{
+	uint32_t rb, ag;
+
+	rb = ((((a & 0xFF00FF) * (256 - f)) +
+	       ((b & 0xFF00FF) * f) + 0x800080) >> 8) & 0xFF00FF;
+	ag = ((((a >> 8) & 0xFF00FF) * (256 - f)) +
+	      (((b >> 8) & 0xFF00FF) * f) + 0x800080) & 0xFF00FF00;
+
+	return rb | ag;
+}
+
+/**
+ * Interpolate between four colours
+ *
+ * Opaque colours are interpolated directly. Otherwise each colour is
+ * weighted by its alpha so transparent pixels contribute no colour; the
+ * weights total 65536 so the weighted sums fit in 32 bits.
+ */
+static inline nsfb_colour_t
+scale_bilinear(const nsfb_colour_t *c, unsigned int fx, unsigned int fy,
+	       bool alpha)
+{
+	uint32_t aw[4];
+	uint32_t a, sum, res;
+	int shift, i;
+
+	if (!alpha || ((c[0] & c[1] & c[2] & c[3]) >> 24) == 0xFF) {
+		return scale_lerp(scale_lerp(c[0], c[1], fx),
+				  scale_lerp(c[2], c[3], fx), fy);
+	}
+
+	aw[0] = (c[0] >> 24) * (256 - fx) * (256 - fy);
+	aw[1] = (c[1] >> 24) * fx * (256 - fy);
+	aw[2] = (c[2] >> 24) * (256 - fx) * fy;
+	aw[3] = (c[3] >> 24) * fx * fy;
+
+	a = aw[0] + aw[1] + aw[2] + aw[3];
+	if (a == 0)
+		return 0;
+
+	res = ((a + 32768) >> 16) << 24;
+	for (shift = 0; shift < 24; shift += 8) {
+		sum = a / 2;
+		for (i = 0; i < 4; i++)
+			sum += ((c[i] >> shift) & 0xFF) * aw[i];
+		res |= (sum / a) << shift;
+	}
+	return res;
+}
+
+/**
+ * Position of a bilinear sample in 24.8 fixed point
+ *
+ * The centre of destination pixel \a d of \a dsize maps to the source
+ * pixel centres of \a ssize, clamped to the first and last pixel.
+ *
+ * \param d The destination pixel.
+ * \param dsize The destination size.
+ * \param ssize The source size.
+ * \param frac Updated with the weight of the following pixel, 0 to 255.
+ * \return The first source pixel.
+ */
+static inline int
+scale_bilinear_pos(int d, int dsize, int ssize, unsigned int *frac)
+{
+	int64_t pos;
+
+	pos = (((int64_t)(2 * d + 1) * ssize * 256) / (2 * dsize)) - 128;
+	if (pos < 0)
+		pos = 0;
+
+	if ((pos >> 8) >= (ssize - 1)) {
+		*frac = 0;
+		return ssize - 1;
+	}
+
+	*frac = pos & 0xFF;
+	return pos >> 8;
+}
+
+/* exported interface documented in plot.h */
+bool
+nsfb_scale_init(struct nsfb_scale_s *scale,
+		nsfb_t *nsfb,
+		const nsfb_colour_t *pixel,
+		int bmp_width,
+		int bmp_height,
+		int bmp_stride,
+		int width,
+		int height,
+		int xoff,
+		int rwidth,
+		nsfb_plot_filter_t filter,
+		bool alpha)
+{
+	int xloop;
+	int col, rem; /* source column and remainder tracker */
+	int dx, dxr; /* scale factor, integer part and remainder */
+
+	if ((width <= 0) || (height <= 0) || (rwidth <= 0))
+		return false;
+
+	scale->filter = filter;
+	scale->alpha = alpha;
+	scale->pixel = pixel;
+	scale->bmp_width = bmp_width;
+	scale->bmp_height = bmp_height;
+	scale->bmp_stride = bmp_stride;
+	scale->height = height;
+	scale->rwidth = rwidth;
+	scale->col_right = NULL;
+	scale->col_frac = NULL;
+	scale->row_top = -1;
+	scale->row_bottom = -1;
+	scale->nsfb = nsfb;
+	scale->mark = nsfb_scratch_mark(nsfb);
+
+	scale->col = nsfb_scratch_alloc(nsfb, (rwidth + 1) * sizeof(int));
+	scale->row = nsfb_scratch_alloc(nsfb, rwidth * sizeof(nsfb_colour_t));
+	if (filter == NSFB_PLOT_FILTER_BILINEAR) {
+		scale->col_right = nsfb_scratch_alloc(nsfb,
+						      rwidth * sizeof(int));
+		scale->col_frac = nsfb_scratch_alloc(nsfb,
+				rwidth * sizeof(unsigned int));
+	}
+
+	if ((scale->col == NULL) || (scale->row == NULL) ||
+	    ((filter == NSFB_PLOT_FILTER_BILINEAR) &&
+	     ((scale->col_right == NULL) || (scale->col_frac == NULL)))) {
+		nsfb_scale_fini(scale);
+		return false;
+	}
+
+	if (filter == NSFB_PLOT_FILTER_BILINEAR) {
+		for (xloop = 0; xloop < rwidth; xloop++) {
+			col = scale_bilinear_pos(xoff + xloop, width,
+						 bmp_width,
+						 &scale->col_frac[xloop]);
+			scale->col[xloop] = col;
+			scale->col_right[xloop] = col;
+			if (scale->col_frac[xloop] != 0)
+				scale->col_right[xloop]++;
+		}
+		return true;
+	}
+
+	/* column boundaries; nearest uses the left one of each pair */
+	dx = bmp_width / width;
+	dxr = bmp_width % width;
+	col = ((int64_t)xoff * bmp_width) / width;
+	rem = ((int64_t)xoff * bmp_width) % width;
+	for (xloop = 0; xloop <= rwidth; xloop++) {
+		scale->col[xloop] = col;
+		col += dx;
+		rem += dxr;
+		if (rem >= width) {
+			col++;
+			rem -= width;
+		}
+	}
+
+	return true;
+}
+
+/* exported interface documented in plot.h */
+const nsfb_colour_t *
+nsfb_scale_row(struct nsfb_scale_s *scale, int y, bool *repeat)
+{
+	const nsfb_colour_t *src;
+	const nsfb_colour_t *src_bottom;
+	nsfb_colour_t quad[4]; /* bilinear neighbours */
+	struct scale_sum sum;
+	int top, bottom;
+	int left, right;
+	unsigned int fx, fy = 0; /* bilinear weights */
+	int xloop, sy, sx;
+
+	if (scale->filter == NSFB_PLOT_FILTER_BILINEAR) {
+		top = scale_bilinear_pos(y, scale->height, scale->bmp_height,
+					 &fy);
+		bottom = fy;
+	} else {
+		top = ((int64_t)y * scale->bmp_height) / scale->height;
+		bottom = ((int64_t)(y + 1) * scale->bmp_height) /
+			scale->height;
+		if (bottom <= top)
+			bottom = top + 1;
+	}
+
+	if ((top == scale->row_top) && (bottom == scale->row_bottom)) {
+		*repeat = true;
+		return scale->row;
+	}
+	*repeat = false;
+	scale->row_top = top;
+	scale->row_bottom = bottom;
+
+	src = scale->pixel + (top * scale->bmp_stride);
+
+	switch (scale->filter) {
+	case NSFB_PLOT_FILTER_BOX:
+		for (xloop = 0; xloop < scale->rwidth; xloop++) {
+			left = scale->col[xloop];
+			right = scale->col[xloop + 1];
+			if (right <= left)
+				right = left + 1;
+
+			if ((bottom - top == 1) && (right - left == 1)) {
+				/* not reducing, nothing to average */
+				scale->row[xloop] = src[left];
+				continue;
+			}
+
+			sum.a = sum.r = sum.g = sum.b = sum.count = 0;
+			for (sy = 0; sy < bottom - top; sy++) {
+				for (sx = left; sx < right; sx++) {
+					scale_add(&sum,
+						  src[sy * scale->bmp_stride +
+						      sx],
+						  scale->alpha);
+				}
+			}
+			scale->row[xloop] = scale_resolve(&sum, scale->alpha);
+		}
+		break;
+
+	case NSFB_PLOT_FILTER_BILINEAR:
+		src_bottom = src;
+		if (fy != 0)
+			src_bottom += scale->bmp_stride;
+
+		for (xloop = 0; xloop < scale->rwidth; xloop++) {
+			left = scale->col[xloop];
+			right = scale->col_right[xloop];
+			fx = scale->col_frac[xloop];
+
+			if ((fx | fy) == 0) {
+				scale->row[xloop] = src[left];
+				continue;
+			}
+
+			quad[0] = src[left];
+			quad[1] = src[right];
+			quad[2] = src_bottom[left];
+			quad[3] = src_bottom[right];
+			scale->row[xloop] = scale_bilinear(quad, fx, fy,
+							   scale->alpha);
+		}
+		break;
+
+	default:
+		for (xloop = 0; xloop < scale->rwidth; xloop++) {
+			scale->row[xloop] = src[scale->col[xloop]];
+		}
+		break;
+	}
+
+	return scale->row;
+}
+
+/* exported interface documented in plot.h */
+void nsfb_scale_fini(struct nsfb_scale_s *scale)
+{
+	nsfb_scratch_release(scale->nsfb, scale->mark);
+
+	scale->col = NULL;
+	scale->col_right = NULL;
+	scale->col_frac = NULL;
+	scale->row = NULL;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset:8
+ * End:
+ */
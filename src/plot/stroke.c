@@ -0,0 +1,742 @@
+/*
+ * Copyright 2026 libnsfb contributors
+ *
+ * This file is part of libnsfb, http://www.netsurf-browser.org/
+ * Licenced under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/** \file
+ * Wide line stroking (implementation).
+ *
+ * A stroke is built from convex pieces: a quadrilateral for each segment,
+ * extended at the ends by square caps, and a triangle or quadrilateral for
+ * the outside of each join. The edges of every piece go into one table
+ * with a winding direction, all pieces wound the same way, and the table
+ * is scanned with the non-zero rule so the pixels covered by the union of
+ * the pieces are each filled once.
+ *
+ * Point (x, y) is the centre of pixel (x, y) and a pixel is filled when
+ * its centre is inside the stroke; like the single pixel lines, the right
+ * and bottom boundaries are not included.
+ *
+ * A patterned stroke is split into dashes, each bit of the pattern
+ * covering the stroke width along the line, and a join is only added
+ * where the pattern is on at the corner.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "libnsfb.h"
+#include "libnsfb_plot.h"
+
+#include "nsfb.h"
+#include "plot.h"
+#include "scratch.h"
+
+/** Longest miter, in half stroke widths, before a join is bevelled */
+#define STROKE_MITER_LIMIT 4
+
+/** Distance from a pattern bit boundary, in bits, treated as on it */
+#define STROKE_PHASE_EPSILON 1e-6
+
+/** Number of spans collected before plotting them */
+#define STROKE_SPAN_BATCH 64
+
+/** Greatest number of edges in one piece */
+#define STROKE_PIECE_EDGES 4
+
+/** A point of a stroke outline */
+struct stroke_point {
+	double x;
+	double y;
+};
+
+/** An edge of a stroke outline, from its top to its bottom */
+struct stroke_edge {
+	double x; /**< x at the top */
+	double y; /**< y of the top */
+	double y_end; /**< y of the bottom */
+	double slope; /**< change in x per row */
+	int row; /**< first row whose centre the edge crosses */
+	int dir; /**< winding, 1 downwards and -1 upwards */
+	double cross; /**< x crossing the current row */
+};
+
+/** Stroker state */
+struct stroke {
+	nsfb_t *nsfb;
+	double half; /**< half the stroke width */
+	bool square; /**< square caps rather than butt */
+	bool bevel; /**< bevelled joins rather than mitered */
+	uint32_t pattern; /**< stroke pattern, every bit set when solid */
+	double dash; /**< length of stroke covered by a pattern bit */
+	double phase; /**< pattern position reached, in bits */
+	struct stroke_edge *edge; /**< edge table */
+	int edgec; /**< number of edges in the table */
+};
+
+/**
+ * Length of a vector by Newton's method
+ *
+ * Starting from an overestimate the iterations decrease until they
+ * converge, which keeps the library free of libm.
+ */
+static double stroke_length(double dx, double dy)
+{
+	double v = (dx * dx) + (dy * dy);
+	double r, next;
+
+	if (v == 0)
+		return 0;
+
+	/* max + min / 2 is never less than the length */
+	dx = (dx < 0) ? -dx : dx;
+	dy = (dy < 0) ? -dy : dy;
+	r = (dx > dy) ? dx + (dy / 2) : dy + (dx / 2);
+
+	for (;;) {
+		next = (r + (v / r)) / 2;
+		if (next >= r)
+			return r;
+		r = next;
+	}
+}
+
+/** Smallest integer not below a value within the int range */
+static inline int stroke_ceil(double v)
+{
+	int i = (int)v;
+
+	return (i < v) ? i + 1 : i;
+}
+
+/** Add the edges of a convex piece to the edge table. */
+static void
+stroke_piece(struct stroke *stroke, const struct stroke_point *pt, int ptc)
+{
+	const struct stroke_point *a, *b;
+	struct stroke_edge *e;
+	double area = 0;
+	int orient;
+	int i;
+
+	/* twice the signed area gives the order the points wind in */
+	for (i = 0; i < ptc; i++) {
+		a = &pt[i];
+		b = &pt[(i + 1) % ptc];
+		area += (a->x * b->y) - (b->x * a->y);
+	}
+	if (area == 0)
+		return;
+	orient = (area > 0) ? 1 : -1;
+
+	for (i = 0; i < ptc; i++) {
+		a = &pt[i];
+		b = &pt[(i + 1) % ptc];
+		if (a->y == b->y)
+			continue;
+
+		e = &stroke->edge[stroke->edgec++];
+		if (a->y < b->y) {
+			e->dir = orient;
+		} else {
+			e->dir = -orient;
+			a = b;
+			b = &pt[i];
+		}
+		e->x = a->x;
+		e->y = a->y;
+		e->y_end = b->y;
+		e->slope = (b->x - a->x) / (b->y - a->y);
+	}
+}
+
+/** Whether a bit of a stroke's pattern is set */
+static inline bool stroke_on(const struct stroke *stroke, int bit)
+{
+	return ((stroke->pattern >> (bit & 31)) & 1) != 0;
+}
+
+/** Whether the pattern bit before a pattern position is set */
+static inline bool stroke_on_before(const struct stroke *stroke, double phase)
+{
+	int bit = (int)phase;
+
+	if (bit == phase)
+		bit--;
+
+	return stroke_on(stroke, bit);
+}
+
+/**
+ * Add the quadrilateral of a segment or a dash of one
+ *
+ * \param stroke The stroker.
+ * \param p0 The start of the quadrilateral.
+ * \param p1 The end of the quadrilateral.
+ * \param dx The direction of the segment, as long as half the width.
+ * \param dy The direction of the segment, as long as half the width.
+ * \param cap0 Whether the start is capped.
+ * \param cap1 Whether the end is capped.
+ */
+static void
+stroke_quad(struct stroke *stroke,
+	    const struct stroke_point *p0,
+	    const struct stroke_point *p1,
+	    double dx,
+	    double dy,
+	    bool cap0,
+	    bool cap1)
+{
+	struct stroke_point quad[4];
+	double nx = -dy; /* half width normal */
+	double ny = dx;
+	double ex0 = 0, ey0 = 0, ex1 = 0, ey1 = 0; /* cap extensions */
+
+	if (stroke->square) {
+		if (cap0) {
+			ex0 = dx;
+			ey0 = dy;
+		}
+		if (cap1) {
+			ex1 = dx;
+			ey1 = dy;
+		}
+	}
+
+	quad[0].x = p0->x - ex0 + nx;
+	quad[0].y = p0->y - ey0 + ny;
+	quad[1].x = p1->x + ex1 + nx;
+	quad[1].y = p1->y + ey1 + ny;
+	quad[2].x = p1->x + ex1 - nx;
+	quad[2].y = p1->y + ey1 - ny;
+	quad[3].x = p0->x - ex0 - nx;
+	quad[3].y = p0->y - ey0 - ny;
+
+	stroke_piece(stroke, quad, 4);
+}
+
+/**
+ * Add the dashes of a patterned segment
+ *
+ * Each run of set pattern bits is a dash, capped as the pen describes
+ * except where it meets a joined end of the segment. The pattern carries
+ * on from where the previous segment left it.
+ *
+ * \param stroke The stroker.
+ * \param p0 The start of the segment.
+ * \param p1 The end of the segment.
+ * \param len The length of the segment.
+ * \param dx The direction of the segment, as long as half the width.
+ * \param dy The direction of the segment, as long as half the width.
+ * \param cap0 Whether the start is capped.
+ * \param cap1 Whether the end is capped.
+ */
+static void
+stroke_dashes(struct stroke *stroke,
+	      const struct stroke_point *p0,
+	      const struct stroke_point *p1,
+	      double len,
+	      double dx,
+	      double dy,
+	      bool cap0,
+	      bool cap1)
+{
+	struct stroke_point d0, d1;
+	double t = 0; /* distance along the segment */
+	double end; /* distance at the end of the run */
+	int bit;
+	bool on;
+
+	while (t < len) {
+		/* find the end of the run of bits like the current one */
+		bit = (int)stroke->phase;
+		on = stroke_on(stroke, bit);
+		end = t + (bit + 1 - stroke->phase) * stroke->dash;
+		while ((end < len) && (stroke_on(stroke, bit + 1) == on)) {
+			bit++;
+			end += stroke->dash;
+		}
+
+		if (end < len) {
+			stroke->phase = (bit + 1) & 31;
+		} else {
+			stroke->phase += (len - t) / stroke->dash;
+
+			/* a segment ending on a bit boundary must leave the
+			 * position exactly on it for the next one */
+			bit = (int)(stroke->phase + 0.5);
+			if ((stroke->phase - bit < STROKE_PHASE_EPSILON) &&
+			    (bit - stroke->phase < STROKE_PHASE_EPSILON))
+				stroke->phase = bit;
+			while (stroke->phase >= 32)
+				stroke->phase -= 32;
+			end = len;
+		}
+
+		if (on) {
+			d0.x = p0->x + ((p1->x - p0->x) * t) / len;
+			d0.y = p0->y + ((p1->y - p0->y) * t) / len;
+			d1.x = p0->x + ((p1->x - p0->x) * end) / len;
+			d1.y = p0->y + ((p1->y - p0->y) * end) / len;
+			stroke_quad(stroke, &d0, &d1, dx, dy,
+				    cap0 || (t > 0), cap1 || (end < len));
+		}
+
+		t = end;
+	}
+}
+
+/**
+ * Most pieces a segment can add to a stroke
+ *
+ * A solid segment is one piece and a patterned one is a piece for each
+ * run of set bits it crosses, of which there are at most one for every
+ * two bits and one more for each partly crossed bit at the ends.
+ */
+static int
+stroke_segment_pieces(const nsfb_plot_pen_t *pen,
+		      const nsfb_point_t *p0,
+		      const nsfb_point_t *p1)
+{
+	double len;
+
+	if (pen->stroke_type != NFSB_PLOT_OPTYPE_PATTERN)
+		return 1;
+
+	len = stroke_length(p1->x - p0->x, p1->y - p0->y);
+
+	return (int)(len / pen->stroke_width) / 2 + 2;
+}
+
+/**
+ * Add the pieces of a segment
+ *
+ * \param stroke The stroker.
+ * \param p0 The start of the segment.
+ * \param p1 The end of the segment.
+ * \param cap0 Whether the start is capped.
+ * \param cap1 Whether the end is capped.
+ */
+static void
+stroke_segment(struct stroke *stroke,
+	       const nsfb_point_t *p0,
+	       const nsfb_point_t *p1,
+	       bool cap0,
+	       bool cap1)
+{
+	struct stroke_point a, b;
+	double dx = p1->x - p0->x;
+	double dy = p1->y - p0->y;
+	double len = stroke_length(dx, dy);
+
+	if (len == 0)
+		return;
+
+	dx = (dx * stroke->half) / len;
+	dy = (dy * stroke->half) / len;
+
+	a.x = p0->x;
+	a.y = p0->y;
+	b.x = p1->x;
+	b.y = p1->y;
+
+	if (stroke->pattern == 0xFFFFFFFF) {
+		stroke_quad(stroke, &a, &b, dx, dy, cap0, cap1);
+	} else {
+		stroke_dashes(stroke, &a, &b, len, dx, dy, cap0, cap1);
+	}
+}
+
+/**
+ * Add the piece filling the outside of a join
+ *
+ * \param stroke The stroker.
+ * \param p0 The start of the incoming segment.
+ * \param p The joining point.
+ * \param p1 The end of the outgoing segment.
+ */
+static void
+stroke_join(struct stroke *stroke,
+	    const nsfb_point_t *p0,
+	    const nsfb_point_t *p,
+	    const nsfb_point_t *p1)
+{
+	struct stroke_point piece[4];
+	double dx0 = p->x - p0->x;
+	double dy0 = p->y - p0->y;
+	double dx1 = p1->x - p->x;
+	double dy1 = p1->y - p->y;
+	double len0 = stroke_length(dx0, dy0);
+	double len1 = stroke_length(dx1, dy1);
+	double nx0, ny0, nx1, ny1; /* unit normals of the segments */
+	double cross, dot, side;
+
+	if ((len0 == 0) || (len1 == 0))
+		return;
+
+	nx0 = -dy0 / len0;
+	ny0 = dx0 / len0;
+	nx1 = -dy1 / len1;
+	ny1 = dx1 / len1;
+
+	/* the gap is on the side turned away from */
+	cross = (dx0 * dy1) - (dy0 * dx1);
+	if (cross == 0)
+		return;
+	side = (cross > 0) ? -stroke->half : stroke->half;
+
+	/* the corners are worked out exactly as the segments' are so the
+	 * pieces meet without gaps */
+	piece[0].x = p->x;
+	piece[0].y = p->y;
+	if (side > 0) {
+		piece[1].x = p->x + (-(dy0 * stroke->half) / len0);
+		piece[1].y = p->y + ((dx0 * stroke->half) / len0);
+		piece[2].x = p->x + (-(dy1 * stroke->half) / len1);
+		piece[2].y = p->y + ((dx1 * stroke->half) / len1);
+	} else {
+		piece[1].x = p->x - (-(dy0 * stroke->half) / len0);
+		piece[1].y = p->y - ((dx0 * stroke->half) / len0);
+		piece[2].x = p->x - (-(dy1 * stroke->half) / len1);
+		piece[2].y = p->y - ((dx1 * stroke->half) / len1);
+	}
+
+	/* the miter length is half width * sqrt(2 / (1 + dot)) */
+	dot = (nx0 * nx1) + (ny0 * ny1);
+	if (stroke->bevel ||
+	    ((1 + dot) * STROKE_MITER_LIMIT * STROKE_MITER_LIMIT < 2)) {
+		stroke_piece(stroke, piece, 3);
+		return;
+	}
+
+	piece[3] = piece[2];
+	piece[2].x = p->x + ((nx0 + nx1) * side) / (1 + dot);
+	piece[2].y = p->y + ((ny0 + ny1) * side) / (1 + dot);
+	stroke_piece(stroke, piece, 4);
+}
+
+static int stroke_edge_cmp(const void *a, const void *b)
+{
+	const struct stroke_edge *ea = a;
+	const struct stroke_edge *eb = b;
+
+	return ea->row - eb->row;
+}
+
+/** Scan the edge table, filling the spans of non-zero winding. */
+static bool stroke_fill(struct stroke *stroke, nsfb_colour_t c)
+{
+	nsfb_t *nsfb = stroke->nsfb;
+	struct stroke_edge **active;
+	struct stroke_edge *e;
+	nsfb_plot_span_t batch[STROKE_SPAN_BATCH];
+	int batchc = 0;
+	int activec = 0;
+	int next = 0;
+	int i, j, y;
+	int winding, start;
+	double x0 = 0, x1;
+	size_t mark;
+
+	if (stroke->edgec == 0)
+		return true;
+
+	/* rows whose centres the edges cross, clamped to the clip */
+	y = nsfb->clip.y1;
+	for (i = 0, j = 0; i < stroke->edgec; i++) {
+		e = &stroke->edge[i];
+		if ((e->y_end <= nsfb->clip.y0) || (e->y >= nsfb->clip.y1))
+			continue;
+		e->row = (e->y < nsfb->clip.y0) ?
+			nsfb->clip.y0 : stroke_ceil(e->y);
+		if (e->row < y)
+			y = e->row;
+		stroke->edge[j++] = *e;
+	}
+	stroke->edgec = j;
+	qsort(stroke->edge, stroke->edgec, sizeof(struct stroke_edge),
+	      stroke_edge_cmp);
+
+	mark = nsfb_scratch_mark(nsfb);
+	active = nsfb_scratch_alloc(nsfb, stroke->edgec *
+				    sizeof(struct stroke_edge *));
+	if (active == NULL)
+		return false;
+
+	for (; (y < nsfb->clip.y1) && ((next < stroke->edgec) ||
+					(activec > 0)); y++) {
+		/* drop the edges which end above this row */
+		for (i = 0, j = 0; i < activec; i++) {
+			if (active[i]->y_end > y)
+				active[j++] = active[i];
+		}
+		activec = j;
+
+		for (; (next < stroke->edgec) &&
+			     (stroke->edge[next].row <= y); next++) {
+			if (stroke->edge[next].y_end > y)
+				active[activec++] = &stroke->edge[next];
+		}
+
+		/* crossings in order */
+		for (i = 0; i < activec; i++) {
+			e = active[i];
+			e->cross = e->x + ((y - e->y) * e->slope);
+			for (j = i; (j > 0) &&
+				     (active[j - 1]->cross > e->cross); j--)
+				active[j] = active[j - 1];
+			active[j] = e;
+		}
+
+		/* spans of non-zero winding; crossings at the same place
+		 * are taken together so touching pieces merge */
+		winding = 0;
+		for (i = 0; i < activec; i = j) {
+			start = winding;
+			for (j = i; (j < activec) &&
+				     (active[j]->cross == active[i]->cross);
+			     j++)
+				winding += active[j]->dir;
+
+			if ((start == 0) && (winding != 0)) {
+				x0 = active[i]->cross;
+				continue;
+			}
+			if ((start == 0) || (winding != 0))
+				continue;
+
+			x1 = active[i]->cross;
+			if ((x1 <= nsfb->clip.x0) || (x0 >= nsfb->clip.x1))
+				continue;
+			if (x0 < nsfb->clip.x0)
+				x0 = nsfb->clip.x0;
+			if (x1 > nsfb->clip.x1)
+				x1 = nsfb->clip.x1;
+
+			if (batchc == STROKE_SPAN_BATCH) {
+				nsfb->plotter_fns->spans(nsfb, batchc, batch,
+							 c);
+				batchc = 0;
+			}
+			batch[batchc].y = y;
+			batch[batchc].x0 = stroke_ceil(x0);
+			batch[batchc].x1 = stroke_ceil(x1);
+			if (batch[batchc].x0 < batch[batchc].x1)
+				batchc++;
+		}
+	}
+
+	if (batchc > 0)
+		nsfb->plotter_fns->spans(nsfb, batchc, batch, c);
+
+	nsfb_scratch_release(nsfb, mark);
+
+	return true;
+}
+
+/** Set up a stroker with room for a number of pieces. */
+static bool
+stroke_init(struct stroke *stroke, nsfb_t *nsfb,
+	    const nsfb_plot_pen_t *pen,
+	    nsfb_plot_cap_t cap,
+	    nsfb_plot_join_t join,
+	    int piecec)
+{
+	stroke->nsfb = nsfb;
+	stroke->half = pen->stroke_width / 2.0;
+	stroke->square = (cap == NSFB_PLOT_CAP_SQUARE);
+	stroke->bevel = (join == NSFB_PLOT_JOIN_BEVEL);
+	if (pen->stroke_type == NFSB_PLOT_OPTYPE_PATTERN)
+		stroke->pattern = pen->stroke_pattern;
+	else
+		stroke->pattern = 0xFFFFFFFF;
+	stroke->dash = pen->stroke_width;
+	stroke->phase = 0;
+	stroke->edgec = 0;
+	stroke->edge = nsfb_scratch_alloc(nsfb, piecec * STROKE_PIECE_EDGES *
+					  sizeof(struct stroke_edge));
+
+	return (stroke->edge != NULL);
+}
+
+/* exported interface documented in plot.h */
+bool
+nsfb_stroke_lines(nsfb_t *nsfb,
+		  int linec,
+		  const nsfb_bbox_t *line,
+		  const nsfb_plot_pen_t *pen)
+{
+	struct stroke stroke;
+	size_t mark;
+	bool ret;
+	int piecec = 0;
+	int i;
+
+	for (i = 0; i < linec; i++) {
+		piecec += stroke_segment_pieces(pen,
+				(const nsfb_point_t *)&line[i].x0,
+				(const nsfb_point_t *)&line[i].x1);
+	}
+
+	mark = nsfb_scratch_mark(nsfb);
+	if (!stroke_init(&stroke, nsfb, pen, nsfb->stroke_cap,
+			 NSFB_PLOT_JOIN_MITER, piecec))
+		return false;
+
+	/* a pattern carries on from one line into the next */
+	for (i = 0; i < linec; i++) {
+		stroke_segment(&stroke, (const nsfb_point_t *)&line[i].x0,
+			       (const nsfb_point_t *)&line[i].x1, true, true);
+	}
+
+	ret = stroke_fill(&stroke, pen->stroke_colour);
+
+	nsfb_scratch_release(nsfb, mark);
+
+	return ret;
+}
+
+/** Stroke a polyline with the given caps and joins. */
+static bool
+stroke_polyline(nsfb_t *nsfb,
+		int pointc,
+		const nsfb_point_t *points,
+		bool closed,
+		const nsfb_plot_pen_t *pen,
+		nsfb_plot_cap_t cap,
+		nsfb_plot_join_t join)
+{
+	struct stroke stroke;
+	const nsfb_point_t *prev;
+	bool *on = NULL; /* whether the pattern is on both sides of each point */
+	size_t mark;
+	bool ret;
+	int piecec;
+	int segc;
+	int i;
+
+	if (pointc < 2)
+		return true;
+
+	/* every segment and every join is a piece, or more for dashes */
+	segc = closed ? pointc : pointc - 1;
+	piecec = segc;
+	for (i = 0; i < segc; i++) {
+		piecec += stroke_segment_pieces(pen, &points[i],
+						&points[(i + 1) % pointc]);
+	}
+
+	mark = nsfb_scratch_mark(nsfb);
+	if (!stroke_init(&stroke, nsfb, pen, cap, join, piecec))
+		return false;
+
+	if (stroke.pattern != 0xFFFFFFFF) {
+		on = nsfb_scratch_alloc(nsfb, pointc * sizeof(bool));
+		if (on == NULL) {
+			nsfb_scratch_release(nsfb, mark);
+			return false;
+		}
+		on[pointc - 1] = false;
+	}
+
+	for (i = 0; i < segc; i++) {
+		if (on != NULL) {
+			on[i] = stroke_on_before(&stroke, stroke.phase) &&
+				stroke_on(&stroke, (int)stroke.phase);
+		}
+		stroke_segment(&stroke, &points[i],
+			       &points[(i + 1) % pointc],
+			       !closed && (i == 0),
+			       !closed && (i == segc - 1));
+	}
+
+	/* the side into the first point of a closed polyline is the end of
+	 * the last segment */
+	if ((on != NULL) && closed) {
+		on[0] = stroke_on_before(&stroke, stroke.phase) &&
+			stroke_on(&stroke, 0);
+	}
+
+	/* joins between segments, skipping repeated points */
+	prev = closed ? &points[pointc - 1] : NULL;
+	for (i = 0; i < pointc; i++) {
+		if ((prev != NULL) && (prev->x == points[i].x) &&
+		    (prev->y == points[i].y))
+			continue;
+		if ((prev != NULL) && (closed || (i < pointc - 1))) {
+			const nsfb_point_t *p1 = NULL;
+			int k;
+
+			for (k = 1; k < pointc; k++) {
+				const nsfb_point_t *n;
+
+				if (!closed && (i + k >= pointc))
+					break;
+				n = &points[(i + k) % pointc];
+				if ((n->x != points[i].x) ||
+				    (n->y != points[i].y)) {
+					p1 = n;
+					break;
+				}
+			}
+			if ((p1 != NULL) && ((on == NULL) || on[i]))
+				stroke_join(&stroke, prev, &points[i], p1);
+		}
+		prev = &points[i];
+	}
+
+	ret = stroke_fill(&stroke, pen->stroke_colour);
+
+	nsfb_scratch_release(nsfb, mark);
+
+	return ret;
+}
+
+/* exported interface documented in plot.h */
+bool
+nsfb_stroke_polyline(nsfb_t *nsfb,
+		     int pointc,
+		     const nsfb_point_t *points,
+		     bool closed,
+		     const nsfb_plot_pen_t *pen)
+{
+	return stroke_polyline(nsfb, pointc, points, closed, pen,
+			       nsfb->stroke_cap, nsfb->stroke_join);
+}
+
+/* exported interface documented in plot.h */
+bool
+nsfb_stroke_rectangle(nsfb_t *nsfb,
+		      const nsfb_bbox_t *rect,
+		      int line_width,
+		      nsfb_colour_t c,
+		      uint32_t pattern)
+{
+	nsfb_point_t corner[4];
+	nsfb_plot_pen_t pen;
+
+	if (pattern == 0xFFFFFFFF)
+		pen.stroke_type = NFSB_PLOT_OPTYPE_SOLID;
+	else
+		pen.stroke_type = NFSB_PLOT_OPTYPE_PATTERN;
+	pen.stroke_pattern = pattern;
+	pen.stroke_width = line_width;
+	pen.stroke_colour = c;
+
+	corner[0].x = corner[3].x = rect->x0;
+	corner[1].x = corner[2].x = rect->x1;
+	corner[0].y = corner[1].y = rect->y0;
+	corner[2].y = corner[3].y = rect->y1;
+
+	return stroke_polyline(nsfb, 4, corner, true, &pen,
+			       NSFB_PLOT_CAP_BUTT, NSFB_PLOT_JOIN_MITER);
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset:8
+ * End:
+ */
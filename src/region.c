@@ -0,0 +1,268 @@
+/*
+ * Copyright 2026 libnsfb contributors
+ *
+ * This file is part of libnsfb, http://www.netsurf-browser.org/
+ * Licenced under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/** \file
+ * Update regions (implementation).
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "libnsfb.h"
+
+#include "region.h"
+
+/** Rectangles needed to build a region from one of rectc rectangles */
+#define REGION_BUILD_SIZE(rectc) (6 * (rectc) + 6)
+
+/** Make sure an array of rectangles can hold a number of them. */
+static bool region_reserve(nsfb_bbox_t **rect, int *size, int count)
+{
+	nsfb_bbox_t *mem;
+
+	if (*size >= count)
+		return true;
+
+	if (count < 16)
+		count = 16;
+	mem = realloc(*rect, count * sizeof(nsfb_bbox_t));
+	if (mem == NULL)
+		return false;
+
+	*rect = mem;
+	*size = count;
+
+	return true;
+}
+
+/** Replace a region's rectangles with its bounding box. */
+static void region_bound(struct nsfb_region_s *region)
+{
+	region->rect[0] = region->extents;
+	region->rectc = 1;
+	region->bounded = true;
+}
+
+/**
+ * Append a band to a region being built
+ *
+ * The band is joined to the band above when that touches it and has the
+ * same columns.
+ *
+ * \param out The rectangles being built.
+ * \param outc The number of rectangles built, updated.
+ * \param prev The index of the first rectangle of the last band, updated.
+ * \param span The columns of the band, as x0 and x1 of each rectangle.
+ * \param spanc The number of columns.
+ * \param y0 The top of the band.
+ * \param y1 The bottom of the band.
+ */
+static void
+region_band(nsfb_bbox_t *out,
+	    int *outc,
+	    int *prev,
+	    const nsfb_bbox_t *span,
+	    int spanc,
+	    int y0,
+	    int y1)
+{
+	int loop;
+
+	if ((*prev >= 0) &&
+	    (*outc - *prev == spanc) &&
+	    (out[*prev].y1 == y0)) {
+		for (loop = 0; loop < spanc; loop++) {
+			if ((out[*prev + loop].x0 != span[loop].x0) ||
+			    (out[*prev + loop].x1 != span[loop].x1))
+				break;
+		}
+		if (loop == spanc) {
+			for (loop = *prev; loop < *outc; loop++)
+				out[loop].y1 = y1;
+			return;
+		}
+	}
+
+	*prev = *outc;
+	for (loop = 0; loop < spanc; loop++) {
+		out[*outc].x0 = span[loop].x0;
+		out[*outc].y0 = y0;
+		out[*outc].x1 = span[loop].x1;
+		out[*outc].y1 = y1;
+		(*outc)++;
+	}
+}
+
+/** Add a column to those of a band, in order of left edges. */
+static inline void
+region_span(nsfb_bbox_t *span, int *spanc, const nsfb_bbox_t *col)
+{
+	if ((*spanc > 0) && (col->x0 <= span[*spanc - 1].x1)) {
+		if (col->x1 > span[*spanc - 1].x1)
+			span[*spanc - 1].x1 = col->x1;
+	} else {
+		span[(*spanc)++] = *col;
+	}
+}
+
+/* exported interface documented in region.h */
+bool nsfb_region_add(struct nsfb_region_s *region, const nsfb_bbox_t *box)
+{
+	const nsfb_bbox_t *rect = region->rect;
+	nsfb_bbox_t *out;
+	nsfb_bbox_t *span;
+	int outc = 0;
+	int prev = -1;
+	int bs = 0; /* first rectangle of the current band */
+	int be; /* rectangle after the current band */
+	int spanc;
+	bool inbox;
+	int loop;
+	int y, ybot;
+
+	if ((box->x0 >= box->x1) || (box->y0 >= box->y1))
+		return true;
+
+	if (region->rectc == 0) {
+		if (!region_reserve(&region->rect, &region->rect_size, 1))
+			return false;
+		region->rect[0] = *box;
+		region->rectc = 1;
+		region->extents = *box;
+		return true;
+	}
+
+	/* Nothing to do if a rectangle already holds the box */
+	for (loop = 0; loop < region->rectc; loop++) {
+		if ((rect[loop].y0 > box->y0))
+			break;
+		if ((rect[loop].x0 <= box->x0) && (rect[loop].x1 >= box->x1) &&
+		    (rect[loop].y1 >= box->y1))
+			return true;
+	}
+
+	if (box->x0 < region->extents.x0)
+		region->extents.x0 = box->x0;
+	if (box->y0 < region->extents.y0)
+		region->extents.y0 = box->y0;
+	if (box->x1 > region->extents.x1)
+		region->extents.x1 = box->x1;
+	if (box->y1 > region->extents.y1)
+		region->extents.y1 = box->y1;
+
+	if (region->bounded) {
+		region->rect[0] = region->extents;
+		return true;
+	}
+
+	/* The box can split two bands and add a column to every band, and
+	 * fill the gaps between bands. The columns of a band are built at
+	 * the end of the same array. */
+	if (!region_reserve(&region->tmp, &region->tmp_size,
+			    REGION_BUILD_SIZE(region->rectc))) {
+		region_bound(region);
+		return true;
+	}
+	out = region->tmp;
+	span = out + 5 * region->rectc + 4;
+
+	y = (rect[0].y0 < box->y0) ? rect[0].y0 : box->y0;
+	while (y < region->extents.y1) {
+		/* Find the band at or below y */
+		while ((bs < region->rectc) && (rect[bs].y1 <= y))
+			bs++;
+		for (be = bs; (be < region->rectc) &&
+			     (rect[be].y0 == rect[bs].y0); be++)
+			;
+
+		/* Find where the band or box next starts or ends */
+		ybot = region->extents.y1;
+		if (bs < region->rectc) {
+			if (rect[bs].y0 > y) {
+				if (rect[bs].y0 < ybot)
+					ybot = rect[bs].y0;
+			} else if (rect[bs].y1 < ybot) {
+				ybot = rect[bs].y1;
+			}
+		}
+		if ((box->y0 > y) && (box->y0 < ybot))
+			ybot = box->y0;
+		if ((box->y1 > y) && (box->y1 < ybot))
+			ybot = box->y1;
+
+		/* Merge the columns of the band and box covering y, in
+		 * order of their left edges */
+		spanc = 0;
+		inbox = (box->y0 <= y) && (box->y1 > y);
+		if ((bs < region->rectc) && (rect[bs].y0 <= y)) {
+			for (loop = bs; loop < be; loop++) {
+				if (inbox && (box->x0 <= rect[loop].x0)) {
+					region_span(span, &spanc, box);
+					inbox = false;
+				}
+				region_span(span, &spanc, &rect[loop]);
+			}
+		}
+		if (inbox)
+			region_span(span, &spanc, box);
+
+		if (spanc > 0)
+			region_band(out, &outc, &prev, span, spanc, y, ybot);
+
+		y = ybot;
+	}
+
+	region->tmp = region->rect;
+	loop = region->tmp_size;
+	region->tmp_size = region->rect_size;
+	region->rect = out;
+	region->rect_size = loop;
+	region->rectc = outc;
+
+	if (region->rectc > NSFB_REGION_RECTS_MAX)
+		region_bound(region);
+
+	return true;
+}
+
+/* exported interface documented in region.h */
+bool nsfb_region_reserve(struct nsfb_region_s *region)
+{
+	/* the two arrays swap as the region is built, so both need room
+	 * for building from the largest region */
+	return (region_reserve(&region->rect, &region->rect_size,
+			       REGION_BUILD_SIZE(NSFB_REGION_RECTS_MAX)) &&
+		region_reserve(&region->tmp, &region->tmp_size,
+			       REGION_BUILD_SIZE(NSFB_REGION_RECTS_MAX)));
+}
+
+/* exported interface documented in region.h */
+void nsfb_region_clear(struct nsfb_region_s *region)
+{
+	region->rectc = 0;
+	region->bounded = false;
+}
+
+/* exported interface documented in region.h */
+void nsfb_region_fini(struct nsfb_region_s *region)
+{
+	free(region->rect);
+	free(region->tmp);
+
+	region->rect = NULL;
+	region->rectc = region->rect_size = 0;
+	region->tmp = NULL;
+	region->tmp_size = 0;
+	region->bounded = false;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset:8
+ * End:
+ */
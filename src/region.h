@@ -0,0 +1,65 @@
+/*
+ * Copyright 2026 libnsfb contributors
+ *
+ * This file is part of libnsfb, http://www.netsurf-browser.org/
+ * Licenced under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ *
+ * This is the *internal* interface for update regions.
+ */
+
+#ifndef REGION_H
+#define REGION_H 1
+
+#include <stdbool.h>
+
+#include "libnsfb.h"
+
+/** Most rectangles a region holds before it becomes its bounding box */
+#define NSFB_REGION_RECTS_MAX 64
+
+/** An area made of rectangles in horizontal bands.
+ *
+ * The rectangles are sorted by y0 then x0. Those in one band share y0 and
+ * y1 and neither overlap nor touch, and touching bands with the same
+ * columns are joined, so every area has one representation. The storage
+ * is kept when the region is cleared.
+ */
+struct nsfb_region_s {
+	nsfb_bbox_t *rect; /**< Rectangles of the region */
+	int rectc; /**< Number of rectangles */
+	int rect_size; /**< Number of rectangles allocated */
+
+	nsfb_bbox_t *tmp; /**< Rectangles of a region being built */
+	int tmp_size; /**< Number of building rectangles allocated */
+
+	nsfb_bbox_t extents; /**< Bounding box of the rectangles */
+	bool bounded; /**< Region grew too complex and is its bounding box */
+};
+
+/** Add a rectangle to a region.
+ *
+ * \param region The region.
+ * \param box The rectangle, which is ignored if empty.
+ * \return true on success or false if the storage could not be allocated.
+ */
+bool nsfb_region_add(struct nsfb_region_s *region, const nsfb_bbox_t *box);
+
+/** Allocate all the storage a region can need.
+ *
+ * Adding to a region holds at most ::NSFB_REGION_RECTS_MAX rectangles
+ * before building the next, so once this succeeds adding to the region
+ * cannot fail until it is finalised.
+ *
+ * \param region The region.
+ * \return true on success or false if the storage could not be allocated.
+ */
+bool nsfb_region_reserve(struct nsfb_region_s *region);
+
+/** Empty a region. */
+void nsfb_region_clear(struct nsfb_region_s *region);
+
+/** Free the storage of a region. */
+void nsfb_region_fini(struct nsfb_region_s *region);
+
+#endif
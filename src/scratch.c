@@ -0,0 +1,188 @@
+/*
+ * Copyright 2026 libnsfb contributors
+ *
+ * This file is part of libnsfb, http://www.netsurf-browser.org/
+ * Licenced under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/** \file
+ * Scratch arena (implementation).
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "libnsfb.h"
+#include "libnsfb_plot.h"
+
+#include "nsfb.h"
+#include "scratch.h"
+
+/** Smallest block allocated when the arena grows */
+#define SCRATCH_BLOCK_MIN 4096
+
+/** Largest single allocation, far below where the size sums could wrap;
+ * anything bigger is a negative size converted by a caller. */
+#define SCRATCH_SIZE_MAX (SIZE_MAX / 4)
+
+static inline size_t scratch_align(size_t size)
+{
+	return (size + NSFB_SCRATCH_ALIGN - 1) &
+			~(size_t)(NSFB_SCRATCH_ALIGN - 1);
+}
+
+/** Chain a new block starting at an arena offset. */
+static bool
+scratch_grow(struct nsfb_scratch_s *scratch, size_t start, size_t size)
+{
+	struct nsfb_scratch_block_s *block;
+	uintptr_t data;
+
+	if (size > SIZE_MAX - sizeof(struct nsfb_scratch_block_s) -
+			NSFB_SCRATCH_ALIGN) {
+		return false;
+	}
+
+	block = malloc(sizeof(struct nsfb_scratch_block_s) + size +
+			NSFB_SCRATCH_ALIGN);
+	if (block == NULL) {
+		return false;
+	}
+
+	data = (uintptr_t)(block + 1);
+	data = (data + NSFB_SCRATCH_ALIGN - 1) &
+			~(uintptr_t)(NSFB_SCRATCH_ALIGN - 1);
+
+	block->prev = scratch->block;
+	block->start = start;
+	block->size = size;
+	block->data = (unsigned char *)data;
+	scratch->block = block;
+
+	return true;
+}
+
+/** Free every block starting at or after an arena offset. */
+static void scratch_pop(struct nsfb_scratch_s *scratch, size_t offset)
+{
+	struct nsfb_scratch_block_s *block;
+
+	while ((scratch->block != NULL) &&
+			(scratch->block->start >= offset) &&
+			(scratch->block->prev != NULL)) {
+		block = scratch->block;
+		scratch->block = block->prev;
+		free(block);
+	}
+}
+
+/* exported interface documented in scratch.h */
+void *nsfb_scratch_alloc(nsfb_t *nsfb, size_t size)
+{
+	struct nsfb_scratch_s *scratch = &nsfb->scratch;
+	struct nsfb_scratch_block_s *block = scratch->block;
+	size_t start;
+	void *ptr;
+
+	if (size > SCRATCH_SIZE_MAX) {
+		return NULL;
+	}
+
+	size = scratch_align(size);
+
+	if ((block == NULL) ||
+			(scratch->used + size > block->start + block->size)) {
+		/* The rest of the current block is skipped; the arena
+		 * offset moves on to the start of the new block. */
+		start = (block != NULL) ? block->start + block->size : 0;
+		if (scratch_grow(scratch, start, (size > SCRATCH_BLOCK_MIN) ?
+				size : SCRATCH_BLOCK_MIN) == false) {
+			return NULL;
+		}
+		block = scratch->block;
+		scratch->used = start;
+	}
+
+	ptr = block->data + (scratch->used - block->start);
+	scratch->used += size;
+	if (scratch->used > scratch->peak) {
+		scratch->peak = scratch->used;
+	}
+
+	return ptr;
+}
+
+/* exported interface documented in scratch.h */
+size_t nsfb_scratch_mark(nsfb_t *nsfb)
+{
+	return nsfb->scratch.used;
+}
+
+/* exported interface documented in scratch.h */
+void nsfb_scratch_release(nsfb_t *nsfb, size_t mark)
+{
+	struct nsfb_scratch_s *scratch = &nsfb->scratch;
+
+	scratch_pop(scratch, mark);
+	scratch->used = mark;
+
+	if ((mark == 0) && (scratch->block != NULL) &&
+			(scratch->peak > scratch->block->size)) {
+		/* Empty and outgrown; replace the blocks with one that
+		 * holds everything used, keeping the old on failure. */
+		nsfb_scratch_reserve(scratch, scratch->peak);
+	}
+}
+
+/* exported interface documented in scratch.h */
+bool nsfb_scratch_reserve(struct nsfb_scratch_s *scratch, size_t size)
+{
+	struct nsfb_scratch_block_s *old = scratch->block;
+
+	if (scratch->used != 0) {
+		/* Storage is in use and can not be moved */
+		return false;
+	}
+
+	if (size > SCRATCH_SIZE_MAX) {
+		return false;
+	}
+
+	size = scratch_align(size);
+	if ((old != NULL) && (old->prev == NULL) && (old->size >= size)) {
+		return true;
+	}
+
+	scratch->block = NULL;
+	if (scratch_grow(scratch, 0, size) == false) {
+		scratch->block = old;
+		return false;
+	}
+
+	scratch->block->prev = NULL;
+	scratch->peak = 0;
+	while (old != NULL) {
+		struct nsfb_scratch_block_s *prev = old->prev;
+		free(old);
+		old = prev;
+	}
+
+	return true;
+}
+
+/* exported interface documented in scratch.h */
+void nsfb_scratch_fini(struct nsfb_scratch_s *scratch)
+{
+	struct nsfb_scratch_block_s *block;
+
+	while (scratch->block != NULL) {
+		block = scratch->block;
+		scratch->block = block->prev;
+		free(block);
+	}
+
+	scratch->used = 0;
+	scratch->peak = 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2026 libnsfb contributors
+ *
+ * This file is part of libnsfb, http://www.netsurf-browser.org/
+ * Licenced under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ *
+ * This is the *internal* interface for the scratch arena.
+ */
+
+#ifndef SCRATCH_H
+#define SCRATCH_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "libnsfb.h"
+
+/** Alignment of every scratch allocation */
+#define NSFB_SCRATCH_ALIGN 16
+
+/** A block of scratch memory. */
+struct nsfb_scratch_block_s {
+	struct nsfb_scratch_block_s *prev; /**< Block before this one */
+	size_t start; /**< Arena offset of the first byte of this block */
+	size_t size; /**< Usable size of this block */
+	unsigned char *data; /**< Aligned start of the block's memory */
+};
+
+/** Scratch arena for the temporary storage of plotters.
+ *
+ * Allocations are bumped from the current block and released in stack
+ * order back to a mark. When a block is full another is chained on; once
+ * the arena is empty again the blocks are replaced by a single block as
+ * large as the most that was used so later plots need no allocations.
+ */
+struct nsfb_scratch_s {
+	struct nsfb_scratch_block_s *block; /**< Current block or NULL */
+	size_t used; /**< Arena offset of the next allocation */
+	size_t peak; /**< Most used since the blocks were last merged */
+};
+
+/** Allocate temporary storage from a context's scratch arena.
+ *
+ * The storage remains valid until the arena is released to a mark taken
+ * before it was allocated.
+ *
+ * \param nsfb The context.
+ * \param size The number of bytes required.
+ * \return Storage aligned to NSFB_SCRATCH_ALIGN or NULL on failure.
+ */
+void *nsfb_scratch_alloc(nsfb_t *nsfb, size_t size);
+
+/** Mark the current position of a context's scratch arena. */
+size_t nsfb_scratch_mark(nsfb_t *nsfb);
+
+/** Release every scratch allocation made since a mark was taken. */
+void nsfb_scratch_release(nsfb_t *nsfb, size_t mark);
+
+/** Ensure the scratch arena can hold a number of bytes without growing.
+ *
+ * \return true on success or false if the storage could not be allocated.
+ */
+bool nsfb_scratch_reserve(struct nsfb_scratch_s *scratch, size_t size);
+
+/** Free the storage of a scratch arena. */
+void nsfb_scratch_fini(struct nsfb_scratch_s *scratch);
+
+#endif
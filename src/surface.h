@@ -28,6 +28,9 @@ typedef int (nsfb_surfacefn_claim_t)(nsfb_t *nsfb, nsfb_bbox_t *box);
 /* surface area update */
 typedef int (nsfb_surfacefn_update_t)(nsfb_t *nsfb, nsfb_bbox_t *box);
 
+/* surface update of several areas at once */
+typedef int (nsfb_surfacefn_update_rects_t)(nsfb_t *nsfb, nsfb_bbox_t *box, int boxc);
+
 /* surface cursor display */
 typedef int (nsfb_surfacefn_cursor_t)(nsfb_t *nsfb, struct nsfb_cursor_s *cursor);
 
@@ -40,6 +43,7 @@ typedef struct nsfb_surface_rtns_s {
     nsfb_surfacefn_input_t *input;
     nsfb_surfacefn_claim_t *claim;
     nsfb_surfacefn_update_t *update;
+    nsfb_surfacefn_update_rects_t *update_rects;
     nsfb_surfacefn_cursor_t *cursor;
 } nsfb_surface_rtns_t;
 
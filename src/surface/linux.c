@@ -34,6 +34,7 @@
 #include "plot.h"
 #include "surface.h"
 #include "cursor.h"
+#include "palette.h"
 #define UNUSED(x) ((x) = (x))
 #define FB_NAME     "/dev/fb0"
 #define INPUT_NAME  "/dev/input/event0"
@@ -335,6 +336,40 @@ format_from_lstate(struct lnx_priv *lstate)
 
     return fmt;
 }
+/* use the colour map of an 8bpp display as the palette */
+static bool linux_set_palette(nsfb_t *nsfb, struct lnx_priv *lstate)
+{
+    __u16 red[256], green[256], blue[256];
+    nsfb_colour_t colours[256];
+    struct fb_cmap cmap;
+    unsigned int loop;
+
+    cmap.start = 0;
+    cmap.len = 256;
+    cmap.red = red;
+    cmap.green = green;
+    cmap.blue = blue;
+    cmap.transp = NULL;
+
+    if (ioctl(lstate->fd, FBIOGETCMAP, &cmap) < 0) {
+        printf("Unable to retrieve colour map: %s\n", strerror(errno));
+        return false;
+    }
+
+    for (loop = 0; loop < cmap.len; loop++) {
+        colours[loop] = (red[loop] >> 8) |
+                ((green[loop] >> 8) << 8) |
+                ((blue[loop] >> 8) << 16);
+    }
+
+    if (nsfb->palette == NULL &&
+            nsfb_palette_new(&nsfb->palette, nsfb->width) == false) {
+        return false;
+    }
+
+    return nsfb_palette_set(nsfb->palette, colours, cmap.len);
+}
+
 static int linux_initialise(nsfb_t *nsfb)
 {
     int iFrameBufferSize;
@@ -395,6 +430,9 @@ static int linux_initialise(nsfb_t *nsfb)
        return -1;
    }
     }
+    if (nsfb->bpp == 8) {
+        linux_set_palette(nsfb, lstate);
+    }
     /* Open the input devices */
     lstate->fd_input = open(INPUT_NAME, O_RDONLY | O_NONBLOCK);
     if (lstate->fd_input < 0) {
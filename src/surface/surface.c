@@ -70,6 +70,21 @@ static int surface_update(nsfb_t *nsfb, nsfb_bbox_t *box)
     return 0;
 }
 
+/* update each area in turn for surfaces which can't batch them */
+static int surface_update_rects(nsfb_t *nsfb, nsfb_bbox_t *box, int boxc)
+{
+    int ret = 0;
+    int loop;
+
+    for (loop = 0; loop < boxc; loop++) {
+        if (nsfb->surface_rtns->update(nsfb, &box[loop]) != 0) {
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
 static int surface_cursor(nsfb_t *nsfb, struct nsfb_cursor_s *cursor)
 {
     UNUSED(nsfb);
@@ -124,6 +139,10 @@ nsfb_surface_get_rtns(enum nsfb_type_e type)
 		rtns->update = surface_update;
 	    }
 
+	    if (rtns->update_rects == NULL) {
+		rtns->update_rects = surface_update_rects;
+	    }
+
 	    if (rtns->cursor == NULL) {
 		rtns->cursor = surface_cursor;
 	    }
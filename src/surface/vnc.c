@@ -6,8 +6,11 @@
  *                http://www.opensource.org/licenses/mit-license.php
  */
 
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 
 #include <rfb/rfb.h>
 #include <rfb/keysym.h>
@@ -15,6 +18,7 @@
 #include "libnsfb.h"
 #include "libnsfb_event.h"
 #include "libnsfb_plot.h"
+#include "libnsfb_plot_util.h"
 
 #include "nsfb.h"
 #include "surface.h"
@@ -23,7 +27,36 @@
 
 #define UNUSED(x) ((x) = (x))
 
-static nsfb_event_t *gevent;
+/* width and height of the tiles updates are compared in */
+#define VNC_TILE_SIZE 16
+
+/* number of input events queued for vnc_input */
+#define VNC_EVENT_RING 64
+
+/* microseconds the server thread waits for client messages */
+#define VNC_SERVER_USEC 10000
+
+typedef struct vncstate_s {
+    rfbScreenInfoPtr vncscreen; /* vnc server screen */
+    uint8_t *fb; /* frame buffer plotted to */
+    uint8_t *shadow; /* copy of the frame buffer as last marked modified,
+		      * which clients are served from */
+
+    bool threaded; /* the server runs on its own thread */
+    pthread_t thread; /* the server thread */
+    pthread_mutex_t lock; /* protects the shadow copy and everything
+			   * handed to the server thread below */
+    bool quit; /* the server thread should exit */
+    struct nsfb_region_s modified; /* areas of the shadow to mark modified */
+    rfbCursorPtr cursor; /* cursor to set or NULL */
+
+    pthread_mutex_t event_lock; /* protects the event ring */
+    pthread_cond_t event_cond; /* signalled when an event is queued */
+    nsfb_event_t event[VNC_EVENT_RING]; /* ring of queued input events */
+    unsigned int event_head; /* index of the oldest queued event */
+    unsigned int event_count; /* number of queued events */
+    int button_mask; /* buttons held at the last pointer event */
+} vncstate_t;
 
 /* vnc special set codes */
 static enum nsfb_key_code_e vnc_nsfb_map[256] = {
@@ -286,67 +319,96 @@ static enum nsfb_key_code_e vnc_nsfb_map[256] = {
 };
 
 
-static void vnc_doptr(int buttonMask,int x,int y,rfbClientPtr cl)
+/* queue an input event for vnc_input, a pointer move replaces one queued
+ * just before it and events are dropped if the ring is full.
+ */
+static void vnc_queue_event(vncstate_t *vncstate, const nsfb_event_t *event)
 {
-    static int prevbuttonMask = 0;
+    nsfb_event_t *last;
+
+    pthread_mutex_lock(&vncstate->event_lock);
+
+    if (vncstate->event_count > 0) {
+	last = &vncstate->event[(vncstate->event_head +
+				 vncstate->event_count - 1) % VNC_EVENT_RING];
+	if ((event->type == NSFB_EVENT_MOVE_ABSOLUTE) &&
+	    (last->type == NSFB_EVENT_MOVE_ABSOLUTE)) {
+	    *last = *event;
+	    pthread_mutex_unlock(&vncstate->event_lock);
+	    return;
+	}
+    }
 
-    UNUSED(cl);
+    if (vncstate->event_count < VNC_EVENT_RING) {
+	vncstate->event[(vncstate->event_head +
+			 vncstate->event_count) % VNC_EVENT_RING] = *event;
+	vncstate->event_count++;
+	pthread_cond_signal(&vncstate->event_cond);
+    }
 
-    if (prevbuttonMask != buttonMask) {
-	/* button click */
-	if (((prevbuttonMask ^ buttonMask) & 0x01) == 0x01) {
-	    if ((buttonMask & 0x01) == 0x01) {
-		gevent->type = NSFB_EVENT_KEY_DOWN;
-	    } else {
-		gevent->type = NSFB_EVENT_KEY_UP;
-	    }
-	    gevent->value.keycode = NSFB_KEY_MOUSE_1;
-	} else if (((prevbuttonMask ^ buttonMask) & 0x02) == 0x02) {
-	    if ((buttonMask & 0x01) == 0x01) {
-		gevent->type = NSFB_EVENT_KEY_DOWN;
-	    } else {
-		gevent->type = NSFB_EVENT_KEY_UP;
-	    }
-	    gevent->value.keycode = NSFB_KEY_MOUSE_2;
-	} else if (((prevbuttonMask ^ buttonMask) & 0x04) == 0x04) {
-	    if ((buttonMask & 0x01) == 0x01) {
-		gevent->type = NSFB_EVENT_KEY_DOWN;
-	    } else {
-		gevent->type = NSFB_EVENT_KEY_UP;
-	    }
-	    gevent->value.keycode = NSFB_KEY_MOUSE_3;
-	} else if (((prevbuttonMask ^ buttonMask) & 0x08) == 0x08) {
-	    if ((buttonMask & 0x01) == 0x01) {
-		gevent->type = NSFB_EVENT_KEY_DOWN;
-	    } else {
-		gevent->type = NSFB_EVENT_KEY_UP;
+    pthread_mutex_unlock(&vncstate->event_lock);
+}
+
+/* take the oldest queued input event, the event lock must be held */
+static bool vnc_next_event(vncstate_t *vncstate, nsfb_event_t *event)
+{
+    if (vncstate->event_count == 0) {
+	return false;
+    }
+
+    *event = vncstate->event[vncstate->event_head];
+    vncstate->event_head = (vncstate->event_head + 1) % VNC_EVENT_RING;
+    vncstate->event_count--;
+
+    return true;
+}
+
+static void vnc_doptr(int buttonMask,int x,int y,rfbClientPtr cl)
+{
+    static const enum nsfb_key_code_e button[] = {
+	NSFB_KEY_MOUSE_1,
+	NSFB_KEY_MOUSE_2,
+	NSFB_KEY_MOUSE_3,
+	NSFB_KEY_MOUSE_4,
+	NSFB_KEY_MOUSE_5,
+    };
+    vncstate_t *vncstate = cl->screen->screenData;
+    nsfb_event_t event;
+    int changed;
+    unsigned int loop;
+
+    changed = (vncstate->button_mask ^ buttonMask) & 0x1f;
+    if (changed != 0) {
+	/* button clicks */
+	for (loop = 0; loop < sizeof(button) / sizeof(button[0]); loop++) {
+	    if ((changed & (1 << loop)) == 0) {
+		continue;
 	    }
-	    gevent->value.keycode = NSFB_KEY_MOUSE_4;
-	} else if (((prevbuttonMask ^ buttonMask) & 0x10) == 0x10) {
-	    if ((buttonMask & 0x01) == 0x01) {
-		gevent->type = NSFB_EVENT_KEY_DOWN;
+	    if ((buttonMask & (1 << loop)) != 0) {
+		event.type = NSFB_EVENT_KEY_DOWN;
 	    } else {
-		gevent->type = NSFB_EVENT_KEY_UP;
+		event.type = NSFB_EVENT_KEY_UP;
 	    }
-	    gevent->value.keycode = NSFB_KEY_MOUSE_5;
-	} 
-	prevbuttonMask = buttonMask;
+	    event.value.keycode = button[loop];
+	    vnc_queue_event(vncstate, &event);
+	}
+	vncstate->button_mask = buttonMask;
     } else {
-	gevent->type = NSFB_EVENT_MOVE_ABSOLUTE;
-	gevent->value.vector.x = x;
-	gevent->value.vector.y = y;
-	gevent->value.vector.z = 0;	
+	event.type = NSFB_EVENT_MOVE_ABSOLUTE;
+	event.value.vector.x = x;
+	event.value.vector.y = y;
+	event.value.vector.z = 0;
+	vnc_queue_event(vncstate, &event);
     }
-
 }
 
 
 static void vnc_dokey(rfbBool down, rfbKeySym key, rfbClientPtr cl)
 {
+    vncstate_t *vncstate = cl->screen->screenData;
+    nsfb_event_t event;
     enum nsfb_key_code_e keycode = NSFB_KEY_UNKNOWN;
 
-    UNUSED(cl);
-
     if ((key >= XK_space) && (key <= XK_asciitilde)) {
 	/* ascii codes line up */
 	keycode = key; 
@@ -357,15 +419,92 @@ static void vnc_dokey(rfbBool down, rfbKeySym key, rfbClientPtr cl)
 
     if (down == 0) {
 	/* key up */
-	gevent->type = NSFB_EVENT_KEY_UP;
+	event.type = NSFB_EVENT_KEY_UP;
     } else {
 	/* key down */
-	gevent->type = NSFB_EVENT_KEY_DOWN;
+	event.type = NSFB_EVENT_KEY_DOWN;
+    }
+    event.value.keycode = keycode;
+    vnc_queue_event(vncstate, &event);
+}
+
+/* server thread, services clients from the shadow copy and marks the
+ * areas handed over by vnc_update as modified.
+ */
+static void *vnc_server(void *arg)
+{
+    vncstate_t *vncstate = arg;
+    rfbScreenInfoPtr vncscreen = vncstate->vncscreen;
+    const nsfb_bbox_t *rect;
+    int loop;
+
+    for (;;) {
+	/* wait for client messages without holding the lock */
+	rfbCheckFds(vncscreen, VNC_SERVER_USEC);
+
+	pthread_mutex_lock(&vncstate->lock);
+	if (vncstate->quit) {
+	    pthread_mutex_unlock(&vncstate->lock);
+	    break;
+	}
+
+	if (vncstate->cursor != NULL) {
+	    rfbSetCursor(vncscreen, vncstate->cursor);
+	    vncstate->cursor = NULL;
+	}
+
+	rect = vncstate->modified.rect;
+	for (loop = 0; loop < vncstate->modified.rectc; loop++) {
+	    rfbMarkRectAsModified(vncscreen, rect[loop].x0, rect[loop].y0,
+				  rect[loop].x1, rect[loop].y1);
+	}
+	nsfb_region_clear(&vncstate->modified);
+
+	/* encode and send updates while the shadow cannot change */
+	rfbProcessEvents(vncscreen, 0);
+	pthread_mutex_unlock(&vncstate->lock);
     }
-    gevent->value.keycode = keycode;
 
+    return NULL;
 }
 
+/* parse the surface parameters, a list of options separated by spaces or
+ * commas. The only option is "threaded" to run the server on its own
+ * thread. Returns false if there were unknown options.
+ */
+static bool vnc_parse_parameters(const char *parameters, bool *threaded)
+{
+    bool known = true;
+    size_t len;
+
+    *threaded = false;
+
+    while ((parameters != NULL) && (*parameters != 0)) {
+	len = strcspn(parameters, ", ");
+	if ((len == 8) && (strncmp(parameters, "threaded", len) == 0)) {
+	    *threaded = true;
+	} else if (len != 0) {
+	    known = false;
+	}
+	parameters += len;
+	parameters += strspn(parameters, ", ");
+    }
+
+    return known;
+}
+
+static int vnc_parameters(nsfb_t *nsfb, const char *parameters)
+{
+    bool threaded;
+
+    if (nsfb->surface_priv != NULL)
+        return -1; /* fail if surface already initialised */
+
+    if (!vnc_parse_parameters(parameters, &threaded))
+	return -1;
+
+    return 0;
+}
 
 static int vnc_set_geometry(nsfb_t *nsfb, int width, int height, enum nsfb_format_e format)
 {
@@ -392,6 +531,7 @@ static int vnc_set_geometry(nsfb_t *nsfb, int width, int height, enum nsfb_forma
 
 static int vnc_initialise(nsfb_t *nsfb)
 {
+    vncstate_t *vncstate;
     rfbScreenInfoPtr vncscreen;
     int argc = 0;
     char **argv = NULL;
@@ -403,6 +543,13 @@ static int vnc_initialise(nsfb_t *nsfb)
     if (nsfb->bpp != 32)
         return -1;
 
+    vncstate = calloc(1, sizeof(vncstate_t));
+    if (vncstate == NULL)
+        return -1; /* no memory */
+
+    /* unknown options were already refused by vnc_parameters */
+    vnc_parse_parameters(nsfb->parameters, &vncstate->threaded);
+
     /* create vnc screen with 8bits per sample, three samples per
      * pixel and 4 bytes per pixel. */
     vncscreen = rfbGetScreen(&argc, argv,
@@ -413,15 +560,22 @@ static int vnc_initialise(nsfb_t *nsfb)
 	/* Note libvncserver does not check its own allocations/error
 	 * paths so the faliure mode of the rfbGetScreen is to segfault.
 	 */
+	free(vncstate);
 	return -1;
     }
 
-    vncscreen->frameBuffer = malloc(nsfb->width * nsfb->height * (nsfb->bpp / 8));
+    /* the frame buffer starts out the same as the shadow copy */
+    vncstate->fb = calloc(nsfb->width * nsfb->height, (nsfb->bpp / 8));
+    vncstate->shadow = calloc(nsfb->width * nsfb->height, (nsfb->bpp / 8));
 
-    if (vncscreen->frameBuffer == NULL) {
+    if ((vncstate->fb == NULL) || (vncstate->shadow == NULL)) {
+	free(vncstate->shadow);
+	free(vncstate->fb);
+	free(vncstate);
 	rfbScreenCleanup(vncscreen);
 	return -1;
     }
+    vncscreen->frameBuffer = (char *)vncstate->shadow;
 
 
     switch (nsfb->bpp) {
@@ -450,12 +604,40 @@ static int vnc_initialise(nsfb_t *nsfb)
     vncscreen->autoPort = 1;
     vncscreen->ptrAddEvent = vnc_doptr;
     vncscreen->kbdAddEvent = vnc_dokey;
+    vncscreen->screenData = vncstate;
+
+    pthread_mutex_init(&vncstate->lock, NULL);
+    pthread_mutex_init(&vncstate->event_lock, NULL);
+    pthread_cond_init(&vncstate->event_cond, NULL);
 
     rfbInitServer(vncscreen);
+    vncstate->vncscreen = vncscreen;
+
+    if (vncstate->threaded) {
+	nsfb_bbox_t box = { 0, 0, nsfb->width, nsfb->height };
+
+	/* start with the whole screen modified. Reserving all the region
+	 * storage first means adding to it later cannot fail.
+	 */
+	if ((nsfb_region_reserve(&vncstate->modified) == false) ||
+	    (nsfb_region_add(&vncstate->modified, &box) == false) ||
+	    (pthread_create(&vncstate->thread, NULL,
+			    vnc_server, vncstate) != 0)) {
+	    rfbScreenCleanup(vncscreen);
+	    nsfb_region_fini(&vncstate->modified);
+	    pthread_cond_destroy(&vncstate->event_cond);
+	    pthread_mutex_destroy(&vncstate->event_lock);
+	    pthread_mutex_destroy(&vncstate->lock);
+	    free(vncstate->shadow);
+	    free(vncstate->fb);
+	    free(vncstate);
+	    return -1;
+	}
+    }
 
     /* keep parameters */
-    nsfb->surface_priv = vncscreen;
-    nsfb->ptr = (uint8_t *)vncscreen->frameBuffer;
+    nsfb->surface_priv = vncstate;
+    nsfb->ptr = vncstate->fb;
     nsfb->linelen = (nsfb->width * nsfb->bpp) / 8;
 
     return 0;
@@ -463,41 +645,213 @@ static int vnc_initialise(nsfb_t *nsfb)
 
 static int vnc_finalise(nsfb_t *nsfb)
 {
-    rfbScreenInfoPtr vncscreen = nsfb->surface_priv;
+    vncstate_t *vncstate = nsfb->surface_priv;
     
-    if (vncscreen != NULL) {
-	rfbScreenCleanup(vncscreen);
+    if (vncstate != NULL) {
+	if (vncstate->threaded) {
+	    pthread_mutex_lock(&vncstate->lock);
+	    vncstate->quit = true;
+	    pthread_mutex_unlock(&vncstate->lock);
+	    pthread_join(vncstate->thread, NULL);
+	}
+
+	if (vncstate->cursor != NULL) {
+	    rfbFreeCursor(vncstate->cursor);
+	}
+
+	rfbScreenCleanup(vncstate->vncscreen);
+	nsfb_region_fini(&vncstate->modified);
+	pthread_cond_destroy(&vncstate->event_cond);
+	pthread_mutex_destroy(&vncstate->event_lock);
+	pthread_mutex_destroy(&vncstate->lock);
+	free(vncstate->shadow);
+	free(vncstate->fb);
+	free(vncstate);
     }
 
     return 0;
 }
 
+/* compare an area of the frame buffer with the shadow copy, copying it
+ * to the shadow if it changed.
+ */
+static bool
+vnc_area_changed(nsfb_t *nsfb, vncstate_t *vncstate, const nsfb_bbox_t *area)
+{
+    int offset = (area->y0 * nsfb->linelen) + ((area->x0 * nsfb->bpp) / 8);
+    int width = ((area->x1 - area->x0) * nsfb->bpp) / 8;
+    uint8_t *fb = nsfb->ptr + offset;
+    uint8_t *shadow = vncstate->shadow + offset;
+    int y;
+
+    for (y = area->y0; y < area->y1; y++) {
+	if (memcmp(fb, shadow, width) != 0) {
+	    break;
+	}
+	fb += nsfb->linelen;
+	shadow += nsfb->linelen;
+    }
+
+    if (y == area->y1) {
+	return false;
+    }
+
+    /* the rows above are already the same */
+    for (; y < area->y1; y++) {
+	memcpy(shadow, fb, width);
+	fb += nsfb->linelen;
+	shadow += nsfb->linelen;
+    }
 
+    return true;
+}
+
+/* mark an area of the shadow copy as modified, or hand it to the server
+ * thread, the lock must be held.
+ */
+static void
+vnc_mark(vncstate_t *vncstate, int x0, int y0, int x1, int y1)
+{
+    nsfb_bbox_t box = { x0, y0, x1, y1 };
+
+    /* the region storage was reserved at start so adding cannot fail,
+     * but should it, the server is told directly under the lock.
+     */
+    if ((vncstate->threaded == false) ||
+	(nsfb_region_add(&vncstate->modified, &box) == false)) {
+	rfbMarkRectAsModified(vncstate->vncscreen, x0, y0, x1, y1);
+    }
+}
+
+/* mark the tiles of an area that changed as modified, joining tiles
+ * next to each other in a row of tiles into one rectangle.
+ */
 static int vnc_update(nsfb_t *nsfb, nsfb_bbox_t *box)
 {
-    rfbScreenInfoPtr vncscreen = nsfb->surface_priv;
+    vncstate_t *vncstate = nsfb->surface_priv;
+    nsfb_bbox_t fbarea;
+    nsfb_bbox_t area;
+    nsfb_bbox_t tile;
+    int run; /* left edge of the changed tiles in the row or -1 */
+
+    fbarea.x0 = 0;
+    fbarea.y0 = 0;
+    fbarea.x1 = nsfb->width;
+    fbarea.y1 = nsfb->height;
+
+    area = *box;
+    if (!nsfb_plot_clip(&fbarea, &area)) {
+	return 0;
+    }
+
+    nsfb->update_stats.bytes_marked += ((uint64_t)(area.x1 - area.x0) *
+		(area.y1 - area.y0) * nsfb->bpp) / 8;
 
-    rfbMarkRectAsModified(vncscreen, box->x0, box->y0, box->x1, box->y1);
+    pthread_mutex_lock(&vncstate->lock);
+
+    for (tile.y0 = area.y0; tile.y0 < area.y1; tile.y0 = tile.y1) {
+	tile.y1 = (tile.y0 / VNC_TILE_SIZE + 1) * VNC_TILE_SIZE;
+	if (tile.y1 > area.y1) {
+	    tile.y1 = area.y1;
+	}
+
+	run = -1;
+	for (tile.x0 = area.x0; tile.x0 < area.x1; tile.x0 = tile.x1) {
+	    tile.x1 = (tile.x0 / VNC_TILE_SIZE + 1) * VNC_TILE_SIZE;
+	    if (tile.x1 > area.x1) {
+		tile.x1 = area.x1;
+	    }
+
+	    if (vnc_area_changed(nsfb, vncstate, &tile)) {
+		nsfb->update_stats.bytes_changed +=
+			((tile.x1 - tile.x0) * (tile.y1 - tile.y0) *
+			 nsfb->bpp) / 8;
+		if (run < 0) {
+		    run = tile.x0;
+		}
+	    } else if (run >= 0) {
+		vnc_mark(vncstate, run, tile.y0, tile.x0, tile.y1);
+		run = -1;
+	    }
+	}
+
+	if (run >= 0) {
+	    vnc_mark(vncstate, run, tile.y0, area.x1, tile.y1);
+	}
+    }
+
+    pthread_mutex_unlock(&vncstate->lock);
 
     return 0;
 }
 
 
+/* wait for an input event queued by the server thread */
+static void vnc_wait_event(vncstate_t *vncstate, int timeout)
+{
+    struct timespec until;
+
+    if (timeout < 0) {
+	while (vncstate->event_count == 0) {
+	    pthread_cond_wait(&vncstate->event_cond, &vncstate->event_lock);
+	}
+	return;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += timeout / 1000;
+    until.tv_nsec += (timeout % 1000) * 1000000;
+    if (until.tv_nsec >= 1000000000) {
+	until.tv_sec++;
+	until.tv_nsec -= 1000000000;
+    }
+
+    while (vncstate->event_count == 0) {
+	if (pthread_cond_timedwait(&vncstate->event_cond,
+				   &vncstate->event_lock, &until) != 0) {
+	    break;
+	}
+    }
+}
+
 static bool vnc_input(nsfb_t *nsfb, nsfb_event_t *event, int timeout)
 {
-    rfbScreenInfoPtr vncscreen = nsfb->surface_priv;
+    vncstate_t *vncstate = nsfb->surface_priv;
+    bool queued;
     int ret;
 
-    if (vncscreen != NULL) {
-
-	gevent = event; /* blergh - have to use global state to pass data */
+    if (vncstate != NULL) {
 
 	/* set default to timeout */
 	event->type = NSFB_EVENT_CONTROL;
 	event->value.controlcode = NSFB_CONTROL_TIMEOUT;
 
-	ret = rfbProcessEvents(vncscreen, timeout * 1000);
-	if (ret == 0) {
+	if (vncstate->threaded) {
+	    pthread_mutex_lock(&vncstate->event_lock);
+	    if (timeout != 0) {
+		vnc_wait_event(vncstate, timeout);
+	    }
+	    vnc_next_event(vncstate, event);
+	    pthread_mutex_unlock(&vncstate->event_lock);
+
+	    return true;
+	}
+
+	/* service clients here, which queues their input, without
+	 * waiting if there is input already.
+	 */
+	pthread_mutex_lock(&vncstate->event_lock);
+	queued = (vncstate->event_count != 0);
+	pthread_mutex_unlock(&vncstate->event_lock);
+
+	ret = rfbProcessEvents(vncstate->vncscreen,
+			       queued ? 0 : timeout * 1000);
+
+	pthread_mutex_lock(&vncstate->event_lock);
+	queued = vnc_next_event(vncstate, event);
+	pthread_mutex_unlock(&vncstate->event_lock);
+
+	if ((queued) || (ret == 0)) {
 	    /* valid event */
 	    return true;
 	    
@@ -512,7 +866,7 @@ static bool vnc_input(nsfb_t *nsfb, nsfb_event_t *event, int timeout)
 static int
 vnc_cursor(nsfb_t *nsfb, struct nsfb_cursor_s *cursor)
 {
-    rfbScreenInfoPtr vncscreen = nsfb->surface_priv;
+    vncstate_t *vncstate = nsfb->surface_priv;
     rfbCursorPtr vnccursor = calloc(1,sizeof(rfbCursor));
     int rwidth; /* rounded width */
     int row;
@@ -550,7 +904,17 @@ vnc_cursor(nsfb_t *nsfb, struct nsfb_cursor_s *cursor)
 	}
     }
 
-    rfbSetCursor(vncscreen, vnccursor);
+    if (vncstate->threaded) {
+	/* hand the cursor to the server thread */
+	pthread_mutex_lock(&vncstate->lock);
+	if (vncstate->cursor != NULL) {
+	    rfbFreeCursor(vncstate->cursor);
+	}
+	vncstate->cursor = vnccursor;
+	pthread_mutex_unlock(&vncstate->lock);
+    } else {
+	rfbSetCursor(vncstate->vncscreen, vnccursor);
+    }
     return true;
 }
 
@@ -561,6 +925,7 @@ const nsfb_surface_rtns_t vnc_rtns = {
     .update = vnc_update,
     .cursor = vnc_cursor,
     .geometry = vnc_set_geometry,
+    .parameters = vnc_parameters,
 };
 
 NSFB_SURFACE_DEF(vnc, NSFB_SURFACE_VNC, &vnc_rtns)
@@ -14,6 +14,7 @@
 #endif
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -25,6 +26,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <poll.h>
 
 #include <linux/input.h>
 #include <wayland-client.h>
@@ -78,6 +80,20 @@ struct wld_connection {
     /** event queue */
     struct wld_event *event_head;
     struct wld_event *event_tail;
+
+    /** a cursor image has been set, it is hidden on entering the
+     * window while it is plotted.
+     */
+    bool cursor_set;
+
+    /** surface showing the cursor image as the pointer */
+    struct wl_surface *cursor_surface;
+
+    /** buffer holding the cursor image, NULL when it is plotted */
+    struct wld_shm_buffer *cursor_buffer;
+
+    int cursor_hotspot_x; /**< cursor image hotspot */
+    int cursor_hotspot_y;
 };
 
 /** wayland input seat */
@@ -91,6 +107,9 @@ struct wld_input {
     struct wl_pointer *pointer;
     struct wl_keyboard *keyboard;
 
+    uint32_t pointer_serial; /**< serial of the last pointer enter */
+    bool pointer_focus; /**< the pointer is over the window */
+
 
 };
 
@@ -104,6 +123,9 @@ struct wld_window {
     int width, height;
 };
 
+/** number of shared memory buffers presented in turn */
+#define WLD_SHM_BUFFERS 3
+
 struct wld_shm_buffer {
     struct wl_buffer *buffer; /**< wayland buffer object */
     void *data; /**< mapped memory */
@@ -111,13 +133,30 @@ struct wld_shm_buffer {
     bool inuse; /**< flag to indicate if the buffer has been released
 		 * after commit to a surface.
 		 */
+    struct wldstate_s *wldstate; /**< surface the buffer belongs to */
+
+    /** areas of the screen updated since the buffer was last presented */
+    struct nsfb_region_s stale;
 };
 
 
 typedef struct wldstate_s {
     struct wld_connection* connection; /**< connection to wayland server */
     struct wld_window *window;
-    struct wld_shm_buffer *shm_buffer;
+
+    /** pool of buffers presented to the compositor */
+    struct wld_shm_buffer *shm_buffer[WLD_SHM_BUFFERS];
+
+    void *fb; /**< frame buffer the plotters draw to */
+    int linelen; /**< length of a frame buffer line in bytes */
+
+    /** frame callback of the last commit, NULL once the compositor
+     * is ready for another frame.
+     */
+    struct wl_callback *frame;
+
+    /** areas updated but not yet presented */
+    struct nsfb_region_s damage;
 } wldstate_t;
 
 
@@ -880,6 +919,36 @@ struct wl_shm_listener shm_listenter = {
 	shm_format
 };
 
+/** show the cursor image on a pointer over the window
+ *
+ * While the cursor is plotted the pointer is hidden instead.
+ */
+static void
+set_pointer_cursor(struct wld_input *input)
+{
+    struct wld_connection *connection = input->connection;
+
+    if ((input->pointer == NULL) ||
+	(input->pointer_focus == false) ||
+	(connection->cursor_set == false)) {
+	return;
+    }
+
+    if (connection->cursor_buffer != NULL) {
+	wl_pointer_set_cursor(input->pointer,
+			      input->pointer_serial,
+			      connection->cursor_surface,
+			      connection->cursor_hotspot_x,
+			      connection->cursor_hotspot_y);
+    } else {
+	wl_pointer_set_cursor(input->pointer,
+			      input->pointer_serial,
+			      NULL,
+			      0,
+			      0);
+    }
+}
+
 static void
 pointer_handle_enter(void *data, struct wl_pointer *pointer,
 		     uint32_t serial, struct wl_surface *surface,
@@ -914,12 +983,17 @@ pointer_handle_enter(void *data, struct wl_pointer *pointer,
 	widget = window_find_widget(window, sx, sy);
 	input_set_focus_widget(input, widget, sx, sy);
 #else
-	UNUSED(data);
+	struct wld_input *input = data;
+
 	UNUSED(pointer);
-	UNUSED(serial);
 	UNUSED(surface);
 	UNUSED(sx_w);
 	UNUSED(sy_w);
+
+	input->pointer_serial = serial;
+	input->pointer_focus = true;
+
+	set_pointer_cursor(input);
 #endif
 }
 
@@ -933,10 +1007,13 @@ pointer_handle_leave(void *data, struct wl_pointer *pointer,
 	input->display->serial = serial;
 	input_remove_pointer_focus(input);
 #else
-	UNUSED(data);
+	struct wld_input *input = data;
+
 	UNUSED(pointer);
 	UNUSED(serial);
 	UNUSED(surface);
+
+	input->pointer_focus = false;
 #endif
 }
 
@@ -1106,6 +1183,7 @@ seat_handle_capabilities(void *data,
 
 	wl_pointer_destroy(input->pointer);
 	input->pointer = NULL;
+	input->pointer_focus = false;
     }
 
 #if 0
@@ -1327,6 +1405,171 @@ new_connection(void)
 
 
 
+static void present(struct wldstate_s *wldstate);
+
+static void
+frame_done(void *data, struct wl_callback *callback, uint32_t time)
+{
+    struct wldstate_s *wldstate = data;
+
+    UNUSED(time);
+
+    wl_callback_destroy(callback);
+    wldstate->frame = NULL;
+
+    /* present whatever was updated while the frame was outstanding */
+    present(wldstate);
+}
+
+static const struct wl_callback_listener frame_listener = {
+	frame_done
+};
+
+/** copy areas of the frame buffer to a shared memory buffer */
+static void
+copy_rects(struct wldstate_s *wldstate,
+	   struct wld_shm_buffer *shmbuf,
+	   const nsfb_bbox_t *box,
+	   int boxc)
+{
+    uint8_t *src;
+    uint8_t *dst;
+    int width;
+    int loop;
+    int y;
+
+    for (loop = 0; loop < boxc; loop++) {
+	src = (uint8_t *)wldstate->fb +
+		(box[loop].y0 * wldstate->linelen) + (box[loop].x0 * 4);
+	dst = (uint8_t *)shmbuf->data +
+		(box[loop].y0 * wldstate->linelen) + (box[loop].x0 * 4);
+	width = (box[loop].x1 - box[loop].x0) * 4;
+
+	for (y = box[loop].y0; y < box[loop].y1; y++) {
+	    memcpy(dst, src, width);
+	    src += wldstate->linelen;
+	    dst += wldstate->linelen;
+	}
+    }
+}
+
+/** Present the updated areas in a buffer the compositor has released
+ *
+ * Nothing is presented until the frame callback of the previous commit
+ * has been received, so updates made faster than the compositor
+ * repaints are gathered into the next frame. The buffer only has the
+ * areas updated since it was last presented copied into it.
+ */
+static void
+present(struct wldstate_s *wldstate)
+{
+    struct wl_surface *surface = wldstate->window->surface;
+    struct nsfb_region_s *damage = &wldstate->damage;
+    struct wld_shm_buffer *shmbuf = NULL;
+    int loop;
+    int idx;
+
+    if ((damage->rectc == 0) || (wldstate->frame != NULL)) {
+	return;
+    }
+
+    for (idx = 0; idx < WLD_SHM_BUFFERS; idx++) {
+	if (wldstate->shm_buffer[idx]->inuse == false) {
+	    shmbuf = wldstate->shm_buffer[idx];
+	    break;
+	}
+    }
+    if (shmbuf == NULL) {
+	/* presented when a buffer is released */
+	return;
+    }
+
+    /* every buffer misses the newly updated areas. All the storage the
+     * regions can need was reserved with the buffers, so adding to them
+     * cannot fail.
+     */
+    for (idx = 0; idx < WLD_SHM_BUFFERS; idx++) {
+	for (loop = 0; loop < damage->rectc; loop++) {
+	    nsfb_region_add(&wldstate->shm_buffer[idx]->stale,
+			    &damage->rect[loop]);
+	}
+    }
+
+    copy_rects(wldstate, shmbuf, shmbuf->stale.rect, shmbuf->stale.rectc);
+    nsfb_region_clear(&shmbuf->stale);
+
+    wl_surface_attach(surface, shmbuf->buffer, 0, 0);
+
+    /* every area is damaged in the one commit */
+    for (loop = 0; loop < damage->rectc; loop++) {
+	wl_surface_damage(surface,
+			  damage->rect[loop].x0,
+			  damage->rect[loop].y0,
+			  damage->rect[loop].x1 - damage->rect[loop].x0,
+			  damage->rect[loop].y1 - damage->rect[loop].y0);
+    }
+    nsfb_region_clear(damage);
+
+    wldstate->frame = wl_surface_frame(surface);
+    wl_callback_add_listener(wldstate->frame, &frame_listener, wldstate);
+
+    wl_surface_commit(surface);
+    shmbuf->inuse = true;
+
+    wl_display_flush(wldstate->connection->display);
+}
+
+/** dispatch any events the server has sent without waiting for more */
+static int
+dispatch_ready(struct wl_display *display)
+{
+    struct pollfd pfd;
+
+    while (wl_display_prepare_read(display) != 0) {
+	wl_display_dispatch_pending(display);
+    }
+
+    wl_display_flush(display);
+
+    pfd.fd = wl_display_get_fd(display);
+    pfd.events = POLLIN;
+
+    if (poll(&pfd, 1, 0) > 0) {
+	if (wl_display_read_events(display) == -1) {
+	    return -1;
+	}
+    } else {
+	wl_display_cancel_read(display);
+    }
+
+    return wl_display_dispatch_pending(display);
+}
+
+static int
+update_and_redraw_rects(struct wldstate_s *wldstate,
+			const nsfb_bbox_t *box,
+			int boxc)
+{
+    int loop;
+
+    for (loop = 0; loop < boxc; loop++) {
+	if (nsfb_region_add(&wldstate->damage, &box[loop]) == false) {
+	    return -1;
+	}
+    }
+
+    /* pick up frame callbacks and buffer releases, which may present
+     * the damage themselves.
+     */
+    if (dispatch_ready(wldstate->connection->display) == -1) {
+	return -1;
+    }
+
+    present(wldstate);
+
+    return 0;
+}
+
 static int
 update_and_redraw(struct wldstate_s *wldstate,
 		  int x,
@@ -1334,20 +1577,14 @@ update_and_redraw(struct wldstate_s *wldstate,
 		  int width,
 		  int height)
 {
-    wl_surface_attach(wldstate->window->surface,
-		      wldstate->shm_buffer->buffer,
-		      0,
-		      0);
-
-    wl_surface_damage(wldstate->window->surface, x, y, width, height);
+    nsfb_bbox_t box;
 
-    wl_surface_commit(wldstate->window->surface);
-    wldstate->shm_buffer->inuse = true;
+    box.x0 = x;
+    box.y0 = y;
+    box.x1 = x + width;
+    box.y1 = y + height;
 
-    /* force syncronisation to cause the update */
-    wl_display_roundtrip(wldstate->connection->display);
-
-    return 0;
+    return update_and_redraw_rects(wldstate, &box, 1);
 }
 
 static void
@@ -1497,6 +1734,11 @@ buffer_release(void *data, struct wl_buffer *buffer)
     UNUSED(buffer);
 
     shmbuf->inuse = false;
+
+    /* present any updates that were waiting for a free buffer */
+    if (shmbuf->wldstate != NULL) {
+	present(shmbuf->wldstate);
+    }
 }
 
 static const struct wl_buffer_listener buffer_listener = {
@@ -1563,10 +1805,58 @@ new_shm_buffer(struct wl_shm *shm,
 
 static void free_shm_buffer(struct wld_shm_buffer *shmbuf)
 {
+    if (shmbuf == NULL) {
+	return;
+    }
+
+    wl_buffer_destroy(shmbuf->buffer);
     munmap(shmbuf->data, shmbuf->size);
+    nsfb_region_fini(&shmbuf->stale);
     free(shmbuf);
 }
 
+static void free_shm_buffers(struct wldstate_s *wldstate)
+{
+    int idx;
+
+    for (idx = 0; idx < WLD_SHM_BUFFERS; idx++) {
+	free_shm_buffer(wldstate->shm_buffer[idx]);
+	wldstate->shm_buffer[idx] = NULL;
+    }
+}
+
+static int
+new_shm_buffers(struct wldstate_s *wldstate, int width, int height)
+{
+    nsfb_bbox_t screen = { 0, 0, width, height };
+    struct wld_shm_buffer *shmbuf;
+    int idx;
+
+    for (idx = 0; idx < WLD_SHM_BUFFERS; idx++) {
+	shmbuf = new_shm_buffer(wldstate->connection->shm,
+				width,
+				height,
+				WL_SHM_FORMAT_XRGB8888);
+	if (shmbuf == NULL) {
+	    free_shm_buffers(wldstate);
+	    return -1;
+	}
+	wldstate->shm_buffer[idx] = shmbuf;
+	shmbuf->wldstate = wldstate;
+
+	/* the whole buffer is filled on first use. Reserving all the
+	 * region storage now means later additions cannot fail.
+	 */
+	if ((nsfb_region_reserve(&shmbuf->stale) == false) ||
+	    (nsfb_region_add(&shmbuf->stale, &screen) == false)) {
+	    free_shm_buffers(wldstate);
+	    return -1;
+	}
+    }
+
+    return 0;
+}
+
 static int wld_initialise(nsfb_t *nsfb)
 {
     wldstate_t *wldstate = nsfb->surface_priv;
@@ -1606,13 +1896,14 @@ static int wld_initialise(nsfb_t *nsfb)
 	return -1; /* error */
     }
 
-    wldstate->shm_buffer = new_shm_buffer(wldstate->connection->shm,
-					  nsfb->width,
-					  nsfb->height,
-					  WL_SHM_FORMAT_XRGB8888);
-    if (wldstate->shm_buffer == NULL) {
+    wldstate->linelen = nsfb->width * 4;
+    wldstate->fb = calloc(nsfb->height, wldstate->linelen);
+    if ((wldstate->fb == NULL) ||
+	(new_shm_buffers(wldstate, nsfb->width, nsfb->height) != 0)) {
 	fprintf(stderr, "Error creating wayland shared memory\n");
 
+	free(wldstate->fb);
+
 	free_window(wldstate->window);
 
 	free_connection(wldstate->connection);
@@ -1622,8 +1913,8 @@ static int wld_initialise(nsfb_t *nsfb)
 	return -1; /* error */
     }
 
-    nsfb->ptr = wldstate->shm_buffer->data;
-    nsfb->linelen = nsfb->width * 4;
+    nsfb->ptr = wldstate->fb;
+    nsfb->linelen = wldstate->linelen;
 
     update_and_redraw(wldstate,0,0, nsfb->width, nsfb->height);
 
@@ -1640,7 +1931,20 @@ static int wld_finalise(nsfb_t *nsfb)
 	return 0; /* not initialised */
     }
 
-    free_shm_buffer(wldstate->shm_buffer);
+    if (wldstate->frame != NULL) {
+	wl_callback_destroy(wldstate->frame);
+    }
+
+    free_shm_buffers(wldstate);
+
+    nsfb_region_fini(&wldstate->damage);
+
+    free_shm_buffer(wldstate->connection->cursor_buffer);
+    if (wldstate->connection->cursor_surface != NULL) {
+	wl_surface_destroy(wldstate->connection->cursor_surface);
+    }
+
+    free(wldstate->fb);
 
     free_window(wldstate->window);
 
@@ -2029,22 +2333,112 @@ static int wld_claim(nsfb_t *nsfb, nsfb_bbox_t *box)
     return 0;
 }
 
+/** Make the cursor image the pointer image of the window.
+ *
+ * @return true if the compositor shows the image, false if it must be
+ *         plotted.
+ */
+static bool
+wld_cursor_native(struct wld_connection *connection,
+		  struct nsfb_cursor_s *cursor)
+{
+    struct wld_shm_buffer *shmbuf;
+
+    if ((cursor->pixel == NULL) ||
+	(cursor->bmp_width <= 0) ||
+	(cursor->bmp_height <= 0)) {
+	return false;
+    }
+
+    if (connection->cursor_surface == NULL) {
+	connection->cursor_surface =
+		wl_compositor_create_surface(connection->compositor);
+	if (connection->cursor_surface == NULL) {
+	    return false;
+	}
+    }
+
+    shmbuf = new_shm_buffer(connection->shm,
+			    cursor->bmp_width,
+			    cursor->bmp_height,
+			    WL_SHM_FORMAT_ARGB8888);
+    if (shmbuf == NULL) {
+	return false;
+    }
+
+    nsfb_cursor_argb(cursor, shmbuf->data);
+
+    wl_surface_attach(connection->cursor_surface, shmbuf->buffer, 0, 0);
+    wl_surface_damage(connection->cursor_surface,
+		      0, 0,
+		      cursor->bmp_width, cursor->bmp_height);
+    wl_surface_commit(connection->cursor_surface);
+
+    /* the previous image is no longer attached */
+    free_shm_buffer(connection->cursor_buffer);
+    connection->cursor_buffer = shmbuf;
+    connection->cursor_hotspot_x = cursor->hotspot_x;
+    connection->cursor_hotspot_y = cursor->hotspot_y;
+
+    return true;
+}
+
 static int
 wld_cursor(nsfb_t *nsfb, struct nsfb_cursor_s *cursor)
 {
     wldstate_t *wldstate = nsfb->surface_priv;
+    struct wld_connection *connection;
+    struct wld_input *input;
     nsfb_bbox_t redraw;
     nsfb_bbox_t fbarea;
 
-    if ((cursor != NULL) && (cursor->plotted == true)) {
+    if ((cursor == NULL) || (wldstate == NULL)) {
+	return true;
+    }
+    connection = wldstate->connection;
+
+    /* screen area */
+    fbarea.x0 = 0;
+    fbarea.y0 = 0;
+    fbarea.x1 = nsfb->width;
+    fbarea.y1 = nsfb->height;
+
+    if (cursor->new_image) {
+	cursor->new_image = false;
+
+	if (wld_cursor_native(connection, cursor)) {
+	    if (cursor->plotted == true) {
+		/* remove the plotted cursor */
+		nsfb_cursor_clear(nsfb, cursor);
+
+		redraw = cursor->savloc;
+		if (nsfb_plot_clip(&fbarea, &redraw)) {
+		    update_and_redraw(wldstate, redraw.x0, redraw.y0, redraw.x1 - redraw.x0, redraw.y1 - redraw.y0);
+		}
+	    }
+	    cursor->native = true;
+	} else {
+	    /* plot the cursor and hide the pointer */
+	    free_shm_buffer(connection->cursor_buffer);
+	    connection->cursor_buffer = NULL;
+	    cursor->native = false;
+	}
 
-	nsfb_plot_add_rect(&cursor->savloc, &cursor->loc, &redraw);
+	connection->cursor_set = true;
+	wl_list_for_each(input, &connection->input_list, link) {
+	    set_pointer_cursor(input);
+	}
+	wl_display_flush(connection->display);
+    }
+
+    if (cursor->native) {
+	/* the compositor moves the pointer */
+	return true;
+    }
 
-	/* screen area */
-	fbarea.x0 = 0;
-	fbarea.y0 = 0;
-	fbarea.x1 = nsfb->width;
-	fbarea.y1 = nsfb->height;
+    if (cursor->plotted == true) {
+
+	nsfb_plot_add_rect(&cursor->savloc, &cursor->loc, &redraw);
 
 	nsfb_plot_clip(&fbarea, &redraw);
 
@@ -2052,9 +2446,7 @@ wld_cursor(nsfb_t *nsfb, struct nsfb_cursor_s *cursor)
 
 	nsfb_cursor_plot(nsfb, cursor);
 
-	/* TODO: This is hediously ineficient - should keep the pointer image
-	 * as a surface and composite server side
-	 */
+	/* only used when the compositor cannot show the cursor image */
 	update_and_redraw(wldstate, redraw.x0, redraw.y0, redraw.x1 - redraw.x0, redraw.y1 - redraw.y0);
 
     }
@@ -2078,6 +2470,21 @@ static int wld_update(nsfb_t *nsfb, nsfb_bbox_t *box)
     return 0;
 }
 
+static int wld_update_rects(nsfb_t *nsfb, nsfb_bbox_t *box, int boxc)
+{
+    wldstate_t *wldstate = nsfb->surface_priv;
+    struct nsfb_cursor_s *cursor = nsfb->cursor;
+
+    if ((cursor != NULL) && (cursor->plotted == false)) {
+	nsfb_cursor_plot(nsfb, cursor);
+    }
+
+    if (wldstate != NULL) {
+	update_and_redraw_rects(wldstate, box, boxc);
+    }
+    return 0;
+}
+
 
 const nsfb_surface_rtns_t wld_rtns = {
     .initialise = wld_initialise,
@@ -2085,6 +2492,7 @@ const nsfb_surface_rtns_t wld_rtns = {
     .input = wld_input,
     .claim = wld_claim,
     .update = wld_update,
+    .update_rects = wld_update_rects,
     .cursor = wld_cursor,
     .geometry = wld_set_geometry,
 };
@@ -18,6 +18,7 @@
 
 #include <xcb/xcb.h>
 #include <xcb/xcb_image.h>
+#include <xcb/render.h>
 #include <xcb/xcb_atom.h>
 #include <xcb/xcb_icccm.h>
 #include <xcb/xcb_aux.h>
@@ -64,6 +65,12 @@ xcb_free_size_hints(xcb_size_hints_t *hints)
 #define X_BUTTON_WHEELUP 4
 #define X_BUTTON_WHEELDOWN 5
 
+/* event read while looking for shm completions, held for x_input */
+struct x_event {
+    struct x_event *next;
+    xcb_generic_event_t *e;
+};
+
 typedef struct xstate_s {
     xcb_connection_t *connection; /* The x server connection */
     xcb_screen_t *screen; /* The screen to put the window on */
@@ -77,6 +84,17 @@ typedef struct xstate_s {
     xcb_pixmap_t pmap; /* The handle to the backing pixmap */
     xcb_gcontext_t gc; /* The handle to the pixmap plotting graphics context */
     xcb_shm_seg_t segment; /* The handle to the image shared memory */
+
+    uint8_t shm_completion; /* event code of shm completion events */
+    int shm_pending; /* shm uploads the server has not completed */
+    nsfb_bbox_t shm_busy; /* area read by the pending shm uploads */
+
+    struct x_event *event_head; /* events held for x_input */
+    struct x_event *event_tail;
+
+    xcb_render_pictformat_t cursor_format; /* ARGB format for cursors */
+    xcb_cursor_t blank_cursor; /* window cursor for a software cursor */
+    xcb_cursor_t cursor; /* window cursor showing the cursor image */
 } xstate_t;
 
 /* X keyboard codepage to nsfb mapping */
@@ -426,42 +444,202 @@ xkeysym_to_nsfbkeycode(xcb_keysym_t ks)
 
   }
 */
+
+/* account for a shm completion event, returns false for other events */
+static bool
+x_shm_completion(xstate_t *xstate, xcb_generic_event_t *e)
+{
+    if ((xstate->shminfo.shmseg == 0) ||
+        ((e->response_type & 0x7f) != xstate->shm_completion)) {
+        return false;
+    }
+
+    if ((xstate->shm_pending > 0) && (--xstate->shm_pending == 0)) {
+        /* the server has read every upload */
+        xstate->shm_busy.x0 = xstate->shm_busy.y0 = 0;
+        xstate->shm_busy.x1 = xstate->shm_busy.y1 = 0;
+    }
+
+    return true;
+}
+
+/* take completion events the server has already sent without waiting,
+ * holding any other events for x_input
+ */
+static void
+x_poll_shm(xstate_t *xstate)
+{
+    xcb_generic_event_t *e;
+    struct x_event *held;
+
+    while (xstate->shm_pending > 0) {
+        e = xcb_poll_for_event(xstate->connection);
+        if (e == NULL) {
+            break;
+        }
+
+        if (x_shm_completion(xstate, e)) {
+            free(e);
+            continue;
+        }
+
+        held = malloc(sizeof(struct x_event));
+        if (held == NULL) {
+            free(e); /* the event is lost */
+            continue;
+        }
+        held->next = NULL;
+        held->e = e;
+        if (xstate->event_tail == NULL) {
+            xstate->event_head = held;
+        } else {
+            xstate->event_tail->next = held;
+        }
+        xstate->event_tail = held;
+    }
+}
+
+static xcb_generic_event_t *
+x_held_event(xstate_t *xstate)
+{
+    struct x_event *held = xstate->event_head;
+    xcb_generic_event_t *e;
+
+    if (held == NULL) {
+        return NULL;
+    }
+
+    xstate->event_head = held->next;
+    if (xstate->event_head == NULL) {
+        xstate->event_tail = NULL;
+    }
+    e = held->e;
+    free(held);
+
+    return e;
+}
+
+/* send the image data of an area to the pixmap
+ *
+ * Shared memory uploads ask for a completion event and are never waited
+ * on, the area they read is kept until the server has completed them
+ * all. Without shared memory only the area is sent, split into requests
+ * the server accepts.
+ */
 static int
-update_pixmap(xstate_t *xstate, int x, int y, int width, int height)
+update_pixmap(nsfb_t *nsfb, int x, int y, int width, int height)
 {
-    if (xstate->shminfo.shmseg == 0) {
-        /* not using shared memory */
+    xstate_t *xstate = nsfb->surface_priv;
+    xcb_image_t *image = xstate->image;
+    nsfb_bbox_t area;
+    uint8_t *data;
+    uint8_t *src;
+    size_t mark;
+    int bytes; /* bytes of image data in a row of the area */
+    int rowlen; /* length of a padded row of the area */
+    int maxrows; /* rows that fit in one request */
+    int rows;
+    int row;
+    int pad;
+    bool whole; /* the area is made of whole image rows */
+
+    if ((width <= 0) || (height <= 0)) {
+        return 0;
+    }
+
+    if (xstate->shminfo.shmseg != 0) {
+        /* shared memory */
+        xcb_image_shm_put(xstate->connection,
+                          xstate->pmap,
+                          xstate->gc,
+                          image,
+                          xstate->shminfo,
+                          x,y,
+                          x,y,
+                          width,height,1);
+
+        area.x0 = x;
+        area.y0 = y;
+        area.x1 = x + width;
+        area.y1 = y + height;
+        if (xstate->shm_pending++ == 0) {
+            xstate->shm_busy = area;
+        } else {
+            nsfb_plot_add_rect(&xstate->shm_busy, &area, &xstate->shm_busy);
+        }
+        return 0;
+    }
+
+    /* not using shared memory */
+    whole = (x == 0) && (width == image->width);
+    if (whole) {
+        /* whole rows are sent straight from the image */
+        bytes = image->stride;
+        rowlen = image->stride;
+    } else {
+        pad = image->scanline_pad / 8;
+        bytes = (width * image->bpp) / 8;
+        rowlen = ((bytes + pad - 1) / pad) * pad;
+    }
+
+    maxrows = ((xcb_get_maximum_request_length(xstate->connection) * 4) -
+               sizeof(xcb_put_image_request_t)) / rowlen;
+    if (maxrows < 1) {
+        maxrows = 1;
+    }
+
+    mark = nsfb_scratch_mark(nsfb);
+    data = NULL;
+    if (!whole) {
+        data = nsfb_scratch_alloc(nsfb,
+                                  rowlen * ((height < maxrows) ? height : maxrows));
+        if (data == NULL) {
+            return -1;
+        }
+    }
+
+    for (; height > 0; y += rows, height -= rows) {
+        rows = (height < maxrows) ? height : maxrows;
+        src = image->data + (y * image->stride) + ((x * image->bpp) / 8);
+
+        if (!whole) {
+            /* gather the rows of the area */
+            for (row = 0; row < rows; row++) {
+                memcpy(data + (row * rowlen), src + (row * image->stride), bytes);
+            }
+            src = data;
+        }
+
         xcb_put_image(xstate->connection,
-                      xstate->image->format,
+                      image->format,
                       xstate->pmap,
                       xstate->gc,
-                      xstate->image->width,
-                      height,
-                      0,
+                      width,
+                      rows,
+                      x,
                       y,
                       0,
-                      xstate->image->depth,
-                      (height) * xstate->image->stride,
-                      xstate->image->data + (y * xstate->image->stride));
-    } else {
-        /* shared memory */
-        xcb_image_shm_put(xstate->connection, 
-                          xstate->pmap, 
-                          xstate->gc, 
-                          xstate->image, 
-                          xstate->shminfo, 
-                          x,y,
-                          x,y,
-                          width,height,0);
+                      image->depth,
+                      rows * rowlen,
+                      src);
     }
 
+    nsfb_scratch_release(nsfb, mark);
+
     return 0;
 }
 
+/* send an area to the pixmap and copy it to the window
+ *
+ * The requests are not flushed, they are sent with the next frame or
+ * when events are next read.
+ */
 static int
-update_and_redraw_pixmap(xstate_t *xstate, int x, int y, int width, int height)
+update_and_redraw_pixmap(nsfb_t *nsfb, int x, int y, int width, int height)
 {
-    update_pixmap(xstate, x, y, width, height);
+    xstate_t *xstate = nsfb->surface_priv;
+
+    update_pixmap(nsfb, x, y, width, height);
 
     xcb_copy_area(xstate->connection,
                   xstate->pmap,
@@ -471,12 +649,18 @@ update_and_redraw_pixmap(xstate_t *xstate, int x, int y, int width, int height)
                   x, y,
                   width, height);
 
-    xcb_flush(xstate->connection);
-
     return 0;
 }
 
 
+/* copy an area of the screen
+ *
+ * The copy is made on the server when the pixmap is known to hold the
+ * areas involved. When an update is still gathered in the frame, a
+ * shared memory upload of them has not completed, or the cursor is over
+ * them, the destination is uploaded after the local copy instead, so the
+ * server never has to be waited on.
+ */
 static bool
 xcopy(nsfb_t *nsfb, nsfb_bbox_t *srcbox, nsfb_bbox_t *dstbox)
 {
@@ -492,6 +676,8 @@ xcopy(nsfb_t *nsfb, nsfb_bbox_t *srcbox, nsfb_bbox_t *dstbox)
     int width = dstbox->x1 - dstbox->x0;
     int height = dstbox->y1 - dstbox->y0;
     int hloop;
+    bool server = true; /* copy the area on the server */
+    bool cursor_cleared = false;
 
     nsfb_plot_add_rect(srcbox, dstbox, &allbox);
 
@@ -501,30 +687,39 @@ xcopy(nsfb_t *nsfb, nsfb_bbox_t *srcbox, nsfb_bbox_t *dstbox)
         (nsfb_plot_bbox_intersect(&allbox, &cursor->loc))) {
 
         nsfb_cursor_clear(nsfb, cursor);
-        update_pixmap(xstate, 
-                      cursor->savloc.x0, 
-                      cursor->savloc.y0, 
-                      cursor->savloc.x1 - cursor->savloc.x0, 
-                      cursor->savloc.y1 - cursor->savloc.y0);
+        cursor_cleared = true;
+        server = false;
+    }
 
-        /* must sync here or local framebuffer and remote pixmap will not be
-         * consistant 
-         */
-        xcb_aux_sync(xstate->connection); 
+    if ((nsfb->frame) &&
+        (nsfb->damage.rectc > 0) &&
+        (nsfb_plot_bbox_intersect(&allbox, &nsfb->damage.extents))) {
+        /* the pixmap lacks updates gathered in the frame */
+        server = false;
+    }
 
+    if (xstate->shm_pending > 0) {
+        x_poll_shm(xstate);
+        if ((xstate->shm_pending > 0) &&
+            (nsfb_plot_bbox_intersect(&allbox, &xstate->shm_busy))) {
+            /* the server may read the image after it is changed below */
+            server = false;
+        }
     }
 
-    /* copy the area on the server */
-    xcb_copy_area(xstate->connection,
-                  xstate->pmap,
-                  xstate->pmap,
-                  xstate->gc,
-                  srcbox->x0, 
-                  srcbox->y0,
-                  dstbox->x0, 
-                  dstbox->y0,
-                  srcbox->x1 - srcbox->x0, 
-                  srcbox->y1 - srcbox->y0);
+    if (server) {
+        /* copy the area on the server */
+        xcb_copy_area(xstate->connection,
+                      xstate->pmap,
+                      xstate->pmap,
+                      xstate->gc,
+                      srcbox->x0, 
+                      srcbox->y0,
+                      dstbox->x0, 
+                      dstbox->y0,
+                      srcbox->x1 - srcbox->x0, 
+                      srcbox->y1 - srcbox->y0);
+    }
 
     /* do the copy in the local memory too */
     srcptr = (nsfb->ptr +
@@ -561,6 +756,10 @@ xcopy(nsfb_t *nsfb, nsfb_bbox_t *srcbox, nsfb_bbox_t *dstbox)
         nsfb_cursor_plot(nsfb, cursor);
     }
 
+    if (!server) {
+        update_pixmap(nsfb, dstx, dsty, width, height);
+    }
+
     /* update the x window */
     xcb_copy_area(xstate->connection,
                   xstate->pmap,
@@ -570,6 +769,20 @@ xcopy(nsfb_t *nsfb, nsfb_bbox_t *srcbox, nsfb_bbox_t *dstbox)
                   dstx, dsty,
                   width, height);
 
+    if (cursor_cleared) {
+        /* the cursor was cleared and plotted again over its area */
+        nsfb_bbox_t fbarea = { 0, 0, nsfb->width, nsfb->height };
+        nsfb_bbox_t redraw = cursor->savloc;
+
+        if (nsfb_plot_clip(&fbarea, &redraw)) {
+            update_and_redraw_pixmap(nsfb,
+                                     redraw.x0,
+                                     redraw.y0,
+                                     redraw.x1 - redraw.x0,
+                                     redraw.y1 - redraw.y0);
+        }
+    }
+
     return true;
 
 }
@@ -680,6 +893,9 @@ create_shm_image(xstate_t *xstate, int width, int height, int bpp)
         return NULL;
     }
 
+    xstate->shm_completion = xcb_get_extension_data(xstate->connection,
+                                                    &xcb_shm_id)->first_event +
+                             XCB_SHM_COMPLETION;
 
     return xcb_image_create(width,
                             height,
@@ -764,6 +980,150 @@ create_blank_cursor(xcb_connection_t *conn, const xcb_screen_t *scr)
 }
 
 
+/**
+ * Find the render extension picture format for ARGB cursor images.
+ *
+ * @param conn xcb connection
+ * @return The picture format or 0 if the server cannot make ARGB cursors.
+ */
+static xcb_render_pictformat_t
+find_cursor_format(xcb_connection_t *conn)
+{
+    xcb_render_query_version_reply_t *version;
+    xcb_render_query_pict_formats_reply_t *formats;
+    xcb_render_pictforminfo_iterator_t fmt;
+    xcb_render_pictformat_t id = 0;
+
+    version = xcb_render_query_version_reply(conn,
+                    xcb_render_query_version(conn, 0, 5), NULL);
+    if (version == NULL) {
+        return 0;
+    }
+
+    /* cursors from pictures need render 0.5 */
+    if ((version->major_version == 0) && (version->minor_version < 5)) {
+        free(version);
+        return 0;
+    }
+    free(version);
+
+    formats = xcb_render_query_pict_formats_reply(conn,
+                    xcb_render_query_pict_formats(conn), NULL);
+    if (formats == NULL) {
+        return 0;
+    }
+
+    fmt = xcb_render_query_pict_formats_formats_iterator(formats);
+    for (; fmt.rem != 0; xcb_render_pictforminfo_next(&fmt)) {
+        if ((fmt.data->type == XCB_RENDER_PICT_TYPE_DIRECT) &&
+            (fmt.data->depth == 32) &&
+            (fmt.data->direct.alpha_shift == 24) &&
+            (fmt.data->direct.alpha_mask == 0xff) &&
+            (fmt.data->direct.red_shift == 16) &&
+            (fmt.data->direct.red_mask == 0xff) &&
+            (fmt.data->direct.green_shift == 8) &&
+            (fmt.data->direct.green_mask == 0xff) &&
+            (fmt.data->direct.blue_shift == 0) &&
+            (fmt.data->direct.blue_mask == 0xff)) {
+            id = fmt.data->id;
+            break;
+        }
+    }
+    free(formats);
+
+    return id;
+}
+
+/**
+ * Make the cursor image the window's cursor.
+ *
+ * @param nsfb The framebuffer context.
+ * @param cursor The cursor.
+ * @return true if the server shows the image, false if it must be plotted.
+ */
+static bool
+x_cursor_native(nsfb_t *nsfb, struct nsfb_cursor_s *cursor)
+{
+    xstate_t *xstate = nsfb->surface_priv;
+    const uint16_t one = 1;
+    xcb_pixmap_t pix;
+    xcb_gcontext_t gc;
+    xcb_render_picture_t pic;
+    xcb_cursor_t cur;
+    uint32_t *argb;
+    size_t size;
+    size_t mark;
+
+    if ((xstate->cursor_format == 0) ||
+        (cursor->pixel == NULL) ||
+        (cursor->bmp_width <= 0) ||
+        (cursor->bmp_height <= 0)) {
+        return false;
+    }
+
+    /* the pixels are sent in the order of this machine */
+    if (xcb_get_setup(xstate->connection)->image_byte_order !=
+        ((*(const uint8_t *)&one == 1) ?
+         XCB_IMAGE_ORDER_LSB_FIRST : XCB_IMAGE_ORDER_MSB_FIRST)) {
+        return false;
+    }
+
+    size = cursor->bmp_width * cursor->bmp_height * 4;
+    if ((size + sizeof(xcb_put_image_request_t)) >
+        (xcb_get_maximum_request_length(xstate->connection) * 4)) {
+        return false;
+    }
+
+    mark = nsfb_scratch_mark(nsfb);
+    argb = nsfb_scratch_alloc(nsfb, size);
+    if (argb == NULL) {
+        return false;
+    }
+    nsfb_cursor_argb(cursor, argb);
+
+    pix = xcb_generate_id(xstate->connection);
+    xcb_create_pixmap(xstate->connection, 32, pix, xstate->screen->root,
+                      cursor->bmp_width, cursor->bmp_height);
+
+    gc = xcb_generate_id(xstate->connection);
+    xcb_create_gc(xstate->connection, gc, pix, 0, NULL);
+
+    xcb_put_image(xstate->connection,
+                  XCB_IMAGE_FORMAT_Z_PIXMAP,
+                  pix,
+                  gc,
+                  cursor->bmp_width,
+                  cursor->bmp_height,
+                  0, 0,
+                  0,
+                  32,
+                  size,
+                  (const uint8_t *)argb);
+
+    nsfb_scratch_release(nsfb, mark);
+
+    pic = xcb_generate_id(xstate->connection);
+    xcb_render_create_picture(xstate->connection, pic, pix,
+                              xstate->cursor_format, 0, NULL);
+
+    cur = xcb_generate_id(xstate->connection);
+    xcb_render_create_cursor(xstate->connection, cur, pic,
+                             cursor->hotspot_x, cursor->hotspot_y);
+
+    xcb_render_free_picture(xstate->connection, pic);
+    xcb_free_gc(xstate->connection, gc);
+    xcb_free_pixmap(xstate->connection, pix);
+
+    xcb_change_window_attributes(xstate->connection, xstate->window,
+                                 XCB_CW_CURSOR, &cur);
+    if (xstate->cursor != 0) {
+        xcb_free_cursor(xstate->connection, xstate->cursor);
+    }
+    xstate->cursor = cur;
+
+    return true;
+}
+
 static int x_initialise(nsfb_t *nsfb)
 {
     uint32_t mask;
@@ -820,6 +1180,10 @@ static int x_initialise(nsfb_t *nsfb)
 
     /* get blank cursor */
     blank_cursor = create_blank_cursor(xstate->connection, xstate->screen);
+    xstate->blank_cursor = blank_cursor;
+
+    /* the cursor image is shown by the server when it can */
+    xstate->cursor_format = find_cursor_format(xstate->connection);
 
     /* get keysymbol maps */
     xstate->keysymbols = xcb_key_symbols_alloc(xstate->connection);
@@ -877,7 +1241,7 @@ static int x_initialise(nsfb_t *nsfb)
     */
 
     /* put the image into the pixmap */
-    update_and_redraw_pixmap(xstate, 0, 0, xstate->image->width, xstate->image->height);
+    update_and_redraw_pixmap(nsfb, 0, 0, xstate->image->width, xstate->image->height);
 
 
     /* show the window */
@@ -890,11 +1254,18 @@ static int x_initialise(nsfb_t *nsfb)
 static int x_finalise(nsfb_t *nsfb)
 {
     xstate_t *xstate = nsfb->surface_priv;
+    xcb_generic_event_t *e;
+
     if (xstate == NULL)
         return 0;
 
     xcb_key_symbols_free(xstate->keysymbols);
 
+    /* drop held events */
+    while ((e = x_held_event(xstate)) != NULL) {
+        free(e);
+    }
+
     /* free pixmap */
     xcb_free_pixmap(xstate->connection, xstate->pmap);
 
@@ -919,8 +1290,13 @@ static bool x_input(nsfb_t *nsfb, nsfb_event_t *event, int timeout)
 
     xcb_flush(xstate->connection);
 
+    /* events read while looking for shm completions come first */
+    e = x_held_event(xstate);
+
     /* try and retrive an event immediately */
-    e = xcb_poll_for_event(xstate->connection);
+    if (e == NULL) {
+        e = xcb_poll_for_event(xstate->connection);
+    }
 
     if ((e == NULL) && (timeout != 0)) {
         if (timeout > 0) {
@@ -960,6 +1336,11 @@ static bool x_input(nsfb_t *nsfb, nsfb_event_t *event, int timeout)
 
     event->type = NSFB_EVENT_NONE;
 
+    if (x_shm_completion(xstate, e)) {
+        free(e);
+        return true;
+    }
+
     switch (e->response_type) {
     case XCB_EXPOSE:
         ee = (xcb_expose_event_t *)e;
@@ -1079,15 +1460,52 @@ x_cursor(nsfb_t *nsfb, struct nsfb_cursor_s *cursor)
     nsfb_bbox_t redraw;
     nsfb_bbox_t fbarea;
 
-    if ((cursor != NULL) && (cursor->plotted == true)) {
+    if ((cursor == NULL) || (xstate == NULL)) {
+        return true;
+    }
+
+    /* screen area */
+    fbarea.x0 = 0;
+    fbarea.y0 = 0;
+    fbarea.x1 = nsfb->width;
+    fbarea.y1 = nsfb->height;
 
-        nsfb_plot_add_rect(&cursor->savloc, &cursor->loc, &redraw);
+    if (cursor->new_image) {
+        cursor->new_image = false;
+
+        if (x_cursor_native(nsfb, cursor)) {
+            if (cursor->plotted == true) {
+                /* remove the plotted cursor */
+                nsfb_cursor_clear(nsfb, cursor);
+
+                redraw = cursor->savloc;
+                if (nsfb_plot_clip(&fbarea, &redraw)) {
+                    update_and_redraw_pixmap(nsfb, redraw.x0, redraw.y0, redraw.x1 - redraw.x0, redraw.y1 - redraw.y0);
+                }
+            }
+            cursor->native = true;
+            xcb_flush(xstate->connection);
+            return true;
+        }
+
+        if (cursor->native) {
+            /* plot the cursor under the blank window cursor */
+            xcb_change_window_attributes(xstate->connection, xstate->window,
+                                         XCB_CW_CURSOR, &xstate->blank_cursor);
+            xcb_free_cursor(xstate->connection, xstate->cursor);
+            xstate->cursor = 0;
+            cursor->native = false;
+        }
+    }
+
+    if (cursor->native) {
+        /* the server moves the window cursor */
+        return true;
+    }
 
-        /* screen area */
-        fbarea.x0 = 0;
-        fbarea.y0 = 0;
-        fbarea.x1 = nsfb->width;
-        fbarea.y1 = nsfb->height;
+    if (cursor->plotted == true) {
+
+        nsfb_plot_add_rect(&cursor->savloc, &cursor->loc, &redraw);
 
         nsfb_plot_clip(&fbarea, &redraw);
 
@@ -1095,12 +1513,13 @@ x_cursor(nsfb_t *nsfb, struct nsfb_cursor_s *cursor)
 
         nsfb_cursor_plot(nsfb, cursor);
 
-        /* TODO: This is hediously ineficient - should keep the pointer image
-         * as a pixmap and plot server side
-         */
-        update_and_redraw_pixmap(xstate, redraw.x0, redraw.y0, redraw.x1 - redraw.x0, redraw.y1 - redraw.y0);
+        /* only used when the server cannot show the cursor image */
+        update_and_redraw_pixmap(nsfb, redraw.x0, redraw.y0, redraw.x1 - redraw.x0, redraw.y1 - redraw.y0);
 
     }
+
+    xcb_flush(xstate->connection);
+
     return true;
 }
 
@@ -1115,7 +1534,37 @@ static int x_update(nsfb_t *nsfb, nsfb_bbox_t *box)
         nsfb_cursor_plot(nsfb, cursor);
     }
 
-    update_and_redraw_pixmap(xstate, box->x0, box->y0, box->x1 - box->x0, box->y1 - box->y0);
+    update_and_redraw_pixmap(nsfb, box->x0, box->y0, box->x1 - box->x0, box->y1 - box->y0);
+
+    /* updates in a frame are flushed together when it ends */
+    if (!nsfb->frame) {
+        xcb_flush(xstate->connection);
+    }
+
+    return 0;
+}
+
+static int x_update_rects(nsfb_t *nsfb, nsfb_bbox_t *box, int boxc)
+{
+    xstate_t *xstate = nsfb->surface_priv;
+    struct nsfb_cursor_s *cursor = nsfb->cursor;
+    int loop;
+
+    if ((cursor != NULL) &&
+	(cursor->plotted == false)) {
+        nsfb_cursor_plot(nsfb, cursor);
+    }
+
+    /* copy every area to the window before a single flush */
+    for (loop = 0; loop < boxc; loop++) {
+        update_and_redraw_pixmap(nsfb,
+                                 box[loop].x0,
+                                 box[loop].y0,
+                                 box[loop].x1 - box[loop].x0,
+                                 box[loop].y1 - box[loop].y0);
+    }
+
+    xcb_flush(xstate->connection);
 
     return 0;
 }
@@ -1126,6 +1575,7 @@ const nsfb_surface_rtns_t x_rtns = {
     .input = x_input,
     .claim = x_claim,
     .update = x_update,
+    .update_rects = x_update_rects,
     .cursor = x_cursor,
     .geometry = x_set_geometry,
 };
@@ -0,0 +1,296 @@
+/*
+ * Copyright 2026 libnsfb contributors
+ *
+ * This file is part of libnsfb, http://www.netsurf-browser.org/
+ * Licenced under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ */
+
+/** \file
+ * Tile worker threads (implementation).
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libnsfb.h"
+#include "libnsfb_plot.h"
+
+#include "nsfb.h"
+#include "palette.h"
+#include "tiles.h"
+
+/** A worker thread. */
+struct nsfb_tiles_worker_s {
+	struct nsfb_tiles_s *tiles; /**< Pool the worker belongs to */
+	int index; /**< Index of the worker in the pool */
+	pthread_t thread; /**< The thread */
+	nsfb_t nsfb; /**< Copy of the context the worker plots with */
+	struct nsfb_scratch_s scratch; /**< Worker's scratch arena */
+	struct nsfb_palette_s *palette; /**< Worker's copy of the palette */
+};
+
+/** Pool of worker threads plotting tiles. */
+struct nsfb_tiles_s {
+	pthread_mutex_t lock; /**< Protects everything below */
+	pthread_cond_t start; /**< Signalled when a job is started */
+	pthread_cond_t done; /**< Signalled when the last worker finishes */
+
+	struct nsfb_tiles_worker_s *worker; /**< Worker threads */
+	int workerc; /**< Number of worker threads */
+
+	unsigned int job; /**< Number of the current job */
+	bool quit; /**< The workers should exit */
+	int active; /**< Number of workers taking part in the current job */
+	int busy; /**< Workers yet to finish the current job */
+
+	nsfb_tiles_fn *fn; /**< Function plotting a tile */
+	void *ctx; /**< Context of fn */
+	const int *tile; /**< Tiles of the current job */
+	int tilec; /**< Number of tiles in the current job */
+	int next; /**< Next tile to plot */
+	bool ret; /**< false if any tile failed */
+};
+
+/** Find the area of the screen covered by a tile. */
+static void tiles_area(const nsfb_t *nsfb, int tile, nsfb_bbox_t *area)
+{
+	int columns = nsfb_tiles_columns(nsfb);
+
+	area->x0 = (tile % columns) * NSFB_TILE_SIZE;
+	area->y0 = (tile / columns) * NSFB_TILE_SIZE;
+	area->x1 = area->x0 + NSFB_TILE_SIZE;
+	area->y1 = area->y0 + NSFB_TILE_SIZE;
+	if (area->x1 > nsfb->width)
+		area->x1 = nsfb->width;
+	if (area->y1 > nsfb->height)
+		area->y1 = nsfb->height;
+}
+
+/** Plot tiles of the current job until none are left. */
+static void tiles_work(struct nsfb_tiles_s *tiles, nsfb_t *nsfb)
+{
+	nsfb_bbox_t area;
+	int tile;
+	bool ret;
+
+	for (;;) {
+		pthread_mutex_lock(&tiles->lock);
+		if (tiles->next >= tiles->tilec) {
+			pthread_mutex_unlock(&tiles->lock);
+			return;
+		}
+		tile = tiles->tile[tiles->next++];
+		pthread_mutex_unlock(&tiles->lock);
+
+		tiles_area(nsfb, tile, &area);
+		ret = tiles->fn(nsfb, tile, &area, tiles->ctx);
+		if (ret == false) {
+			pthread_mutex_lock(&tiles->lock);
+			tiles->ret = false;
+			pthread_mutex_unlock(&tiles->lock);
+		}
+	}
+}
+
+/** Worker thread main loop. */
+static void *tiles_worker(void *arg)
+{
+	struct nsfb_tiles_worker_s *worker = arg;
+	struct nsfb_tiles_s *tiles = worker->tiles;
+	unsigned int job = 0;
+
+	pthread_mutex_lock(&tiles->lock);
+	for (;;) {
+		while ((tiles->quit == false) && (tiles->job == job))
+			pthread_cond_wait(&tiles->start, &tiles->lock);
+		if (tiles->quit)
+			break;
+		job = tiles->job;
+		if (worker->index >= tiles->active)
+			continue;
+		pthread_mutex_unlock(&tiles->lock);
+
+		tiles_work(tiles, &worker->nsfb);
+
+		pthread_mutex_lock(&tiles->lock);
+		if (--tiles->busy == 0)
+			pthread_cond_signal(&tiles->done);
+	}
+	pthread_mutex_unlock(&tiles->lock);
+
+	return NULL;
+}
+
+/** Set up a worker's copy of the context for a job. */
+static bool tiles_worker_sync(struct nsfb_tiles_worker_s *worker, nsfb_t *nsfb)
+{
+	if ((nsfb->palette != NULL) &&
+	    !nsfb_palette_copy(&worker->palette, nsfb->palette))
+		return false;
+
+	worker->nsfb = *nsfb;
+	worker->nsfb.scratch = worker->scratch;
+	worker->nsfb.dlist.recording = false;
+	worker->nsfb.tiles = NULL;
+	if (nsfb->palette != NULL)
+		worker->nsfb.palette = worker->palette;
+
+	return true;
+}
+
+/* exported interface documented in tiles.h */
+void nsfb_tiles_free(struct nsfb_tiles_s *tiles)
+{
+	int loop;
+
+	if (tiles == NULL)
+		return;
+
+	pthread_mutex_lock(&tiles->lock);
+	tiles->quit = true;
+	pthread_cond_broadcast(&tiles->start);
+	pthread_mutex_unlock(&tiles->lock);
+
+	for (loop = 0; loop < tiles->workerc; loop++) {
+		pthread_join(tiles->worker[loop].thread, NULL);
+		nsfb_scratch_fini(&tiles->worker[loop].scratch);
+		nsfb_palette_free(tiles->worker[loop].palette);
+	}
+
+	pthread_cond_destroy(&tiles->done);
+	pthread_cond_destroy(&tiles->start);
+	pthread_mutex_destroy(&tiles->lock);
+	free(tiles->worker);
+	free(tiles);
+}
+
+/* exported interface documented in tiles.h */
+bool nsfb_tiles_set_threads(nsfb_t *nsfb, int threads)
+{
+	struct nsfb_tiles_s *tiles;
+
+	if (threads > NSFB_TILES_THREADS_MAX)
+		threads = NSFB_TILES_THREADS_MAX;
+
+	if ((nsfb->tiles != NULL) && (nsfb->tiles->workerc == threads - 1))
+		return true;
+
+	nsfb_tiles_free(nsfb->tiles);
+	nsfb->tiles = NULL;
+
+	if (threads <= 1)
+		return true;
+
+	tiles = calloc(1, sizeof(struct nsfb_tiles_s));
+	if (tiles == NULL)
+		return false;
+
+	tiles->worker = calloc(threads - 1,
+			       sizeof(struct nsfb_tiles_worker_s));
+	if (tiles->worker == NULL) {
+		free(tiles);
+		return false;
+	}
+
+	pthread_mutex_init(&tiles->lock, NULL);
+	pthread_cond_init(&tiles->start, NULL);
+	pthread_cond_init(&tiles->done, NULL);
+
+	for (; tiles->workerc < threads - 1; tiles->workerc++) {
+		struct nsfb_tiles_worker_s *worker;
+
+		worker = &tiles->worker[tiles->workerc];
+		worker->tiles = tiles;
+		worker->index = tiles->workerc;
+		if (pthread_create(&worker->thread, NULL,
+				   tiles_worker, worker) != 0) {
+			nsfb_tiles_free(tiles);
+			return false;
+		}
+	}
+
+	nsfb->tiles = tiles;
+
+	return true;
+}
+
+/* exported interface documented in tiles.h */
+bool
+nsfb_tiles_run(nsfb_t *nsfb,
+	       const int *tile,
+	       int tilec,
+	       nsfb_tiles_fn *fn,
+	       void *ctx)
+{
+	struct nsfb_tiles_s *tiles = nsfb->tiles;
+	int workerc = 0;
+	int loop;
+	bool ret;
+
+	if (tilec == 0)
+		return true;
+
+	/* Only start as many workers as there are other tiles */
+	if (tiles != NULL) {
+		workerc = (tilec - 1 < tiles->workerc) ?
+				tilec - 1 : tiles->workerc;
+	}
+
+	for (loop = 0; loop < workerc; loop++) {
+		if (!tiles_worker_sync(&tiles->worker[loop], nsfb)) {
+			workerc = loop;
+			break;
+		}
+	}
+
+	if (workerc == 0) {
+		/* Plot every tile on the calling thread */
+		nsfb_bbox_t area;
+
+		ret = true;
+		for (loop = 0; loop < tilec; loop++) {
+			tiles_area(nsfb, tile[loop], &area);
+			if (!fn(nsfb, tile[loop], &area, ctx))
+				ret = false;
+		}
+
+		return ret;
+	}
+
+	pthread_mutex_lock(&tiles->lock);
+	tiles->fn = fn;
+	tiles->ctx = ctx;
+	tiles->tile = tile;
+	tiles->tilec = tilec;
+	tiles->next = 0;
+	tiles->ret = true;
+	tiles->active = workerc;
+	tiles->busy = workerc;
+	tiles->job++;
+	pthread_cond_broadcast(&tiles->start);
+	pthread_mutex_unlock(&tiles->lock);
+
+	/* The calling thread plots tiles with its own context too */
+	tiles_work(tiles, nsfb);
+
+	pthread_mutex_lock(&tiles->lock);
+	while (tiles->busy > 0)
+		pthread_cond_wait(&tiles->done, &tiles->lock);
+	ret = tiles->ret;
+	pthread_mutex_unlock(&tiles->lock);
+
+	/* Keep the scratch storage the workers grew */
+	for (loop = 0; loop < workerc; loop++)
+		tiles->worker[loop].scratch = tiles->worker[loop].nsfb.scratch;
+
+	return ret;
+}
+
+/*
+ * Local Variables:
+ * c-basic-offset:8
+ * End:
+ */
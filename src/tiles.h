@@ -0,0 +1,80 @@
+/*
+ * Copyright 2026 libnsfb contributors
+ *
+ * This file is part of libnsfb, http://www.netsurf-browser.org/
+ * Licenced under the MIT License,
+ *                http://www.opensource.org/licenses/mit-license.php
+ *
+ * This is the *internal* interface for the tile worker threads.
+ */
+
+#ifndef TILES_H
+#define TILES_H 1
+
+#include <stdbool.h>
+
+#include "libnsfb.h"
+#include "libnsfb_plot.h"
+
+#include "nsfb.h"
+
+/** Width and height of a screen tile in pixels */
+#define NSFB_TILE_SIZE 64
+
+/** Most threads a context can plot with */
+#define NSFB_TILES_THREADS_MAX 64
+
+struct nsfb_tiles_s;
+
+/** Plot to one tile.
+ *
+ * \param nsfb The context to plot with, private to the calling thread.
+ * \param tile The index of the tile.
+ * \param area The area of the screen covered by the tile.
+ * \param ctx The context passed to ::nsfb_tiles_run.
+ * \return true on success or false if a plot failed.
+ */
+typedef bool (nsfb_tiles_fn)(nsfb_t *nsfb, int tile, const nsfb_bbox_t *area, void *ctx);
+
+/** Number of tile columns covering a context's screen. */
+static inline int nsfb_tiles_columns(const nsfb_t *nsfb)
+{
+	return (nsfb->width + NSFB_TILE_SIZE - 1) / NSFB_TILE_SIZE;
+}
+
+/** Number of tile rows covering a context's screen. */
+static inline int nsfb_tiles_rows(const nsfb_t *nsfb)
+{
+	return (nsfb->height + NSFB_TILE_SIZE - 1) / NSFB_TILE_SIZE;
+}
+
+/** Set the number of threads a context plots tiles with.
+ *
+ * The calling thread is one of them, so one thread or fewer stops the
+ * worker threads and frees the pool.
+ *
+ * \param nsfb The context.
+ * \param threads The number of threads.
+ * \return true on success or false if the threads could not be started.
+ */
+bool nsfb_tiles_set_threads(nsfb_t *nsfb, int threads);
+
+/** Plot a list of tiles with every thread of a context.
+ *
+ * Each thread plots with its own copy of the context, which has its own
+ * scratch arena and palette dither state. The call returns once every
+ * tile has been plotted.
+ *
+ * \param nsfb The context.
+ * \param tile The indexes of the tiles to plot.
+ * \param tilec The number of tiles.
+ * \param fn The function plotting a tile.
+ * \param ctx Context passed to fn.
+ * \return true on success or false if any tile failed.
+ */
+bool nsfb_tiles_run(nsfb_t *nsfb, const int *tile, int tilec, nsfb_tiles_fn *fn, void *ctx);
+
+/** Stop the worker threads of a pool and free it. */
+void nsfb_tiles_free(struct nsfb_tiles_s *tiles);
+
+#endif
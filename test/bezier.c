@@ -78,6 +78,7 @@ int main(int argc, char **argv)
     pen.fill_colour = 0xffff0000;
     pen.stroke_type = NFSB_PLOT_OPTYPE_SOLID;
     pen.fill_type = NFSB_PLOT_OPTYPE_NONE;
+    pen.stroke_width = 1;
 
     for (loop=-300;loop < 600;loop+=100) {
         ctrla.x = 100;
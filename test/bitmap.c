@@ -139,6 +139,28 @@ int main(int argc, char **argv)
 
     nsfb_plot_copy(nsfb, &box2, nsfb, &box3);
 
+    /* reduce with the box filter */
+    nsfb_plot_set_bitmap_filter(nsfb, NSFB_PLOT_FILTER_BOX);
+
+    box3.x0 = 0;
+    box3.y0 = 300;
+    box3.x1 = box3.x0 + 66;
+    box3.y1 = box3.y0 + 67;
+
+    nsfb_plot_copy(bmp, &box3, nsfb, &box3);
+
+    /* enlarge with the bilinear filter */
+    nsfb_plot_set_bitmap_filter(nsfb, NSFB_PLOT_FILTER_BILINEAR);
+
+    box3.x0 = 660;
+    box3.y0 = 0;
+    box3.x1 = box3.x0 + 140;
+    box3.y1 = box3.y0 + 143;
+
+    nsfb_plot_copy(bmp, &box3, nsfb, &box3);
+
+    nsfb_plot_set_bitmap_filter(nsfb, NSFB_PLOT_FILTER_NEAREST);
+
     nsfb_update(nsfb, &box);
 
     /* wait for quit event or timeout */
@@ -96,6 +96,7 @@ int main(int argc, char **argv)
     pen.fill_colour = 0xffff0000;
     pen.stroke_type = NFSB_PLOT_OPTYPE_SOLID;
     pen.fill_type = NFSB_PLOT_OPTYPE_NONE;
+    pen.stroke_width = 1;
 
     nsfb_plot_path(nsfb, fill_shape(path, 100, 50), path, &pen);
 
@@ -98,6 +98,10 @@ int main(int argc, char **argv)
     uint8_t *fbptr;
     int fbstride;
     int p[] = { 300,300,  350,350, 400,300, 450,250, 400,200};
+    nsfb_point_t zigzag[] = { {20,420}, {60,480}, {100,430}, {110,520},
+                              {180,500} };
+    nsfb_point_t wave[] = { {430,176}, {470,124}, {510,176}, {550,124},
+                            {570,150} };
     int loop;
     nsfb_plot_pen_t pen;
     const char *dumpfile = NULL;
@@ -150,7 +154,20 @@ int main(int argc, char **argv)
         nsfb_plot_clg(nsfb, 0xffffff00 | loop);
     }
 
+    /* the same again recorded, where all but the last clear is culled
+     * and the remaining one is split between tiles on four threads
+     */
+    nsfb_set_threads(nsfb, 4);
+    nsfb_plot_record(nsfb);
+    for (loop = 0; loop < 256;loop++) {
+        nsfb_plot_clg(nsfb, 0xffffff00 | loop);
+    }
+    nsfb_plot_flush(nsfb);
+    nsfb_set_threads(nsfb, 1);
+
     /* draw black radial lines from the origin */
+    pen.stroke_type = NFSB_PLOT_OPTYPE_SOLID;
+    pen.stroke_width = 1;
     pen.stroke_colour = 0xff000000;
     for (loop = 0; loop < box.x1; loop += 20) {
         box2 = box;
@@ -249,6 +266,59 @@ int main(int argc, char **argv)
 
     nsfb_plot_copy(nsfb, &box2, nsfb, &box3);
 
+    /* wide strokes with butt caps and mitered joins, then square caps
+     * and bevelled joins */
+    pen.stroke_width = 9;
+    pen.stroke_colour = 0xff008000;
+    nsfb_plot_set_stroke_style(nsfb, NSFB_PLOT_CAP_BUTT, NSFB_PLOT_JOIN_MITER);
+    nsfb_plot_polylines(nsfb, 5, zigzag, &pen);
+
+    for (loop = 0; loop < 5; loop++) {
+        zigzag[loop].y += 60;
+    }
+    pen.stroke_colour = 0xff800080;
+    nsfb_plot_set_stroke_style(nsfb, NSFB_PLOT_CAP_SQUARE, NSFB_PLOT_JOIN_BEVEL);
+    nsfb_plot_polylines(nsfb, 5, zigzag, &pen);
+
+    box2.x0 = 220;
+    box2.y0 = 440;
+    box2.x1 = 340;
+    box2.y1 = 560;
+    pen.stroke_colour = 0xff808000;
+    nsfb_plot_line(nsfb, &box2, &pen);
+
+    nsfb_plot_rectangle(nsfb, &box2, 5, 0xff000080, false, false);
+
+    pen.stroke_width = 1;
+
+    /* a pie slice inside arcs each sweeping a further 45 degrees */
+    nsfb_plot_pie(nsfb, 700, 100, 56, 30, 300, 0xff0080ff);
+
+    for (loop = 1; loop <= 8; loop++) {
+        nsfb_plot_arc(nsfb, 700, 100, 60 + (loop * 4), 0, loop * 45,
+                      0xff000000);
+    }
+
+    /* dotted and dashed outlines, then a dash-dot pattern whose phase
+     * runs on round the corners of a polyline */
+    box2.x0 = 410;
+    box2.y0 = 100;
+    box2.x1 = 590;
+    box2.y1 = 200;
+    nsfb_plot_rectangle(nsfb, &box2, 1, 0xff000000, true, false);
+
+    box2.x0 += 10;
+    box2.y0 += 10;
+    box2.x1 -= 10;
+    box2.y1 -= 10;
+    nsfb_plot_rectangle(nsfb, &box2, 1, 0xffff0000, false, true);
+
+    pen.stroke_type = NFSB_PLOT_OPTYPE_PATTERN;
+    pen.stroke_pattern = 0x0C0FFF0F;
+    pen.stroke_colour = 0xff0000ff;
+    nsfb_plot_polylines(nsfb, 5, wave, &pen);
+    pen.stroke_type = NFSB_PLOT_OPTYPE_SOLID;
+
     /* test glyph plotting */
     for (loop = 100; loop < 200; loop+= Mglyph1.w) {
         box3.x0 = loop;
@@ -281,7 +351,10 @@ int main(int argc, char **argv)
 
     srand(1234);
 
+    /* gathered into frames of a hundred updates, each sent as one */
     for (loop=0; loop < 10000; loop++) {
+        if ((loop % 100) == 0)
+            nsfb_frame_begin(nsfb);
         nsfb_claim(nsfb, &box2);
         box3.x0 = rand() / (RAND_MAX / box.x1);
         box3.y0 = rand() / (RAND_MAX / box.y1);
@@ -289,6 +362,8 @@ int main(int argc, char **argv)
         box3.y1 = rand() / (RAND_MAX / 400);
         nsfb_plot_rectangle_fill(nsfb, &box3, 0xff000000 | rand());
         nsfb_update(nsfb, &box2);
+        if ((loop % 100) == 99)
+            nsfb_frame_end(nsfb);
     }
 
     /* wait for quit event or timeout */
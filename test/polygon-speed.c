@@ -0,0 +1,117 @@
+/* libnsfb polygon plotter speed test program
+ *
+ * Plots star shaped polygons of increasing vertex count and reports how
+ * the time taken scales with the number of vertices.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199506L
+#endif
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "libnsfb.h"
+#include "libnsfb_plot.h"
+#include "libnsfb_event.h"
+
+#define REPEAT 20
+
+int main(int argc, char **argv)
+{
+	const char *fename;
+	enum nsfb_type_e fetype;
+	nsfb_t *nsfb;
+
+	nsfb_bbox_t box;
+	int *points;
+	int sides;
+	int radius;
+	int loop;
+	int i;
+	double angle;
+	struct timespec start, end;
+	double elapsed;
+
+	if (argc < 2) {
+		fename="sdl";
+	} else {
+		fename = argv[1];
+	}
+
+	fetype = nsfb_type_from_name(fename);
+	if (fetype == NSFB_SURFACE_NONE) {
+		printf("Unable to convert \"%s\" to nsfb surface type\n",
+				fename);
+		return EXIT_FAILURE;
+	}
+
+	nsfb = nsfb_new(fetype);
+	if (nsfb == NULL) {
+		printf("Unable to allocate \"%s\" nsfb surface\n", fename);
+		return EXIT_FAILURE;
+	}
+
+	if (nsfb_init(nsfb) == -1) {
+		printf("Unable to initialise nsfb surface\n");
+		nsfb_free(nsfb);
+		return EXIT_FAILURE;
+	}
+
+	/* get the geometry of the whole screen */
+	box.x0 = box.y0 = 0;
+	nsfb_get_geometry(nsfb, &box.x1, &box.y1, NULL);
+	if ((box.x1 == 0) || (box.y1 == 0)) {
+		/* if surface was created with no size set a default */
+		nsfb_set_geometry(nsfb, 800, 600, NSFB_FMT_ANY);
+		nsfb_get_geometry(nsfb, &box.x1, &box.y1, NULL);
+	}
+
+	nsfb_claim(nsfb, &box);
+
+	/* Clear to white */
+	nsfb_plot_clg(nsfb, 0xffffffff);
+	nsfb_update(nsfb, &box);
+
+	radius = (box.y1 / 2) - 10;
+
+	for (sides = 8; sides <= 8192; sides *= 4) {
+		points = malloc(sides * 2 * sizeof(int));
+		if (points == NULL) {
+			printf("Unable to allocate %d vertices\n", sides);
+			nsfb_free(nsfb);
+			return EXIT_FAILURE;
+		}
+
+		/* star with alternate vertices on an inner circle */
+		for (i = 0; i < sides; i++) {
+			angle = (2 * M_PI * i) / sides;
+			points[i * 2] = (box.x1 / 2) + (int)
+				(((i & 1) ? radius / 2 : radius) * sin(angle));
+			points[i * 2 + 1] = (box.y1 / 2) + (int)
+				(((i & 1) ? radius / 2 : radius) * cos(angle));
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (loop = 0; loop < REPEAT; loop++) {
+			nsfb_plot_polygon(nsfb, points, sides,
+					  0xff000000 | (loop * 0x0c0a08));
+		}
+		nsfb_update(nsfb, &box);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		elapsed = (end.tv_sec - start.tv_sec) +
+			((end.tv_nsec - start.tv_nsec) / 1000000000.0);
+		printf("%5d vertices: %d polygons in %.3f seconds, %.3f ms per polygon\n",
+		       sides, REPEAT, elapsed, (elapsed * 1000) / REPEAT);
+
+		free(points);
+	}
+
+	nsfb_free(nsfb);
+
+	return 0;
+}
@@ -1,5 +1,9 @@
 /* libnsfb plotter test program */
 
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199506L
+#endif
+
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -7,6 +11,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <time.h>
 
 #include "libnsfb.h"
 #include "libnsfb_plot.h"
@@ -52,6 +57,9 @@ int main(int argc, char **argv)
 	int fbstride;
 	int i;
 	unsigned int x, y;
+	unsigned long glyphs = 0;
+	struct timespec start, end;
+	double elapsed;
 
 	if (argc < 2) {
 		fename="sdl";
@@ -81,6 +89,11 @@ int main(int argc, char **argv)
 	/* get the geometry of the whole screen */
 	box.x0 = box.y0 = 0;
 	nsfb_get_geometry(nsfb, &box.x1, &box.y1, NULL);
+	if ((box.x1 == 0) || (box.y1 == 0)) {
+		/* if surface was created with no size set a default */
+		nsfb_set_geometry(nsfb, 800, 600, NSFB_FMT_ANY);
+		nsfb_get_geometry(nsfb, &box.x1, &box.y1, NULL);
+	}
 
 	nsfb_get_buffer(nsfb, &fbptr, &fbstride);
 	nsfb_claim(nsfb, &box);
@@ -90,6 +103,7 @@ int main(int argc, char **argv)
 	nsfb_update(nsfb, &box);
 
 	/* test glyph plotting */
+	clock_gettime(CLOCK_MONOTONIC, &start);
 	for (i = 0; i < 1000; i++) {
 		for (y = 0; y < box.y1 - Mglyph1.h; y += Mglyph1.h) {
 			for (x = 0; x < box.x1 - Mglyph1.w; x += Mglyph1.w) {
@@ -100,10 +114,17 @@ int main(int argc, char **argv)
 
 				nsfb_plot_glyph1(nsfb, &box3,  Mglyph1.data,
 						Mglyph1.w, 0xff000000);
+				glyphs++;
 			}
 		}
 		nsfb_update(nsfb, &box);
 	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	elapsed = (end.tv_sec - start.tv_sec) +
+		((end.tv_nsec - start.tv_nsec) / 1000000000.0);
+	printf("%lu glyphs in %.3f seconds, %.0f glyphs per second\n",
+	       glyphs, elapsed, glyphs / elapsed);
 
 	nsfb_update(nsfb, &box);
 	nsfb_free(nsfb);
@@ -0,0 +1,157 @@
+/* libnsfb threaded tile plotting test program
+ *
+ * Plots the same recorded calls with one thread and with four and checks
+ * the results are identical.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libnsfb.h"
+#include "libnsfb_plot.h"
+
+#define UNUSED(x) ((x) = (x))
+
+#define BMP_WIDTH 7
+#define BMP_HEIGHT 5
+
+static nsfb_colour_t bmp_pixel[BMP_WIDTH * BMP_HEIGHT];
+
+static nsfb_t *
+new_surface(enum nsfb_type_e fetype, int threads)
+{
+    nsfb_t *nsfb;
+
+    nsfb = nsfb_new(fetype);
+    if (nsfb == NULL) {
+        return NULL;
+    }
+
+    if ((nsfb_init(nsfb) == -1) ||
+        (nsfb_set_geometry(nsfb, 320, 240, NSFB_FMT_XRGB8888) == -1) ||
+        (nsfb_set_threads(nsfb, threads) == -1)) {
+        nsfb_free(nsfb);
+        return NULL;
+    }
+
+    return nsfb;
+}
+
+static void
+plot(nsfb_t *nsfb)
+{
+    nsfb_bbox_t loc;
+    nsfb_bbox_t clip;
+    int loop;
+
+    nsfb_plot_record(nsfb);
+
+    nsfb_plot_clg(nsfb, 0xff808080);
+
+    /* scaled tiles over the whole screen */
+    loc.x0 = 3;
+    loc.y0 = 2;
+    loc.x1 = loc.x0 + 13;
+    loc.y1 = loc.y0 + 9;
+    nsfb_plot_bitmap_tiles(nsfb, &loc, 24, 26, bmp_pixel,
+                           BMP_WIDTH, BMP_HEIGHT, BMP_WIDTH, true);
+
+    /* scaled and unscaled tiles starting left of a clip rectangle, so
+     * whole tiles are skipped at the start of each row */
+    for (loop = 0; loop < 4; loop++) {
+        clip.x0 = 70 + loop * 37;
+        clip.y0 = 30 + loop * 41;
+        clip.x1 = clip.x0 + 90;
+        clip.y1 = clip.y0 + 70;
+        nsfb_plot_set_clip(nsfb, &clip);
+
+        loc.x0 = loop * 5 - 11;
+        loc.y0 = clip.y0 - 3;
+        if (loop & 1) {
+            loc.x1 = loc.x0 + BMP_WIDTH;
+            loc.y1 = loc.y0 + BMP_HEIGHT;
+        } else {
+            loc.x1 = loc.x0 + 13;
+            loc.y1 = loc.y0 + 9;
+        }
+        nsfb_plot_bitmap_tiles(nsfb, &loc, 40, 10, bmp_pixel,
+                               BMP_WIDTH, BMP_HEIGHT, BMP_WIDTH,
+                               (loop & 2) != 0);
+    }
+    nsfb_plot_set_clip(nsfb, NULL);
+
+    nsfb_plot_flush(nsfb);
+}
+
+int main(int argc, char **argv)
+{
+    const char *fename;
+    enum nsfb_type_e fetype;
+    nsfb_t *single;
+    nsfb_t *threaded;
+    uint8_t *sptr, *tptr;
+    int sstride, tstride;
+    int width, height;
+    int loop;
+    int ret = 0;
+
+    if (argc < 2) {
+        fename="ram";
+    } else {
+        fename = argv[1];
+    }
+
+    fetype = nsfb_type_from_name(fename);
+    if (fetype == NSFB_SURFACE_NONE) {
+        fprintf(stderr, "Unable to convert \"%s\" to nsfb surface type\n", fename);
+        return 1;
+    }
+
+    single = new_surface(fetype, 1);
+    threaded = new_surface(fetype, 4);
+    if ((single == NULL) || (threaded == NULL)) {
+        fprintf(stderr, "Unable to initialise nsfb surfaces\n");
+        if (single != NULL)
+            nsfb_free(single);
+        if (threaded != NULL)
+            nsfb_free(threaded);
+        return 4;
+    }
+
+    for (loop = 0; loop < BMP_WIDTH * BMP_HEIGHT; loop++) {
+        bmp_pixel[loop] = ((uint32_t)(0x40 + loop * 5) << 24) |
+                ((loop * 37) & 0xff) << 16 |
+                ((loop * 71) & 0xff) << 8 |
+                ((loop * 113) & 0xff);
+    }
+
+    plot(single);
+    plot(threaded);
+
+    nsfb_get_geometry(single, &width, &height, NULL);
+    nsfb_get_buffer(single, &sptr, &sstride);
+    nsfb_get_buffer(threaded, &tptr, &tstride);
+
+    for (loop = 0; loop < height; loop++) {
+        if (memcmp(sptr + loop * sstride, tptr + loop * tstride,
+                   width * 4) != 0) {
+            fprintf(stderr, "Threaded plot differs at row %d\n", loop);
+            ret = 5;
+            break;
+        }
+    }
+
+    nsfb_free(threaded);
+    nsfb_free(single);
+
+    return ret;
+}
+
+/*
+ * Local variables:
+ *  c-basic-offset: 4
+ *  tab-width: 8
+ * End:
+ */